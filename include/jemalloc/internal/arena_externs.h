@@ -14,6 +14,11 @@ extern const arena_bin_info_t arena_bin_info[NBINS];
 extern percpu_arena_mode_t opt_percpu_arena;
 extern const char *percpu_arena_mode_names[];
 
+extern prefault_t opt_prefault;
+extern const char *prefault_names[];
+
+extern size_t opt_retain_grow_limit;
+
 extern const uint64_t h_steps[SMOOTHSTEP_NSTEPS];
 extern malloc_mutex_t arenas_lock;
 
@@ -21,6 +26,10 @@ void arena_stats_large_nrequests_add(tsdn_t *tsdn, arena_stats_t *arena_stats,
     szind_t szind, uint64_t nrequests);
 void arena_stats_mapped_add(tsdn_t *tsdn, arena_stats_t *arena_stats,
     size_t size);
+void arena_stats_prefaulted_add(tsdn_t *tsdn, arena_stats_t *arena_stats,
+    size_t size);
+void arena_stats_thp_collapsed_add(tsdn_t *tsdn, arena_stats_t *arena_stats,
+    size_t size);
 void arena_basic_stats_merge(tsdn_t *tsdn, arena_t *arena,
     unsigned *nthreads, const char **dss, ssize_t *dirty_decay_ms,
     ssize_t *muzzy_decay_ms, size_t *nactive, size_t *ndirty, size_t *nmuzzy);
@@ -41,6 +50,8 @@ void arena_extent_ralloc_large_shrink(tsdn_t *tsdn, arena_t *arena,
     extent_t *extent, size_t oldsize);
 void arena_extent_ralloc_large_expand(tsdn_t *tsdn, arena_t *arena,
     extent_t *extent, size_t oldsize);
+size_t arena_retain_grow_limit_get(tsdn_t *tsdn, arena_t *arena);
+bool arena_retain_grow_limit_set(tsdn_t *tsdn, arena_t *arena, size_t limit);
 ssize_t arena_dirty_decay_ms_get(arena_t *arena);
 bool arena_dirty_decay_ms_set(tsdn_t *tsdn, arena_t *arena, ssize_t decay_ms);
 ssize_t arena_muzzy_decay_ms_get(arena_t *arena);
@@ -73,6 +84,10 @@ void *arena_ralloc(tsdn_t *tsdn, arena_t *arena, void *ptr, size_t oldsize,
     size_t size, size_t alignment, bool zero, tcache_t *tcache);
 dss_prec_t arena_dss_prec_get(arena_t *arena);
 bool arena_dss_prec_set(arena_t *arena, dss_prec_t dss_prec);
+prefault_t arena_prefault_get(arena_t *arena);
+void arena_prefault_set(arena_t *arena, prefault_t prefault);
+prefault_t arena_prefault_default_get(void);
+void arena_prefault_default_set(prefault_t prefault);
 ssize_t arena_dirty_decay_ms_default_get(void);
 bool arena_dirty_decay_ms_default_set(ssize_t decay_ms);
 ssize_t arena_muzzy_decay_ms_default_get(void);
@@ -6,6 +6,12 @@
 struct arena_slab_data_s {
 	/* Per region allocated/deallocated bitmap. */
 	bitmap_t	bitmap[BITMAP_GROUPS_MAX];
+	/*
+	 * Regions at or above this index have never been allocated, and are
+	 * zero-filled if the slab was (nregs if it was not).  Regions are
+	 * allocated lowest index first, so this only ever grows.
+	 */
+	unsigned	fresh_regind;
 };
 
 #endif /* JEMALLOC_INTERNAL_ARENA_STRUCTS_A_H */
@@ -197,6 +197,13 @@ struct arena_s {
 	 */
 	atomic_u_t		dss_prec;
 
+	/*
+	 * Represents a prefault_t, but atomically.
+	 *
+	 * Synchronization: atomic.
+	 */
+	atomic_u_t		prefault;
+
 	/*
 	 * Number of pages in active extents.
 	 *
@@ -242,6 +249,20 @@ struct arena_s {
 	 * Synchronization: extent_grow_mtx
 	 */
 	pszind_t		extent_grow_next;
+	/*
+	 * Largest size class extent_grow_next may reach
+	 * (arena.<i>.retain_grow_limit).
+	 *
+	 * Synchronization: extent_grow_mtx
+	 */
+	pszind_t		retain_grow_limit;
+	/*
+	 * Mappings grown for retained memory, newest first; only tracked with
+	 * opt.thp_policy.
+	 *
+	 * Synchronization: extent_grow_mtx
+	 */
+	extent_mapping_t	*extent_mappings;
 	malloc_mutex_t		extent_grow_mtx;
 
 	/*
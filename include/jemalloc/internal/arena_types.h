@@ -42,4 +42,20 @@ typedef enum {
 #define PERCPU_ARENA_ENABLED(m)	((m) >= percpu_arena_mode_enabled_base)
 #define PERCPU_ARENA_DEFAULT	percpu_arena_disabled
 
+/* Prefaulting of newly allocated extents (opt.prefault). */
+typedef enum {
+	prefault_disabled	= 0,
+	/* Fault in pages when extents are allocated. */
+	prefault_populate	= 1,
+
+	prefault_limit		= 2
+} prefault_t;
+#define PREFAULT_DEFAULT	prefault_disabled
+
+/*
+ * Default upper bound on the size of each address space growth step for
+ * retained memory (opt.retain_grow_limit), i.e. no bound.
+ */
+#define RETAIN_GROW_LIMIT_DEFAULT	LARGE_MAXCLASS
+
 #endif /* JEMALLOC_INTERNAL_ARENA_TYPES_H */
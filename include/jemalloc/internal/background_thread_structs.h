@@ -35,6 +35,19 @@ struct background_thread_info_s {
 	 *  background thread to wake up earlier.
 	 */
 	size_t			npages_to_purge_new;
+	/*
+	 * Set by application threads that deferred eager purging to us (see
+	 * opt.background_purge_only); rechecked before going to sleep, so that
+	 * hints posted while we are busy are not lost.
+	 */
+	atomic_b_t		purge_pending;
+	/*
+	 * True from right before purge_pending is rechecked until we wake up;
+	 * application threads must signal us while it is set.
+	 */
+	atomic_b_t		going_to_sleep;
+	/* Time of the next scan for opt.thp_policy. */
+	nstime_t		thp_scan_next;
 	/* Stats: total number of runs since started. */
 	uint64_t		tot_n_runs;
 	/* Stats: total sleep time since started. */
@@ -27,6 +27,12 @@ struct base_s {
 	 */
 	atomic_p_t	extent_hooks;
 
+	/*
+	 * Whether blocks are mapped via extent_hooks, rather than the default
+	 * extent hooks.
+	 */
+	bool		metadata_use_hooks;
+
 	/* Protects base_alloc() and base_stats_get() operations. */
 	malloc_mutex_t	mtx;
 
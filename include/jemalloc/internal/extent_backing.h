@@ -0,0 +1,33 @@
+#ifndef JEMALLOC_INTERNAL_EXTENT_BACKING_H
+#define JEMALLOC_INTERNAL_EXTENT_BACKING_H
+
+/*
+ * Built-in extent hooks for arenas backed by something other than anonymous
+ * memory (see arenas.create_backed).  The backing is described by a string:
+ *
+ *   "anonymous"          The default extent hooks.
+ *   "hugetlb[:<size>]"   MAP_HUGETLB memory with <size> pages (e.g. "2M").
+ *   "file:<path>"        A shared mapping of <path>, or of an unnamed
+ *                        temporary file if <path> is a directory.
+ */
+bool extent_backing_hooks_new(tsdn_t *tsdn, const char *backing,
+    extent_hooks_t **r_extent_hooks);
+/*
+ * Releases the reservation and file of hooks created by
+ * extent_backing_hooks_new() (a no-op for any other hooks), once all memory
+ * allocated from them has been destroyed.
+ */
+void extent_backing_hooks_release(tsdn_t *tsdn,
+    extent_hooks_t *extent_hooks);
+/*
+ * Maps the first granule of a backing created by extent_backing_hooks_new(),
+ * failing if it cannot supply any memory (e.g. no huge pages are available).
+ */
+bool extent_backing_hooks_prime(tsdn_t *tsdn, extent_hooks_t *extent_hooks);
+/* Returns whether extent_hooks were created by extent_backing_hooks_new(). */
+bool extent_backing_hooks_is(const extent_hooks_t *extent_hooks);
+void extent_backing_prefork(tsdn_t *tsdn);
+void extent_backing_postfork_parent(tsdn_t *tsdn);
+void extent_backing_postfork_child(tsdn_t *tsdn);
+
+#endif /* JEMALLOC_INTERNAL_EXTENT_BACKING_H */
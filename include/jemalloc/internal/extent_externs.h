@@ -10,9 +10,16 @@
 extern rtree_t			extents_rtree;
 extern const extent_hooks_t	extent_hooks_default;
 extern mutex_pool_t		extent_mutex_pool;
+extern extent_fit_t		opt_extent_fit;
+extern const char		*extent_fit_names[];
+extern size_t			opt_zero_purge_threshold;
+extern thp_policy_t		opt_thp_policy;
+extern const char		*thp_policy_names[];
 
 extent_t *extent_alloc(tsdn_t *tsdn, arena_t *arena);
 void extent_dalloc(tsdn_t *tsdn, arena_t *arena, extent_t *extent);
+void extent_avail_flush(tsdn_t *tsdn, tcache_t *tcache, unsigned rem);
+void extent_thp_scan(tsdn_t *tsdn, arena_t *arena);
 
 extent_hooks_t *extent_hooks_get(arena_t *arena);
 extent_hooks_t *extent_hooks_set(tsd_t *tsd, arena_t *arena,
@@ -30,12 +37,15 @@ bool extents_init(tsdn_t *tsdn, extents_t *extents, extent_state_t state,
     bool delay_coalesce);
 extent_state_t extents_state_get(const extents_t *extents);
 size_t extents_npages_get(extents_t *extents);
+size_t extents_nfresh_pages_get(extents_t *extents);
 extent_t *extents_alloc(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, extents_t *extents, void *new_addr,
     size_t size, size_t pad, size_t alignment, bool slab, szind_t szind,
     bool *zero, bool *commit);
 void extents_dalloc(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, extents_t *extents, extent_t *extent);
+void extents_dalloc_list(tsdn_t *tsdn, arena_t *arena,
+    extent_hooks_t **r_extent_hooks, extents_t *extents, extent_list_t *list);
 extent_t *extents_evict(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, extents_t *extents, size_t npages_min);
 void extents_prefork(tsdn_t *tsdn, extents_t *extents);
@@ -99,6 +99,18 @@ extent_slab_get(const extent_t *extent) {
 	    EXTENT_BITS_SLAB_SHIFT);
 }
 
+static inline bool
+extent_interior_stale_get(const extent_t *extent) {
+	return (bool)((extent->e_bits & EXTENT_BITS_INTERIOR_STALE_MASK) >>
+	    EXTENT_BITS_INTERIOR_STALE_SHIFT);
+}
+
+static inline bool
+extent_fresh_get(const extent_t *extent) {
+	return (bool)((extent->e_bits & EXTENT_BITS_FRESH_MASK) >>
+	    EXTENT_BITS_FRESH_SHIFT);
+}
+
 static inline unsigned
 extent_nfree_get(const extent_t *extent) {
 	assert(extent_slab_get(extent));
@@ -275,6 +287,18 @@ extent_slab_set(extent_t *extent, bool slab) {
 	    ((uint64_t)slab << EXTENT_BITS_SLAB_SHIFT);
 }
 
+static inline void
+extent_interior_stale_set(extent_t *extent, bool interior_stale) {
+	extent->e_bits = (extent->e_bits & ~EXTENT_BITS_INTERIOR_STALE_MASK) |
+	    ((uint64_t)interior_stale << EXTENT_BITS_INTERIOR_STALE_SHIFT);
+}
+
+static inline void
+extent_fresh_set(extent_t *extent, bool fresh) {
+	extent->e_bits = (extent->e_bits & ~EXTENT_BITS_FRESH_MASK) |
+	    ((uint64_t)fresh << EXTENT_BITS_FRESH_SHIFT);
+}
+
 static inline void
 extent_prof_tctx_set(extent_t *extent, prof_tctx_t *tctx) {
 	atomic_store_p(&extent->e_prof_tctx, tctx, ATOMIC_RELEASE);
@@ -290,6 +314,8 @@ extent_init(extent_t *extent, arena_t *arena, void *addr, size_t size,
 	extent_addr_set(extent, addr);
 	extent_size_set(extent, size);
 	extent_slab_set(extent, slab);
+	extent_interior_stale_set(extent, false);
+	extent_fresh_set(extent, false);
 	extent_szind_set(extent, szind);
 	extent_sn_set(extent, sn);
 	extent_state_set(extent, state);
@@ -307,6 +333,8 @@ extent_binit(extent_t *extent, void *addr, size_t bsize, size_t sn) {
 	extent_addr_set(extent, addr);
 	extent_bsize_set(extent, bsize);
 	extent_slab_set(extent, false);
+	extent_interior_stale_set(extent, false);
+	extent_fresh_set(extent, false);
 	extent_szind_set(extent, NSIZES);
 	extent_sn_set(extent, sn);
 	extent_state_set(extent, extent_state_active);
@@ -346,6 +374,21 @@ extent_list_remove(extent_list_t *list, extent_t *extent) {
 	ql_remove(list, extent, ql_link);
 }
 
+/* Moves all of src's extents to the end of list, leaving src empty. */
+static inline void
+extent_list_concat(extent_list_t *list, extent_list_t *src) {
+	extent_t *first = extent_list_first(src);
+	if (first == NULL) {
+		return;
+	}
+	if (extent_list_first(list) == NULL) {
+		ql_first(list) = first;
+	} else {
+		qr_meld(extent_list_first(list), first, extent_t, ql_link);
+	}
+	extent_list_init(src);
+}
+
 static inline int
 extent_sn_comp(const extent_t *a, const extent_t *b) {
 	size_t a_sn = extent_sn_get(a);
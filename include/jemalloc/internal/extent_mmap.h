@@ -2,9 +2,14 @@
 #define JEMALLOC_INTERNAL_EXTENT_MMAP_EXTERNS_H
 
 extern bool opt_retain;
+extern size_t opt_reserve_vm;
 
 void *extent_alloc_mmap(void *new_addr, size_t size, size_t alignment,
     bool *zero, bool *commit);
 bool extent_dalloc_mmap(void *addr, size_t size);
+bool extent_in_reserve(void *addr);
+bool extent_mmap_mergeable(void *addr_a, void *addr_b);
+void *extent_mmap_reserve_base(void);
+bool extent_mmap_boot(void);
 
 #endif /* JEMALLOC_INTERNAL_EXTENT_MMAP_EXTERNS_H */
@@ -26,11 +26,13 @@ struct extent_s {
 	 * c: committed
 	 * z: zeroed
 	 * t: state
+	 * s: interior_stale
+	 * e: fresh
 	 * i: szind
 	 * f: nfree
 	 * n: sn
 	 *
-	 * nnnnnnnn ... nnnnnfff fffffffi iiiiiiit tzcbaaaa aaaaaaaa
+	 * nnnnnnnn ... nnnfffff fffffiii iiiiiest tzcbaaaa aaaaaaaa
 	 *
 	 * arena_ind: Arena from which this extent came, or all 1 bits if
 	 *            unassociated.
@@ -50,6 +52,18 @@ struct extent_s {
 	 *
 	 * state: The state flag is an extent_state_t.
 	 *
+	 * interior_stale: The interior_stale flag indicates that the rtree
+	 *                 elements for the extent's interior pages may still map
+	 *                 to a slab that previously occupied the extent.
+	 *                 Clearing them is deferred while the extent is dirty,
+	 *                 since it is often reused as a slab of the same size, in
+	 *                 which case the elements are simply overwritten.  Only
+	 *                 inactive extents can have stale interiors.
+	 *
+	 * fresh: The fresh flag indicates that the extent's address space was
+	 *        obtained by growing retained memory, and has never been
+	 *        allocated since.  Only retained extents can be fresh.
+	 *
 	 * szind: The szind flag indicates usable size class index for
 	 *        allocations residing in this extent, regardless of whether the
 	 *        extent is a slab.  Extent size and usable size often differ
@@ -89,17 +103,25 @@ struct extent_s {
 #define EXTENT_BITS_STATE_MASK \
     ((uint64_t)0x3U << EXTENT_BITS_STATE_SHIFT)
 
-#define EXTENT_BITS_SZIND_SHIFT		(MALLOCX_ARENA_BITS + 5)
+#define EXTENT_BITS_INTERIOR_STALE_SHIFT	(MALLOCX_ARENA_BITS + 5)
+#define EXTENT_BITS_INTERIOR_STALE_MASK \
+    ((uint64_t)0x1U << EXTENT_BITS_INTERIOR_STALE_SHIFT)
+
+#define EXTENT_BITS_FRESH_SHIFT		(MALLOCX_ARENA_BITS + 6)
+#define EXTENT_BITS_FRESH_MASK \
+    ((uint64_t)0x1U << EXTENT_BITS_FRESH_SHIFT)
+
+#define EXTENT_BITS_SZIND_SHIFT		(MALLOCX_ARENA_BITS + 7)
 #define EXTENT_BITS_SZIND_MASK \
     (((uint64_t)(1U << LG_CEIL_NSIZES) - 1) << EXTENT_BITS_SZIND_SHIFT)
 
 #define EXTENT_BITS_NFREE_SHIFT \
-    (MALLOCX_ARENA_BITS + 5 + LG_CEIL_NSIZES)
+    (MALLOCX_ARENA_BITS + 7 + LG_CEIL_NSIZES)
 #define EXTENT_BITS_NFREE_MASK \
     ((uint64_t)((1U << (LG_SLAB_MAXREGS + 1)) - 1) << EXTENT_BITS_NFREE_SHIFT)
 
 #define EXTENT_BITS_SN_SHIFT \
-    (MALLOCX_ARENA_BITS + 5 + LG_CEIL_NSIZES + (LG_SLAB_MAXREGS + 1))
+    (MALLOCX_ARENA_BITS + 7 + LG_CEIL_NSIZES + (LG_SLAB_MAXREGS + 1))
 #define EXTENT_BITS_SN_MASK		(UINT64_MAX << EXTENT_BITS_SN_SHIFT)
 
 	/* Pointer to the extent that this structure is responsible for. */
@@ -185,6 +207,8 @@ struct extents_s {
 	 * state of the extents_t).
 	 */
 	atomic_zu_t		npages;
+	/* Subset of npages in fresh extents; same synchronization. */
+	atomic_zu_t		nfresh_pages;
 
 	/* All stored extents must be in the same state. */
 	extent_state_t		state;
@@ -196,4 +220,26 @@ struct extents_s {
 	bool			delay_coalesce;
 };
 
+/* Huge page hint last applied to a region of an extent_mapping_t. */
+typedef enum {
+	extent_thp_hint_none		= 0,
+	extent_thp_hint_huge		= 1,
+	/* Advised huge, but collapsing has failed so far. */
+	extent_thp_hint_collapse	= 2,
+	extent_thp_hint_nohuge		= 3
+} extent_thp_hint_t;
+
+/*
+ * A mapping obtained to grow retained memory, tracked for opt.thp_policy.
+ * Immutable once published, except for hints, which only the background
+ * thread scanning the arena accesses.
+ */
+struct extent_mapping_s {
+	extent_mapping_t	*next;
+	void			*addr;
+	size_t			size;
+	/* One extent_thp_hint_t per huge page within [addr, addr+size). */
+	uint8_t			*hints;
+};
+
 #endif /* JEMALLOC_INTERNAL_EXTENT_STRUCTS_H */
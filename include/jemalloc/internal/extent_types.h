@@ -3,7 +3,49 @@
 
 typedef struct extent_s extent_t;
 typedef struct extents_s extents_t;
+typedef struct extent_mapping_s extent_mapping_t;
 
 #define EXTENT_HOOKS_INITIALIZER	NULL
 
+/*
+ * Maximum number of extents extents_dalloc_list() records per acquisition of
+ * the extents_t mutex.
+ */
+#define EXTENTS_DALLOC_LIST_BATCH	32
+
+/* Extent selection policies for recycling from extents_t (opt.extent_fit). */
+typedef enum {
+	/*
+	 * Best-fit for extents that delay coalescing (dirty), first-fit (i.e.
+	 * oldest/lowest across all sufficiently large size classes) otherwise.
+	 */
+	extent_fit_default	= 0,
+	/*
+	 * Segregated fit: the oldest/lowest extent in the smallest non-empty
+	 * size class that fits, regardless of extents_t.
+	 */
+	extent_fit_segregated	= 1,
+	extent_fit_limit	= 2
+} extent_fit_t;
+#define EXTENT_FIT_DEFAULT	extent_fit_default
+
+/*
+ * Default for opt.zero_purge_threshold: always zero reused memory by forced
+ * purging, as has always been done for the default extent hooks.
+ */
+#define ZERO_PURGE_THRESHOLD_DEFAULT	((size_t)0)
+
+/* Transparent huge page policy for arena memory (opt.thp_policy). */
+typedef enum {
+	/* Leave huge pages to the system-wide THP setting. */
+	thp_policy_default	= 0,
+	/*
+	 * Background threads request huge pages for fully active huge page
+	 * regions, and opt sparsely used ones out of them.
+	 */
+	thp_policy_dense	= 1,
+	thp_policy_limit	= 2
+} thp_policy_t;
+#define THP_POLICY_DEFAULT	thp_policy_default
+
 #endif /* JEMALLOC_INTERNAL_EXTENT_TYPES_H */
@@ -17,6 +17,7 @@ extern bool opt_junk_free;
 extern bool opt_utrace;
 extern bool opt_xmalloc;
 extern bool opt_zero;
+extern bool opt_sized_dealloc_check;
 extern unsigned opt_narenas;
 
 /* Number of CPUs. */
@@ -49,5 +50,8 @@ void jemalloc_prefork(void);
 void jemalloc_postfork_parent(void);
 void jemalloc_postfork_child(void);
 bool malloc_initialized(void);
+void *malloc_default(size_t size);
+void free_default(void *ptr);
+void sdallocx_default(void *ptr, size_t size, int flags);
 
 #endif /* JEMALLOC_INTERNAL_EXTERNS_H */
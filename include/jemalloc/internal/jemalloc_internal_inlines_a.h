@@ -118,6 +118,12 @@ tcache_large_bin_get(tcache_t *tcache, szind_t binind) {
 	return &tcache->tbins_large[binind - NBINS];
 }
 
+JEMALLOC_ALWAYS_INLINE tcache_bin_stats_t *
+tcache_bin_stats_get(tcache_t *tcache, szind_t binind) {
+	assert(binind < nhbins);
+	return &tcache->tstats[binind];
+}
+
 JEMALLOC_ALWAYS_INLINE bool
 tcache_available(tsd_t *tsd) {
 	/*
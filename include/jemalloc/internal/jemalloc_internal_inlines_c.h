@@ -194,4 +194,138 @@ ixalloc(tsdn_t *tsdn, void *ptr, size_t oldsize, size_t size, size_t extra,
 	return arena_ralloc_no_move(tsdn, ptr, oldsize, size, extra, zero);
 }
 
+/*
+ * malloc() fast path: a small request on a thread in the nominal state, served
+ * from a non-empty tcache bin without triggering a thread event.  Everything
+ * else, including initialization, is left to fallback_alloc, which the
+ * compiler can reach via a tail call.  Inlined into both je_malloc() and the
+ * C++ operator new entry points.
+ */
+JEMALLOC_ALWAYS_INLINE void *
+imalloc_fastpath(size_t size, void *(*fallback_alloc)(size_t)) {
+	/*
+	 * malloc_slow is only cleared by malloc_init_hard_finish(), so this also
+	 * covers the not-yet-initialized case.
+	 */
+	if (unlikely(malloc_slow)) {
+		return fallback_alloc(size);
+	}
+	tsd_t *tsd = tsd_get(false);
+	/*
+	 * size - 1 wraps around for malloc(0), which sz_size2index() does not
+	 * accept, so a single comparison sends both 0 and large sizes to the
+	 * slow path.
+	 */
+	if (unlikely(tsd == NULL || !tsd_fast(tsd) || size - 1 >=
+	    SMALL_MAXCLASS)) {
+		return fallback_alloc(size);
+	}
+
+	szind_t ind = sz_size2index(size);
+	size_t usize = sz_index2size(ind);
+	assert(ind < NBINS);
+
+	/*
+	 * Thread events (tcache GC and prof sampling) share one threshold, so a
+	 * single comparison tells whether the slow path has work to do.
+	 */
+	uint64_t *allocatedp = tsd_thread_allocatedp_get(tsd);
+	uint64_t allocated_after = *allocatedp + usize;
+	if (unlikely(allocated_after >=
+	    *tsd_thread_allocated_next_eventp_get(tsd))) {
+		return fallback_alloc(size);
+	}
+
+	tcache_t *tcache = tsd_tcachep_get(tsd);
+	tcache_bin_t *tbin = tcache_small_bin_get(tcache, ind);
+	bool tcache_success;
+	void *ret = tcache_alloc_easy(tbin, &tcache_success);
+	if (unlikely(!tcache_success)) {
+		return fallback_alloc(size);
+	}
+
+	*allocatedp = allocated_after;
+	if (config_stats) {
+		tcache_bin_stats_get(tcache, ind)->nrequests++;
+	}
+	if (config_prof) {
+		tcache->prof_accumbytes += usize;
+	}
+	return ret;
+}
+
+/*
+ * free()/sdallocx() fast path, the counterpart of imalloc_fastpath().  Returns
+ * false if ptr must go through the default path instead.  Only slab-backed
+ * objects are handled; sampled objects are never slab-backed, so they need no
+ * prof bookkeeping here.
+ *
+ * Without a size hint, szind and slab come from the rtree_ctx L1 cache.  With
+ * one, the rtree is avoided altogether unless a promoted sampled object could
+ * be mistaken for a small one.  Those are page-aligned unless
+ * config_cache_oblivious randomizes their offset, in which case the L1 cache
+ * has to be consulted after all.
+ */
+JEMALLOC_ALWAYS_INLINE bool
+free_fastpath(void *ptr, size_t size, bool size_hint) {
+	if (unlikely(ptr == NULL)) {
+		return false;
+	}
+	tsd_t *tsd = tsd_get(false);
+	if (unlikely(tsd == NULL || !tsd_fast(tsd))) {
+		return false;
+	}
+
+	szind_t szind;
+	bool slab;
+	if (size_hint && (!(config_prof && opt_prof) ||
+	    !config_cache_oblivious)) {
+		if (unlikely(size > SMALL_MAXCLASS)) {
+			return false;
+		}
+		if (config_prof && opt_prof &&
+		    unlikely(((uintptr_t)ptr & PAGE_MASK) == 0)) {
+			return false;
+		}
+		szind = sz_size2index(size);
+		slab = true;
+		if (config_debug) {
+			assert(szind == rtree_szind_read(tsd_tsdn(tsd),
+			    &extents_rtree, tsd_rtree_ctx(tsd), (uintptr_t)ptr,
+			    true));
+		}
+	} else {
+		rtree_ctx_t *rtree_ctx = tsd_rtree_ctx(tsd);
+		if (unlikely(!rtree_szind_slab_read_fast(tsd_tsdn(tsd),
+		    &extents_rtree, rtree_ctx, (uintptr_t)ptr, &szind, &slab) ||
+		    !slab)) {
+			return false;
+		}
+		assert(!size_hint || szind == sz_size2index(size));
+	}
+	assert(szind < NBINS);
+
+	size_t usize = sz_index2size(szind);
+	uint64_t *deallocatedp = tsd_thread_deallocatedp_get(tsd);
+	uint64_t deallocated_after = *deallocatedp + usize;
+	if (unlikely(deallocated_after >=
+	    *tsd_thread_deallocated_next_eventp_get(tsd))) {
+		return false;
+	}
+
+	tcache_t *tcache = tsd_tcachep_get(tsd);
+	tcache_bin_t *tbin = tcache_small_bin_get(tcache, szind);
+	if (unlikely(tbin->ncached == tbin->ncached_max)) {
+		return false;
+	}
+	if (unlikely(tbin->ncached < tbin->nzeroed)) {
+		tbin->nzeroed = tbin->ncached;
+	}
+	tbin->ncached++;
+	*(tbin->avail - tbin->ncached) = ptr;
+
+	*deallocatedp = deallocated_after;
+	return true;
+}
+
 #endif /* JEMALLOC_INTERNAL_INLINES_C_H */
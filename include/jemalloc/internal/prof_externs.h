@@ -2,6 +2,7 @@
 #define JEMALLOC_INTERNAL_PROF_EXTERNS_H
 
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/prof_hook.h"
 
 extern malloc_mutex_t	bt2gctx_mtx;
 
@@ -42,12 +43,21 @@ extern uint64_t	prof_interval;
  */
 extern size_t	lg_prof_sample;
 
-void prof_alloc_rollback(tsd_t *tsd, prof_tctx_t *tctx, bool updated);
+void prof_alloc_rollback(tsd_t *tsd, prof_tctx_t *tctx);
 void prof_malloc_sample_object(tsdn_t *tsdn, const void *ptr, size_t usize,
     prof_tctx_t *tctx);
+void prof_sample_free_event(tsd_t *tsd, const void *ptr, size_t usize);
 void prof_free_sampled_object(tsd_t *tsd, size_t usize, prof_tctx_t *tctx);
 void bt_init(prof_bt_t *bt, void **vec);
-void prof_backtrace(prof_bt_t *bt);
+void prof_backtrace(tsd_t *tsd, prof_bt_t *bt);
+void prof_backtrace_hook_set(prof_backtrace_hook_t hook);
+prof_backtrace_hook_t prof_backtrace_hook_get(void);
+void prof_dump_hook_set(prof_dump_hook_t hook);
+prof_dump_hook_t prof_dump_hook_get(void);
+void prof_sample_hook_set(prof_sample_hook_t hook);
+prof_sample_hook_t prof_sample_hook_get(void);
+void prof_sample_free_hook_set(prof_sample_free_hook_t hook);
+prof_sample_free_hook_t prof_sample_free_hook_get(void);
 prof_tctx_t *prof_lookup(tsd_t *tsd, prof_bt_t *bt);
 #ifdef JEMALLOC_JET
 size_t prof_tdata_count(void);
@@ -64,7 +74,13 @@ void prof_cnt_all(uint64_t *curobjs, uint64_t *curbytes, uint64_t *accumobjs,
 #endif
 bool prof_accum_init(tsdn_t *tsdn, prof_accum_t *prof_accum);
 void prof_idump(tsdn_t *tsdn);
+void prof_dump_stats_get(tsdn_t *tsdn, uint64_t *duration_ns,
+    uint64_t *nbytes);
 bool prof_mdump(tsd_t *tsd, const char *filename);
+bool prof_dump_baseline(tsd_t *tsd);
+bool prof_dump_diff(tsd_t *tsd, const char *filename);
+size_t prof_dump_diff_threshold_get(tsdn_t *tsdn);
+size_t prof_dump_diff_threshold_set(tsdn_t *tsdn, size_t threshold);
 void prof_gdump(tsdn_t *tsdn);
 prof_tdata_t *prof_tdata_init(tsd_t *tsd);
 prof_tdata_t *prof_tdata_reinit(tsd_t *tsd, prof_tdata_t *tdata);
@@ -76,6 +92,9 @@ const char *prof_thread_name_get(tsd_t *tsd);
 int prof_thread_name_set(tsd_t *tsd, const char *thread_name);
 bool prof_thread_active_get(tsd_t *tsd);
 bool prof_thread_active_set(tsd_t *tsd, bool active);
+unsigned prof_thread_tag_get(tsd_t *tsd);
+bool prof_thread_tag_set(tsd_t *tsd, unsigned tag);
+void prof_tag_stats_get(unsigned tag, size_t *curobjs, size_t *curbytes);
 bool prof_thread_active_init_get(tsdn_t *tsdn);
 bool prof_thread_active_init_set(tsdn_t *tsdn, bool active_init);
 bool prof_gdump_get(tsdn_t *tsdn);
@@ -87,6 +106,6 @@ void prof_prefork0(tsdn_t *tsdn);
 void prof_prefork1(tsdn_t *tsdn);
 void prof_postfork_parent(tsdn_t *tsdn);
 void prof_postfork_child(tsdn_t *tsdn);
-void prof_sample_threshold_update(prof_tdata_t *tdata);
+uint64_t prof_sample_new_event_wait(tsd_t *tsd);
 
 #endif /* JEMALLOC_INTERNAL_PROF_EXTERNS_H */
@@ -0,0 +1,27 @@
+#ifndef JEMALLOC_INTERNAL_PROF_HOOK_H
+#define JEMALLOC_INTERNAL_PROF_HOOK_H
+
+/*
+ * The hooks declared in this file are installed via the experimental.hooks.*
+ * mallctls.  They are not part of the stable API, which is why the typedefs
+ * live in an internal header.
+ */
+
+/*
+ * Replaces the built-in unwinder.  Fills in up to max_len frames of the
+ * calling thread's stack and stores the number of frames in *len.
+ */
+typedef void (*prof_backtrace_hook_t)(void **vec, unsigned *len,
+    unsigned max_len);
+
+/* Called with the filename after each successful heap profile dump. */
+typedef void (*prof_dump_hook_t)(const char *filename);
+
+/* Called after an allocation has been sampled. */
+typedef void (*prof_sample_hook_t)(const void *ptr, size_t size,
+    void **backtrace, unsigned backtrace_length);
+
+/* Called when a sampled allocation is freed. */
+typedef void (*prof_sample_free_hook_t)(const void *ptr, size_t size);
+
+#endif /* JEMALLOC_INTERNAL_PROF_HOOK_H */
@@ -15,7 +15,8 @@ struct prof_bt_s {
 #ifdef JEMALLOC_PROF_LIBGCC
 /* Data structure passed to libgcc _Unwind_Backtrace() callback functions. */
 typedef struct {
-	prof_bt_t	*bt;
+	void		**vec;
+	unsigned	*len;
 	unsigned	max;
 } prof_unwind_data_t;
 #endif
@@ -44,6 +45,13 @@ typedef enum {
 	prof_tctx_state_purgatory /* Dumper must finish destroying. */
 } prof_tctx_state_t;
 
+struct prof_tctx_key_s {
+	/* Backtrace, owned by the associated gctx. */
+	prof_bt_t		*bt;
+	/* Thread's thread.prof.tag at the time the tctx was created. */
+	unsigned		tag;
+};
+
 struct prof_tctx_s {
 	/* Thread data for thread that performed the allocation. */
 	prof_tdata_t		*tdata;
@@ -61,6 +69,9 @@ struct prof_tctx_s {
 	/* Associated global context. */
 	prof_gctx_t		*gctx;
 
+	/* Key in tdata->bt2tctx. */
+	prof_tctx_key_t		key;
+
 	/*
 	 * UID that distinguishes multiple tctx's created by the same thread,
 	 * but coexisting in gctx->tctxs.  There are two ways that such
@@ -121,9 +132,32 @@ struct prof_gctx_s {
 	/* Linkage for tree of contexts to be dumped. */
 	rb_node(prof_gctx_t)	dump_link;
 
+	/*
+	 * True if this gctx was captured during the early phase of the dump
+	 * that is currently in progress.  gctx's created after that phase are
+	 * ignored by the dumper.
+	 */
+	bool			dumping;
+
+	/*
+	 * Number of tctx's captured by the current dump, i.e. those in the
+	 * dumping or purgatory state.  This cannot change until the dump
+	 * finishes, so it can be used to size the dump snapshot.
+	 */
+	size_t			dump_ntctxs;
+
 	/* Temporary storage for summation during dump. */
 	prof_cnt_t		cnt_summed;
 
+	/*
+	 * Live counters as of the most recent prof.dump_baseline, valid only if
+	 * baseline_seq matches the current baseline sequence number.  Protected
+	 * by prof_dump_mtx.
+	 */
+	uint64_t		baseline_seq;
+	uint64_t		baseline_curobjs;
+	uint64_t		baseline_curbytes;
+
 	/* Associated backtrace. */
 	prof_bt_t		bt;
 
@@ -147,6 +181,12 @@ struct prof_tdata_s {
 	/* Included in heap profile dumps if non-NULL. */
 	char			*thread_name;
 
+	/*
+	 * Tag attributed to this thread's sampled allocations, in
+	 * [0..PROF_NTAGS).  Only modified by the owning thread.
+	 */
+	unsigned		tag;
+
 	bool			attached;
 	bool			expired;
 
@@ -160,17 +200,14 @@ struct prof_tdata_s {
 	uint64_t		tctx_uid_next;
 
 	/*
-	 * Hash of (prof_bt_t *)-->(prof_tctx_t *).  Each thread tracks
-	 * backtraces for which it has non-zero allocation/deallocation counters
-	 * associated with thread-specific prof_tctx_t objects.  Other threads
-	 * may write to prof_tctx_t contents when freeing associated objects.
+	 * Hash of (prof_tctx_key_t *)-->(prof_tctx_t *).  Each thread tracks
+	 * (backtrace, tag) pairs for which it has non-zero
+	 * allocation/deallocation counters associated with thread-specific
+	 * prof_tctx_t objects.  Other threads may write to prof_tctx_t contents
+	 * when freeing associated objects.
 	 */
 	ckh_t			bt2tctx;
 
-	/* Sampling state. */
-	uint64_t		prng_state;
-	uint64_t		bytes_until_sample;
-
 	/* State used to avoid dumping while operating on prof internals. */
 	bool			enq;
 	bool			enq_idump;
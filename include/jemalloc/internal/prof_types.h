@@ -4,6 +4,7 @@
 typedef struct prof_bt_s prof_bt_t;
 typedef struct prof_accum_s prof_accum_t;
 typedef struct prof_cnt_s prof_cnt_t;
+typedef struct prof_tctx_key_s prof_tctx_key_t;
 typedef struct prof_tctx_s prof_tctx_t;
 typedef struct prof_gctx_s prof_gctx_t;
 typedef struct prof_tdata_s prof_tdata_t;
@@ -24,6 +25,9 @@ typedef struct prof_tdata_s prof_tdata_t;
  */
 #define PROF_BT_MAX			128
 
+/* Number of distinct thread.prof.tag values. */
+#define PROF_NTAGS			256
+
 /* Initial hash table size. */
 #define PROF_CKH_MINITEMS		64
 
@@ -38,6 +38,14 @@
 /* Needed for initialization only. */
 #define RTREE_LEAFKEY_INVALID ((uintptr_t)1)
 
+#ifdef JEMALLOC_RTREE_FLAT
+/*
+ * Size of the flat leaf array, which has one element per page of the address
+ * space (512 GiB of virtual memory for 48-bit addresses and 4 KiB pages).
+ */
+#  define RTREE_FLAT_SIZE ((ZU(1) << RTREE_NSB) * sizeof(rtree_leaf_elm_t))
+#endif
+
 typedef struct rtree_node_elm_s rtree_node_elm_t;
 struct rtree_node_elm_s {
 	atomic_p_t	child; /* (rtree_{node,leaf}_elm_t *) */
@@ -78,6 +86,15 @@ struct rtree_level_s {
 
 typedef struct rtree_s rtree_t;
 struct rtree_s {
+#ifdef JEMALLOC_RTREE_FLAT
+	/*
+	 * If non-NULL, the leaf level as a single array indexed by page number,
+	 * in which case the tree below is unused.  Only address space is
+	 * reserved for it up front; pages are committed by the kernel as they
+	 * are first written.
+	 */
+	rtree_leaf_elm_t	*flat;
+#endif
 	malloc_mutex_t		init_lock;
 	/* Number of elements based on rtree_levels[0].bits. */
 #if RTREE_HEIGHT > 1
@@ -109,6 +126,8 @@ static const rtree_level_t rtree_levels[] = {
 #endif
 };
 
+extern bool opt_rtree_flat;
+
 bool rtree_new(rtree_t *rtree, bool zeroed);
 
 typedef rtree_node_elm_t *(rtree_node_alloc_t)(tsdn_t *, rtree_t *, size_t);
@@ -138,13 +157,33 @@ rtree_leafkey(uintptr_t key) {
 	return (key & mask);
 }
 
+/* Returns the L1 slot of way 0 of the set that key maps to. */
 JEMALLOC_ALWAYS_INLINE size_t
 rtree_cache_direct_map(uintptr_t key) {
 	unsigned ptrbits = ZU(1) << (LG_SIZEOF_PTR+3);
 	unsigned cumbits = (rtree_levels[RTREE_HEIGHT-1].cumbits -
 	    rtree_levels[RTREE_HEIGHT-1].bits);
 	unsigned maskbits = ptrbits - cumbits;
-	return (size_t)((key >> maskbits) & (RTREE_CTX_NCACHE - 1));
+	return (size_t)((key >> maskbits) & (RTREE_CTX_NSETS - 1)) <<
+	    RTREE_CTX_LG_ASSOC;
+}
+
+/*
+ * Makes leafkey/leaf the MRU entry of the L1 set starting at slot, and returns
+ * the LRU entry that it displaces, which the caller moves down to L2.
+ */
+JEMALLOC_ALWAYS_INLINE rtree_ctx_cache_elm_t
+rtree_cache_l1_insert(rtree_ctx_t *rtree_ctx, size_t slot, uintptr_t leafkey,
+    rtree_leaf_elm_t *leaf) {
+	rtree_ctx_cache_elm_t victim = rtree_ctx->cache[slot +
+	    RTREE_CTX_ASSOC - 1];
+	if (RTREE_CTX_ASSOC > 1) {
+		memmove(&rtree_ctx->cache[slot + 1], &rtree_ctx->cache[slot],
+		    sizeof(rtree_ctx_cache_elm_t) * (RTREE_CTX_ASSOC - 1));
+	}
+	rtree_ctx->cache[slot].leafkey = leafkey;
+	rtree_ctx->cache[slot].leaf = leaf;
+	return victim;
 }
 
 JEMALLOC_ALWAYS_INLINE uintptr_t
@@ -157,6 +196,22 @@ rtree_subkey(uintptr_t key, unsigned level) {
 	return ((key >> shiftbits) & mask);
 }
 
+static inline bool
+rtree_flat_enabled(const rtree_t *rtree) {
+#ifdef JEMALLOC_RTREE_FLAT
+	return rtree->flat != NULL;
+#else
+	return false;
+#endif
+}
+
+#ifdef JEMALLOC_RTREE_FLAT
+JEMALLOC_ALWAYS_INLINE rtree_leaf_elm_t *
+rtree_flat_elm(rtree_t *rtree, uintptr_t key) {
+	return &rtree->flat[(key >> RTREE_NLIB) & ((ZU(1) << RTREE_NSB) - 1)];
+}
+#endif
+
 /*
  * Atomic getters.
  *
@@ -279,13 +334,20 @@ rtree_leaf_elm_slab_write(tsdn_t *tsdn, rtree_t *rtree, rtree_leaf_elm_t *elm,
 #endif
 }
 
+#ifdef RTREE_LEAF_COMPACT
+JEMALLOC_ALWAYS_INLINE uintptr_t
+rtree_leaf_elm_bits_encode(extent_t *extent, szind_t szind, bool slab) {
+	return ((uintptr_t)szind << LG_VADDR) |
+	    ((uintptr_t)extent & (((uintptr_t)0x1 << LG_VADDR) - 1)) |
+	    ((uintptr_t)slab);
+}
+#endif
+
 static inline void
 rtree_leaf_elm_write(tsdn_t *tsdn, rtree_t *rtree, rtree_leaf_elm_t *elm,
     extent_t *extent, szind_t szind, bool slab) {
 #ifdef RTREE_LEAF_COMPACT
-	uintptr_t bits = ((uintptr_t)szind << LG_VADDR) |
-	    ((uintptr_t)extent & (((uintptr_t)0x1 << LG_VADDR) - 1)) |
-	    ((uintptr_t)slab);
+	uintptr_t bits = rtree_leaf_elm_bits_encode(extent, szind, slab);
 	atomic_store_p(&elm->le_bits, (void *)bits, ATOMIC_RELEASE);
 #else
 	rtree_leaf_elm_slab_write(tsdn, rtree, elm, slab);
@@ -317,43 +379,68 @@ rtree_leaf_elm_lookup(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
 	assert(key != 0);
 	assert(!dependent || !init_missing);
 
+#ifdef JEMALLOC_RTREE_FLAT
+	/* One index computation and one load; the cache is bypassed. */
+	if (likely(rtree->flat != NULL)) {
+		return rtree_flat_elm(rtree, key);
+	}
+#endif
+
 	size_t slot = rtree_cache_direct_map(key);
 	uintptr_t leafkey = rtree_leafkey(key);
 	assert(leafkey != RTREE_LEAFKEY_INVALID);
 
-	/* Fast path: L1 direct mapped cache. */
+	/* Fast path: L1 direct mapped cache (way 0 of the set). */
 	if (likely(rtree_ctx->cache[slot].leafkey == leafkey)) {
 		rtree_leaf_elm_t *leaf = rtree_ctx->cache[slot].leaf;
 		assert(leaf != NULL);
+		if (config_rtree_ctx_stats) {
+			rtree_ctx->stats.l1_hits++;
+		}
 		uintptr_t subkey = rtree_subkey(key, RTREE_HEIGHT-1);
 		return &leaf[subkey];
 	}
+	/*
+	 * Search the remaining ways of the L1 set, if any.  On hit, move the
+	 * matching element to the front of the set.
+	 */
+	for (unsigned i = 1; i < RTREE_CTX_ASSOC; i++) {
+		if (rtree_ctx->cache[slot + i].leafkey == leafkey) {
+			rtree_leaf_elm_t *leaf = rtree_ctx->cache[slot + i].leaf;
+			assert(leaf != NULL);
+			if (config_rtree_ctx_stats) {
+				rtree_ctx->stats.l1_hits++;
+			}
+			memmove(&rtree_ctx->cache[slot + 1],
+			    &rtree_ctx->cache[slot],
+			    sizeof(rtree_ctx_cache_elm_t) * i);
+			rtree_ctx->cache[slot].leafkey = leafkey;
+			rtree_ctx->cache[slot].leaf = leaf;
+			uintptr_t subkey = rtree_subkey(key, RTREE_HEIGHT-1);
+			return &leaf[subkey];
+		}
+	}
 	/*
 	 * Search the L2 LRU cache.  On hit, swap the matching element into the
-	 * slot in L1 cache, and move the position in L2 up by 1.
+	 * L1 set (displacing its LRU way), and move the position in L2 up by 1.
 	 */
 #define RTREE_CACHE_CHECK_L2(i) do {					\
 	if (likely(rtree_ctx->l2_cache[i].leafkey == leafkey)) {	\
 		rtree_leaf_elm_t *leaf = rtree_ctx->l2_cache[i].leaf;	\
 		assert(leaf != NULL);					\
+		if (config_rtree_ctx_stats) {					\
+			rtree_ctx->stats.l2_hits++;			\
+		}							\
+		rtree_ctx_cache_elm_t victim = rtree_cache_l1_insert(	\
+		    rtree_ctx, slot, leafkey, leaf);			\
 		if (i > 0) {						\
 			/* Bubble up by one. */				\
-			rtree_ctx->l2_cache[i].leafkey =		\
-				rtree_ctx->l2_cache[i - 1].leafkey;	\
-			rtree_ctx->l2_cache[i].leaf =			\
-				rtree_ctx->l2_cache[i - 1].leaf;	\
-			rtree_ctx->l2_cache[i - 1].leafkey =		\
-			    rtree_ctx->cache[slot].leafkey;		\
-			rtree_ctx->l2_cache[i - 1].leaf =		\
-			    rtree_ctx->cache[slot].leaf;		\
+			rtree_ctx->l2_cache[i] =			\
+			    rtree_ctx->l2_cache[i - 1];			\
+			rtree_ctx->l2_cache[i - 1] = victim;		\
 		} else {						\
-			rtree_ctx->l2_cache[0].leafkey =		\
-			    rtree_ctx->cache[slot].leafkey;		\
-			rtree_ctx->l2_cache[0].leaf =			\
-			    rtree_ctx->cache[slot].leaf;		\
+			rtree_ctx->l2_cache[0] = victim;		\
 		}							\
-		rtree_ctx->cache[slot].leafkey = leafkey;		\
-		rtree_ctx->cache[slot].leaf = leaf;			\
 		uintptr_t subkey = rtree_subkey(key, RTREE_HEIGHT-1);	\
 		return &leaf[subkey];					\
 	}								\
@@ -366,6 +453,9 @@ rtree_leaf_elm_lookup(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
 	}
 #undef RTREE_CACHE_CHECK_L2
 
+	if (config_rtree_ctx_stats) {
+		rtree_ctx->stats.misses++;
+	}
 	return rtree_leaf_elm_lookup_hard(tsdn, rtree, rtree_ctx, key,
 	    dependent, init_missing);
 }
@@ -388,6 +478,59 @@ rtree_write(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx, uintptr_t key,
 	return false;
 }
 
+/*
+ * Writes the same mapping for each of the npages pages starting at key.  Each
+ * leaf is looked up only once; the elements for consecutive pages within a
+ * leaf are contiguous, so they are filled in with a tight store loop.
+ */
+static inline bool
+rtree_write_range_impl(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
+    uintptr_t key, size_t npages, extent_t *extent, szind_t szind,
+    bool slab) {
+	unsigned ptrbits = ZU(1) << (LG_SIZEOF_PTR+3);
+	unsigned cumbits = (rtree_levels[RTREE_HEIGHT-1].cumbits -
+	    rtree_levels[RTREE_HEIGHT-1].bits);
+	/* Number of pages covered by a single leaf. */
+	size_t leaf_npages = ZU(1) << (ptrbits - cumbits - LG_PAGE);
+#ifdef RTREE_LEAF_COMPACT
+	void *bits = (void *)rtree_leaf_elm_bits_encode(extent, szind, slab);
+#endif
+
+	while (npages > 0) {
+		rtree_leaf_elm_t *elm = rtree_leaf_elm_lookup(tsdn, rtree,
+		    rtree_ctx, key, false, true);
+		if (elm == NULL) {
+			return true;
+		}
+		size_t n = leaf_npages - ((key - rtree_leafkey(key)) >>
+		    LG_PAGE);
+		if (n > npages) {
+			n = npages;
+		}
+		for (size_t i = 0; i < n; i++) {
+#ifdef RTREE_LEAF_COMPACT
+			atomic_store_p(&elm[i].le_bits, bits, ATOMIC_RELEASE);
+#else
+			rtree_leaf_elm_write(tsdn, rtree, &elm[i], extent,
+			    szind, slab);
+#endif
+		}
+		key += (uintptr_t)n << LG_PAGE;
+		npages -= n;
+	}
+	return false;
+}
+
+static inline bool
+rtree_write_range(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
+    uintptr_t key, size_t npages, extent_t *extent, szind_t szind,
+    bool slab) {
+	/* Use rtree_clear_range() to set the extent to NULL. */
+	assert(extent != NULL);
+	return rtree_write_range_impl(tsdn, rtree, rtree_ctx, key, npages,
+	    extent, szind, slab);
+}
+
 JEMALLOC_ALWAYS_INLINE rtree_leaf_elm_t *
 rtree_read(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx, uintptr_t key,
     bool dependent) {
@@ -453,6 +596,48 @@ rtree_szind_slab_read(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
 	return false;
 }
 
+/*
+ * Reads szind and slab for key, but only if its leaf is in the L1 cache (or the
+ * leaf level is flat), so that no locks, loops, or further pointer chasing are
+ * involved.  Returns true on a hit.  Unlike the other readers, key may be 0, in
+ * which case the lookup misses or reads an unregistered element.
+ */
+JEMALLOC_ALWAYS_INLINE bool
+rtree_szind_slab_read_fast(tsdn_t *tsdn, rtree_t *rtree,
+    rtree_ctx_t *rtree_ctx, uintptr_t key, szind_t *r_szind, bool *r_slab) {
+	rtree_leaf_elm_t *elm;
+#ifdef JEMALLOC_RTREE_FLAT
+	if (likely(rtree->flat != NULL)) {
+		/* Every key hits. */
+		elm = rtree_flat_elm(rtree, key);
+	} else
+#endif
+	{
+		size_t slot = rtree_cache_direct_map(key);
+		uintptr_t leafkey = rtree_leafkey(key);
+		assert(leafkey != RTREE_LEAFKEY_INVALID);
+
+		if (unlikely(rtree_ctx->cache[slot].leafkey != leafkey)) {
+			return false;
+		}
+		rtree_leaf_elm_t *leaf = rtree_ctx->cache[slot].leaf;
+		assert(leaf != NULL);
+		if (config_rtree_ctx_stats) {
+			rtree_ctx->stats.l1_hits++;
+		}
+		elm = &leaf[rtree_subkey(key, RTREE_HEIGHT-1)];
+	}
+#ifdef RTREE_LEAF_COMPACT
+	uintptr_t bits = rtree_leaf_elm_bits_read(tsdn, rtree, elm, true);
+	*r_szind = rtree_leaf_elm_bits_szind_get(bits);
+	*r_slab = rtree_leaf_elm_bits_slab_get(bits);
+#else
+	*r_szind = rtree_leaf_elm_szind_read(tsdn, rtree, elm, true);
+	*r_slab = rtree_leaf_elm_slab_read(tsdn, rtree, elm, true);
+#endif
+	return true;
+}
+
 static inline void
 rtree_szind_slab_update(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
     uintptr_t key, szind_t szind, bool slab) {
@@ -471,4 +656,13 @@ rtree_clear(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
 	rtree_leaf_elm_write(tsdn, rtree, elm, NULL, NSIZES, false);
 }
 
+static inline void
+rtree_clear_range(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
+    uintptr_t key, size_t npages) {
+	/* The leaves were initialized when the mappings were written. */
+	bool err = rtree_write_range_impl(tsdn, rtree, rtree_ctx, key, npages,
+	    NULL, NSIZES, false);
+	assert(!err);
+}
+
 #endif /* JEMALLOC_INTERNAL_RTREE_H */
@@ -17,10 +17,36 @@
  * on access but suffers no collision.  Note that, the cache will itself suffer
  * cache misses if made overly large, plus the cost of linear search in the LRU
  * cache.
+ *
+ * Workloads whose heaps span many leaves may configure a larger cache (see the
+ * --with-*rtree-ctx-* configure options), and optionally make L1 set
+ * associative: each key then maps to a set of RTREE_CTX_ASSOC entries that are
+ * kept in MRU order, so that the way 0 fast path is unchanged.
  */
-#define RTREE_CTX_LG_NCACHE 4
+#ifdef JEMALLOC_RTREE_CTX_LG_NCACHE
+#  define RTREE_CTX_LG_NCACHE JEMALLOC_RTREE_CTX_LG_NCACHE
+#else
+#  define RTREE_CTX_LG_NCACHE 4
+#endif
 #define RTREE_CTX_NCACHE (1 << RTREE_CTX_LG_NCACHE)
-#define RTREE_CTX_NCACHE_L2 8
+#ifdef JEMALLOC_RTREE_CTX_LG_ASSOC
+#  define RTREE_CTX_LG_ASSOC JEMALLOC_RTREE_CTX_LG_ASSOC
+#else
+#  define RTREE_CTX_LG_ASSOC 0
+#endif
+#if RTREE_CTX_LG_ASSOC > RTREE_CTX_LG_NCACHE
+#  error "rtree_ctx associativity exceeds the number of L1 entries"
+#endif
+#define RTREE_CTX_ASSOC (1 << RTREE_CTX_LG_ASSOC)
+#define RTREE_CTX_NSETS (1 << (RTREE_CTX_LG_NCACHE - RTREE_CTX_LG_ASSOC))
+#ifdef JEMALLOC_RTREE_CTX_NCACHE_L2
+#  define RTREE_CTX_NCACHE_L2 JEMALLOC_RTREE_CTX_NCACHE_L2
+#else
+#  define RTREE_CTX_NCACHE_L2 8
+#endif
+#if RTREE_CTX_NCACHE_L2 < 1
+#  error "rtree_ctx requires at least one L2 entry"
+#endif
 
 /*
  * Zero initializer required for tsd initialization only.  Proper initialization
@@ -37,12 +63,21 @@ struct rtree_ctx_cache_elm_s {
 	rtree_leaf_elm_t	*leaf;
 };
 
+/* Lookup counters, only maintained if config_rtree_ctx_stats. */
+typedef struct rtree_ctx_stats_s rtree_ctx_stats_t;
+struct rtree_ctx_stats_s {
+	uint64_t		l1_hits;
+	uint64_t		l2_hits;
+	uint64_t		misses;
+};
+
 typedef struct rtree_ctx_s rtree_ctx_t;
 struct rtree_ctx_s {
-	/* Direct mapped cache. */
+	/* Direct mapped (or set associative) cache. */
 	rtree_ctx_cache_elm_t	cache[RTREE_CTX_NCACHE];
 	/* L2 LRU cache. */
 	rtree_ctx_cache_elm_t	l2_cache[RTREE_CTX_NCACHE_L2];
+	rtree_ctx_stats_t	stats;
 };
 
 void rtree_ctx_data_init(rtree_ctx_t *ctx);
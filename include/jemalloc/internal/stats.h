@@ -136,9 +136,13 @@ typedef struct arena_stats_s {
 	 * but they are excluded from the mapped statistic (above).
 	 */
 	atomic_zu_t		retained; /* Derived. */
+	/* Subset of retained bytes that have never been allocated. */
+	atomic_zu_t		retained_fresh; /* Derived. */
 
 	decay_stats_t		decay_dirty;
 	decay_stats_t		decay_muzzy;
+	/* Number of purge sweeps done by application threads. */
+	arena_stats_u64_t	npurge_inline;
 
 	atomic_zu_t		base; /* Derived. */
 	atomic_zu_t		internal;
@@ -149,6 +153,11 @@ typedef struct arena_stats_s {
 	arena_stats_u64_t	ndalloc_large; /* Derived. */
 	arena_stats_u64_t	nrequests_large; /* Derived. */
 
+	/* Number of bytes prefaulted (see opt.prefault). */
+	arena_stats_u64_t	prefaulted;
+	/* Number of bytes collapsed into huge pages (see opt.thp_policy). */
+	arena_stats_u64_t	thp_collapsed;
+
 	/* Number of bytes cached in tcache associated with this arena. */
 	atomic_zu_t		tcache_bytes; /* Derived. */
 
@@ -4,7 +4,6 @@
 #include "jemalloc/internal/jemalloc_internal_types.h"
 #include "jemalloc/internal/size_classes.h"
 #include "jemalloc/internal/sz.h"
-#include "jemalloc/internal/ticker.h"
 #include "jemalloc/internal/util.h"
 
 static inline bool
@@ -26,17 +25,6 @@ tcache_enabled_set(tsd_t *tsd, bool enabled) {
 	tsd_slow_update(tsd);
 }
 
-JEMALLOC_ALWAYS_INLINE void
-tcache_event(tsd_t *tsd, tcache_t *tcache) {
-	if (TCACHE_GC_INCR == 0) {
-		return;
-	}
-
-	if (unlikely(ticker_tick(&tcache->gc_ticker))) {
-		tcache_event_hard(tsd, tcache);
-	}
-}
-
 JEMALLOC_ALWAYS_INLINE void *
 tcache_alloc_easy(tcache_bin_t *tbin, bool *tcache_success) {
 	void *ret;
@@ -114,16 +102,22 @@ tcache_alloc_small(tsd_t *tsd, arena_t *arena, tcache_t *tcache, size_t size,
 			arena_alloc_junk_small(ret, &arena_bin_info[binind],
 			    true);
 		}
-		memset(ret, 0, usize);
+		/* ret came from avail[-(ncached + 1)]. */
+		if (tbin->ncached >= tbin->nzeroed) {
+			memset(ret, 0, usize);
+		} else if (config_debug) {
+			for (size_t i = 0; i < usize; i++) {
+				assert(((char *)ret)[i] == 0);
+			}
+		}
 	}
 
 	if (config_stats) {
-		tbin->tstats.nrequests++;
+		tcache_bin_stats_get(tcache, binind)->nrequests++;
 	}
 	if (config_prof) {
 		tcache->prof_accumbytes += usize;
 	}
-	tcache_event(tsd, tcache);
 	return ret;
 }
 
@@ -176,14 +170,13 @@ tcache_alloc_large(tsd_t *tsd, arena_t *arena, tcache_t *tcache, size_t size,
 		}
 
 		if (config_stats) {
-			tbin->tstats.nrequests++;
+			tcache_bin_stats_get(tcache, binind)->nrequests++;
 		}
 		if (config_prof) {
 			tcache->prof_accumbytes += usize;
 		}
 	}
 
-	tcache_event(tsd, tcache);
 	return ret;
 }
 
@@ -191,7 +184,6 @@ JEMALLOC_ALWAYS_INLINE void
 tcache_dalloc_small(tsd_t *tsd, tcache_t *tcache, void *ptr, szind_t binind,
     bool slow_path) {
 	tcache_bin_t *tbin;
-	tcache_bin_info_t *tbin_info;
 
 	assert(tcache_salloc(tsd_tsdn(tsd), ptr) <= SMALL_MAXCLASS);
 
@@ -200,23 +192,22 @@ tcache_dalloc_small(tsd_t *tsd, tcache_t *tcache, void *ptr, szind_t binind,
 	}
 
 	tbin = tcache_small_bin_get(tcache, binind);
-	tbin_info = &tcache_bin_info[binind];
-	if (unlikely(tbin->ncached == tbin_info->ncached_max)) {
+	if (unlikely(tbin->ncached == tbin->ncached_max)) {
 		tcache_bin_flush_small(tsd, tcache, tbin, binind,
-		    (tbin_info->ncached_max >> 1));
+		    (tbin->ncached_max >> 1));
+	}
+	assert(tbin->ncached < tbin->ncached_max);
+	if (unlikely(tbin->ncached < tbin->nzeroed)) {
+		tbin->nzeroed = tbin->ncached;
 	}
-	assert(tbin->ncached < tbin_info->ncached_max);
 	tbin->ncached++;
 	*(tbin->avail - tbin->ncached) = ptr;
-
-	tcache_event(tsd, tcache);
 }
 
 JEMALLOC_ALWAYS_INLINE void
 tcache_dalloc_large(tsd_t *tsd, tcache_t *tcache, void *ptr, szind_t binind,
     bool slow_path) {
 	tcache_bin_t *tbin;
-	tcache_bin_info_t *tbin_info;
 
 	assert(tcache_salloc(tsd_tsdn(tsd), ptr) > SMALL_MAXCLASS);
 	assert(tcache_salloc(tsd_tsdn(tsd), ptr) <= tcache_maxclass);
@@ -226,16 +217,29 @@ tcache_dalloc_large(tsd_t *tsd, tcache_t *tcache, void *ptr, szind_t binind,
 	}
 
 	tbin = tcache_large_bin_get(tcache, binind);
-	tbin_info = &tcache_bin_info[binind];
-	if (unlikely(tbin->ncached == tbin_info->ncached_max)) {
+	if (unlikely(tbin->ncached == tbin->ncached_max)) {
 		tcache_bin_flush_large(tsd, tbin, binind,
-		    (tbin_info->ncached_max >> 1), tcache);
+		    (tbin->ncached_max >> 1), tcache);
 	}
-	assert(tbin->ncached < tbin_info->ncached_max);
+	assert(tbin->ncached < tbin->ncached_max);
 	tbin->ncached++;
 	*(tbin->avail - tbin->ncached) = ptr;
+}
 
-	tcache_event(tsd, tcache);
+/*
+ * Accounts usize bytes allocated or deallocated through an explicit tcache,
+ * which isn't tied to any thread's event counters.
+ */
+JEMALLOC_ALWAYS_INLINE void
+tcache_explicit_event(tsd_t *tsd, tcache_t *tcache, size_t usize) {
+	if (unlikely(tcache == NULL)) {
+		return;
+	}
+	if (likely(tcache->gc_event_wait > usize)) {
+		tcache->gc_event_wait -= usize;
+		return;
+	}
+	tcache_explicit_event_hard(tsd, tcache);
 }
 
 JEMALLOC_ALWAYS_INLINE tcache_t *
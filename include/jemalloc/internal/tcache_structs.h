@@ -1,10 +1,10 @@
 #ifndef JEMALLOC_INTERNAL_TCACHE_STRUCTS_H
 #define JEMALLOC_INTERNAL_TCACHE_STRUCTS_H
 
+#include "jemalloc/internal/extent_types.h"
 #include "jemalloc/internal/ql.h"
 #include "jemalloc/internal/size_classes.h"
 #include "jemalloc/internal/stats_tsd.h"
-#include "jemalloc/internal/ticker.h"
 
 /*
  * Read-only information associated with each element of tcache_t's tbins array
@@ -15,14 +15,6 @@ struct tcache_bin_info_s {
 };
 
 struct tcache_bin_s {
-	low_water_t	low_water;	/* Min # cached since last GC. */
-	uint32_t	ncached;	/* # of cached objects. */
-	/*
-	 * ncached and stats are both modified frequently.  Let's keep them
-	 * close so that they have a higher chance of being on the same
-	 * cacheline, thus less write-backs.
-	 */
-	tcache_bin_stats_t tstats;
 	/*
 	 * To make use of adjacent cacheline prefetch, the items in the avail
 	 * stack goes to higher address for newer allocations.  avail points
@@ -31,26 +23,63 @@ struct tcache_bin_s {
 	 * be allocated first.
 	 */
 	void		**avail;	/* Stack of available objects. */
+	tcache_bin_sz_t	ncached;	/* # of cached objects. */
+	low_water_t	low_water;	/* Min # cached since last GC. */
+	/*
+	 * Copy of tcache_bin_info[binind].ncached_max, so that the fast paths
+	 * can check for a full bin without touching another cacheline.
+	 */
+	tcache_bin_sz_t	ncached_max;
+	/*
+	 * Small bins only: avail[-nzeroed, ... -1] (if cached) are regions
+	 * that were never allocated from zeroed slabs, so that zeroed
+	 * allocations can skip memset().  Only set by fills (which happen when
+	 * the bin is empty), and lowered as other objects are pushed in their
+	 * place.
+	 */
+	tcache_bin_sz_t	nzeroed;
 };
 
 struct tcache_s {
-	/* Data accessed frequently first: prof, ticker and small bins. */
-	uint64_t	prof_accumbytes;/* Cleared after arena_prof_accum(). */
-	ticker_t	gc_ticker;	/* Drives incremental GC. */
 	/*
+	 * Data accessed frequently first: the small bins, which only hold the
+	 * fields needed to push and pop objects, so that (with 64-bit pointers)
+	 * four of them share a cacheline and none of them straddles two.
+	 *
 	 * The pointer stacks associated with tbins follow as a contiguous
 	 * array.  During tcache initialization, the avail pointer in each
 	 * element of tbins is initialized to point to the proper offset within
 	 * this array.
 	 */
-	tcache_bin_t	tbins_small[NBINS];
+	tcache_bin_t	tbins_small[NBINS] JEMALLOC_ALIGNED(CACHELINE);
+	uint64_t	prof_accumbytes;/* Cleared after arena_prof_accum(). */
 	/* Data accessed less often below. */
 	ql_elm(tcache_t) link;		/* Used for aggregating stats. */
 	arena_t		*arena;		/* Associated arena. */
 	szind_t		next_gc_bin;	/* Next bin to GC. */
+	/*
+	 * Explicit tcaches only: bytes left to allocate or deallocate through
+	 * the tcache until its next incremental GC.  The automatic tcache is
+	 * driven by its thread's event counters instead.
+	 */
+	uint64_t	gc_event_wait;
 	/* For small bins, fill (ncached_max >> lg_fill_div). */
 	uint8_t		lg_fill_div[NBINS];
 	tcache_bin_t	tbins_large[NSIZES-NBINS];
+	/*
+	 * Auto tcaches only: extent_t structures available to extent_alloc()
+	 * for the associated arena, so that extent splits and merges need not
+	 * take the arena's extent_avail_mtx each time.  Used as a stack, most
+	 * recently cached last.
+	 */
+	extent_t	*extents_avail[TCACHE_NEXTENTS_MAX];
+	unsigned	nextents_avail;
+	/*
+	 * Per bin request counters, indexed by binind.  These are only written
+	 * on allocation, and only read when merged into the arena stats, so
+	 * they are kept apart from the bins rather than diluting them.
+	 */
+	tcache_bin_stats_t tstats[NSIZES];
 };
 
 /* Linkage for list of available (previously used) explicit tcache IDs. */
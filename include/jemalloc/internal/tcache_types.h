@@ -8,8 +8,13 @@ typedef struct tcache_bin_s tcache_bin_t;
 typedef struct tcache_s tcache_t;
 typedef struct tcaches_s tcaches_t;
 
+/*
+ * Type of the per bin object counts.  ncached_max never exceeds
+ * TCACHE_NSLOTS_SMALL_MAX, so 16 bits suffice and keep tcache_bin_t small.
+ */
+typedef uint16_t tcache_bin_sz_t;
 /* ncached is cast to this type for comparison. */
-typedef int32_t low_water_t;
+typedef int16_t low_water_t;
 
 /*
  * tcache pointers close to NULL are used to encode state information that is
@@ -38,22 +43,23 @@ typedef int32_t low_water_t;
 /* Number of cache slots for large size classes. */
 #define TCACHE_NSLOTS_LARGE		20
 
+/*
+ * Maximum number of extent_t structures cached by each auto tcache for its
+ * arena (see extent_alloc()).  This constant must be an even number.
+ */
+#define TCACHE_NEXTENTS_MAX		16
+
 /* (1U << opt_lg_tcache_max) is used to compute tcache_maxclass. */
 #define LG_TCACHE_MAXCLASS_DEFAULT	15
 
 /*
- * TCACHE_GC_SWEEP is the approximate number of allocation events between
- * full GC sweeps.  Integer rounding may cause the actual number to be
- * slightly higher, since GC is performed incrementally.
+ * Default number of bytes allocated (and, separately, deallocated) by a thread
+ * between incremental GCs of its tcache.  See opt_tcache_gc_incr_bytes.
  */
-#define TCACHE_GC_SWEEP			8192
-
-/* Number of tcache allocation/deallocation events between incremental GCs. */
-#define TCACHE_GC_INCR							\
-    ((TCACHE_GC_SWEEP / NBINS) + ((TCACHE_GC_SWEEP / NBINS == 0) ? 0 : 1))
+#define TCACHE_GC_INCR_BYTES_DEFAULT	65536
 
 /* Used in TSD static initializer only. Real init in tcache_data_init(). */
-#define TCACHE_ZERO_INITIALIZER {0}
+#define TCACHE_ZERO_INITIALIZER {{{0}}}
 
 /* Used in TSD static initializer only. Will be initialized to opt_tcache. */
 #define TCACHE_ENABLED_ZERO_INITIALIZER false
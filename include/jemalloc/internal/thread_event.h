@@ -0,0 +1,71 @@
+#ifndef JEMALLOC_INTERNAL_THREAD_EVENT_H
+#define JEMALLOC_INTERNAL_THREAD_EVENT_H
+
+#include "jemalloc/internal/tsd.h"
+
+/*
+ * Thread events drive periodic per-thread work (heap profile sampling and
+ * incremental tcache GC) off of the thread's allocated/deallocated byte
+ * counters.  Each event has a wait, i.e. the number of bytes remaining until
+ * it is triggered, and the counters are compared against a single precomputed
+ * threshold, so that the fast paths pay one add and one compare regardless of
+ * how many events are enabled:
+ *
+ *   thread_allocated_next_event = thread_allocated_last_event +
+ *       min(prof_sample_event_wait, tcache_gc_event_wait,
+ *       THREAD_EVENT_MAX_INTERVAL)
+ *
+ * and similarly for deallocations.
+ */
+
+/*
+ * Maximum number of bytes between two consecutive slow path checks.  This
+ * bounds the thresholds so that they cannot overflow, and so that option
+ * changes are noticed reasonably promptly.
+ */
+#define THREAD_EVENT_MAX_INTERVAL	((uint64_t)(4U << 20))
+
+/* Wait value for events that are disabled. */
+#define THREAD_EVENT_MAX_START_WAIT	UINT64_MAX
+
+void thread_event_init(tsd_t *tsd);
+void thread_alloc_event_hard(tsd_t *tsd);
+void thread_dalloc_event_hard(tsd_t *tsd);
+void thread_prof_sample_event_reset(tsd_t *tsd);
+
+JEMALLOC_ALWAYS_INLINE void
+thread_alloc_event(tsd_t *tsd, size_t usize) {
+	uint64_t *allocatedp = tsd_thread_allocatedp_get(tsd);
+
+	*allocatedp += usize;
+	if (unlikely(*allocatedp >=
+	    *tsd_thread_allocated_next_eventp_get(tsd))) {
+		thread_alloc_event_hard(tsd);
+	}
+}
+
+JEMALLOC_ALWAYS_INLINE void
+thread_dalloc_event(tsd_t *tsd, size_t usize) {
+	uint64_t *deallocatedp = tsd_thread_deallocatedp_get(tsd);
+
+	*deallocatedp += usize;
+	if (unlikely(*deallocatedp >=
+	    *tsd_thread_deallocated_next_eventp_get(tsd))) {
+		thread_dalloc_event_hard(tsd);
+	}
+}
+
+/*
+ * Returns true if an allocation of usize bytes would trigger the prof sample
+ * event once accounted for via thread_alloc_event().  The sampling decision
+ * has to be made before the allocation happens, whereas the event (and thus
+ * the computation of the next sample wait) fires afterwards.
+ */
+JEMALLOC_ALWAYS_INLINE bool
+thread_prof_sample_event_lookahead(tsd_t *tsd, size_t usize) {
+	return *tsd_thread_allocatedp_get(tsd) + usize -
+	    *tsd_thread_allocated_last_eventp_get(tsd) >=
+	    *tsd_prof_sample_event_waitp_get(tsd);
+}
+
+#endif /* JEMALLOC_INTERNAL_THREAD_EVENT_H */
@@ -17,8 +17,10 @@
  * --- data accessed on tcache fast path: state, rtree_ctx, stats, prof ---
  * s: state
  * e: tcache_enabled
- * m: thread_allocated (config_stats)
- * f: thread_deallocated (config_stats)
+ * m: thread_allocated
+ * f: thread_deallocated
+ * n: thread_allocated_next_event
+ * N: thread_deallocated_next_event
  * p: prof_tdata (config_prof)
  * c: rtree_ctx (rtree cache accessed on deallocation)
  * t: tcache
@@ -29,23 +31,49 @@
  * i: iarena
  * a: arena
  * o: arenas_tdata
+ * --- thread event state, only accessed when an event threshold is crossed ---
+ * --- (and by the prof sampling lookahead when profiling is enabled) ---
+ * l: thread_allocated_last_event
+ * L: thread_deallocated_last_event
+ * w: prof_sample_event_wait (config_prof)
+ * g: tcache_gc_event_wait
+ * G: tcache_gc_dalloc_event_wait
+ * z: prng_state (config_prof)
  * Loading TSD data is on the critical path of basically all malloc operations.
  * In particular, tcache and rtree_ctx rely on hot CPU cache to be effective.
- * Use a compact layout to reduce cache footprint.
+ * Use a compact layout to reduce cache footprint.  The TLS instance is
+ * cacheline aligned, so that the state check in tsd_fetch() and the thread
+ * event counters checked by the fast paths always share one cacheline.
  * +--- 64-bit and 64B cacheline; 1B each letter; First byte on the left. ---+
  * |----------------------------  1st cacheline  ----------------------------|
- * | sedrxxxx mmmmmmmm ffffffff pppppppp [c * 32  ........ ........ .......] |
- * |----------------------------  2nd cacheline  ----------------------------|
- * | [c * 64  ........ ........ ........ ........ ........ ........ .......] |
- * |----------------------------  3nd cacheline  ----------------------------|
- * | [c * 32  ........ ........ .......] iiiiiiii aaaaaaaa oooooooo [t...... |
+ * | sedrxxxx mmmmmmmm ffffffff nnnnnnnn NNNNNNNN pppppppp [c * 16  .......] |
+ * |-------------------------  2nd - 7th cachelines  ------------------------|
+ * | [c * 384 ........ ........ ........ ........ ........ ........ .......] |
+ * |----------------------------  8th cacheline  ----------------------------|
+ * | cccccccc iiiiiiii aaaaaaaa oooooooo llllllll LLLLLLLL wwwwwwww gggggggg |
+ * |----------------------------  9th cacheline  ----------------------------|
+ * | GGGGGGGG zzzzzzzz -------- -------- -------- -------- -------- -------- |
+ * |----------------------------  10th cacheline  ---------------------------|
+ * | [t * 64  ........ ........ ........ ........ ........ ........ .......] |
  * +-------------------------------------------------------------------------+
+ * Offsets are for the default rtree_ctx geometry (16 direct mapped and 8 L2
+ * entries, plus stats: 408B); '-' is padding.
  * Note: the entire tcache is embedded into TSD and spans multiple cachelines.
+ * Its small bins are cacheline aligned (see tcache_structs.h), which aligns
+ * the tcache, and hence pads the 9th cacheline.
  *
- * The last 3 members (i, a and o) before tcache isn't really needed on tcache
- * fast path.  However we have a number of unused tcache bins and witnesses
- * (never touched unless config_debug) at the end of tcache, so we place them
- * there to avoid breaking the cachelines and possibly paging in an extra page.
+ * The members between rtree_ctx and tcache (i, a, o and the thread event
+ * state) aren't really needed on tcache fast path.  They fill the tail of
+ * rtree_ctx's last cacheline and the padding before tcache, so they cost no
+ * extra space.
+ *
+ * Only the state check and the thread event counters share a cacheline; a
+ * fast path allocation additionally touches the line holding its bin (in the
+ * 10th cacheline or later), and a fast path deallocation the line holding
+ * its rtree_ctx L1 entry as well.  This is deliberate: the bins are cacheline
+ * aligned so that none of them straddles two lines, which rules out sharing
+ * the 1st cacheline with the state, and moving the tcache ahead of rtree_ctx
+ * would only move rtree_ctx ~6KiB away instead.
  */
 #ifdef JEMALLOC_JET
 typedef void (*test_callback_t)(int *);
@@ -67,11 +95,19 @@ typedef void (*test_callback_t)(int *);
     O(narenas_tdata,		uint32_t,		uint32_t)	\
     O(thread_allocated,		uint64_t,		uint64_t)	\
     O(thread_deallocated,	uint64_t,		uint64_t)	\
+    O(thread_allocated_next_event,	uint64_t,	uint64_t)	\
+    O(thread_deallocated_next_event,	uint64_t,	uint64_t)	\
     O(prof_tdata,		prof_tdata_t *,		prof_tdata_t *)	\
     O(rtree_ctx,		rtree_ctx_t,		rtree_ctx_t)	\
     O(iarena,			arena_t *,		arena_t *)	\
     O(arena,			arena_t *,		arena_t *)	\
     O(arenas_tdata,		arena_tdata_t *,	arena_tdata_t *)\
+    O(thread_allocated_last_event,	uint64_t,	uint64_t)	\
+    O(thread_deallocated_last_event,	uint64_t,	uint64_t)	\
+    O(prof_sample_event_wait,	uint64_t,		uint64_t)	\
+    O(tcache_gc_event_wait,	uint64_t,		uint64_t)	\
+    O(tcache_gc_dalloc_event_wait,	uint64_t,	uint64_t)	\
+    O(prng_state,		uint64_t,		uint64_t)	\
     O(tcache,			tcache_t,		tcache_t)	\
     O(witness_tsd,              witness_tsd_t,		witness_tsdn_t)	\
     MALLOC_TEST_TSD
@@ -84,11 +120,19 @@ typedef void (*test_callback_t)(int *);
     0,									\
     0,									\
     0,									\
+    0,									\
+    0,									\
     NULL,								\
     RTREE_CTX_ZERO_INITIALIZER,						\
     NULL,								\
     NULL,								\
     NULL,								\
+    0,									\
+    0,									\
+    0,									\
+    0,									\
+    0,									\
+    0,									\
     TCACHE_ZERO_INITIALIZER,						\
     WITNESS_TSD_INITIALIZER						\
     MALLOC_TEST_TSD_INITIALIZER						\
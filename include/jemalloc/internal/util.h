@@ -62,6 +62,17 @@ get_errno(void) {
 #endif
 }
 
+/*
+ * Hint that *ptr will soon be read, so that the cache miss (if any) can overlap
+ * with other work.
+ */
+UTIL_INLINE void
+util_prefetch_read(const void *ptr) {
+#ifdef __GNUC__
+	__builtin_prefetch(ptr, 0, 3);
+#endif
+}
+
 #undef UTIL_INLINE
 
 #endif /* JEMALLOC_INTERNAL_UTIL_H */
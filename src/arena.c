@@ -3,6 +3,7 @@
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
 #include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/extent_backing.h"
 #include "jemalloc/internal/extent_dss.h"
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/mutex.h"
@@ -26,11 +27,20 @@ const char *percpu_arena_mode_names[] = {
 };
 percpu_arena_mode_t opt_percpu_arena = PERCPU_ARENA_DEFAULT;
 
+prefault_t opt_prefault = PREFAULT_DEFAULT;
+const char *prefault_names[] = {
+	"disabled",
+	"populate"
+};
+
+size_t opt_retain_grow_limit = RETAIN_GROW_LIMIT_DEFAULT;
+
 ssize_t opt_dirty_decay_ms = DIRTY_DECAY_MS_DEFAULT;
 ssize_t opt_muzzy_decay_ms = MUZZY_DECAY_MS_DEFAULT;
 
 static atomic_zd_t dirty_decay_ms_default;
 static atomic_zd_t muzzy_decay_ms_default;
+static atomic_u_t prefault_default;
 
 const arena_bin_info_t arena_bin_info[NBINS] = {
 #define BIN_INFO_bin_yes(reg_size, slab_size, nregs)			\
@@ -65,6 +75,7 @@ static void arena_decay_to_limit(tsdn_t *tsdn, arena_t *arena,
     bool is_background_thread);
 static bool arena_decay_dirty(tsdn_t *tsdn, arena_t *arena,
     bool is_background_thread, bool all);
+static void arena_decay_dirty_eager(tsdn_t *tsdn, arena_t *arena);
 static void arena_dalloc_bin_slab(tsdn_t *tsdn, arena_t *arena, extent_t *slab,
     arena_bin_t *bin);
 static void arena_bin_lower_slab(tsdn_t *tsdn, arena_t *arena, extent_t *slab,
@@ -211,6 +222,23 @@ arena_stats_mapped_add(tsdn_t *tsdn, arena_stats_t *arena_stats, size_t size) {
 	arena_stats_unlock(tsdn, arena_stats);
 }
 
+void
+arena_stats_prefaulted_add(tsdn_t *tsdn, arena_stats_t *arena_stats,
+    size_t size) {
+	arena_stats_lock(tsdn, arena_stats);
+	arena_stats_add_u64(tsdn, arena_stats, &arena_stats->prefaulted, size);
+	arena_stats_unlock(tsdn, arena_stats);
+}
+
+void
+arena_stats_thp_collapsed_add(tsdn_t *tsdn, arena_stats_t *arena_stats,
+    size_t size) {
+	arena_stats_lock(tsdn, arena_stats);
+	arena_stats_add_u64(tsdn, arena_stats, &arena_stats->thp_collapsed,
+	    size);
+	arena_stats_unlock(tsdn, arena_stats);
+}
+
 void
 arena_basic_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
     const char **dss, ssize_t *dirty_decay_ms, ssize_t *muzzy_decay_ms,
@@ -244,6 +272,8 @@ arena_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
 	    + arena_stats_read_zu(tsdn, &arena->stats, &arena->stats.mapped));
 	arena_stats_accum_zu(&astats->retained,
 	    extents_npages_get(&arena->extents_retained) << LG_PAGE);
+	arena_stats_accum_zu(&astats->retained_fresh,
+	    extents_nfresh_pages_get(&arena->extents_retained) << LG_PAGE);
 
 	arena_stats_accum_u64(&astats->decay_dirty.npurge,
 	    arena_stats_read_u64(tsdn, &arena->stats,
@@ -264,6 +294,14 @@ arena_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
 	arena_stats_accum_u64(&astats->decay_muzzy.purged,
 	    arena_stats_read_u64(tsdn, &arena->stats,
 	    &arena->stats.decay_muzzy.purged));
+	arena_stats_accum_u64(&astats->npurge_inline,
+	    arena_stats_read_u64(tsdn, &arena->stats,
+	    &arena->stats.npurge_inline));
+
+	arena_stats_accum_u64(&astats->prefaulted, arena_stats_read_u64(tsdn,
+	    &arena->stats, &arena->stats.prefaulted));
+	arena_stats_accum_u64(&astats->thp_collapsed, arena_stats_read_u64(tsdn,
+	    &arena->stats, &arena->stats.thp_collapsed));
 
 	arena_stats_accum_zu(&astats->base, base_allocated);
 	arena_stats_accum_zu(&astats->internal, arena_internal_get(arena));
@@ -376,8 +414,9 @@ arena_extents_dirty_dalloc(tsdn_t *tsdn, arena_t *arena,
 
 	extents_dalloc(tsdn, arena, r_extent_hooks, &arena->extents_dirty,
 	    extent);
-	if (arena_dirty_decay_ms_get(arena) == 0) {
-		arena_decay_dirty(tsdn, arena, false, true);
+	if (arena_dirty_decay_ms_get(arena) == 0 && arena_prefault_get(arena)
+	    == prefault_disabled) {
+		arena_decay_dirty_eager(tsdn, arena);
 	} else {
 		arena_background_thread_inactivity_check(tsdn, arena, false);
 	}
@@ -385,7 +424,7 @@ arena_extents_dirty_dalloc(tsdn_t *tsdn, arena_t *arena,
 
 static void *
 arena_slab_reg_alloc(tsdn_t *tsdn, extent_t *slab,
-    const arena_bin_info_t *bin_info) {
+    const arena_bin_info_t *bin_info, bool *zeroed) {
 	void *ret;
 	arena_slab_data_t *slab_data = extent_slab_data_get(slab);
 	size_t regind;
@@ -397,6 +436,10 @@ arena_slab_reg_alloc(tsdn_t *tsdn, extent_t *slab,
 	ret = (void *)((uintptr_t)extent_addr_get(slab) +
 	    (uintptr_t)(bin_info->reg_size * regind));
 	extent_nfree_dec(slab);
+	*zeroed = (regind >= slab_data->fresh_regind);
+	if (*zeroed) {
+		slab_data->fresh_regind = (unsigned)regind + 1;
+	}
 	return ret;
 }
 
@@ -604,6 +647,16 @@ arena_decay_ms_write(arena_decay_t *decay, ssize_t decay_ms) {
 	atomic_store_zd(&decay->time_ms, decay_ms, ATOMIC_RELAXED);
 }
 
+/*
+ * Returns true if application threads should leave eager purging to the
+ * background threads (see opt.background_purge_only).
+ */
+static bool
+arena_decay_deferred(void) {
+	return have_background_thread && opt_background_purge_only &&
+	    background_thread_enabled();
+}
+
 static void
 arena_decay_deadline_init(arena_decay_t *decay) {
 	/*
@@ -793,10 +846,19 @@ arena_maybe_decay(tsdn_t *tsdn, arena_t *arena, arena_decay_t *decay,
     extents_t *extents, bool is_background_thread) {
 	malloc_mutex_assert_owner(tsdn, &decay->mtx);
 
+	/*
+	 * Prefaulted memory is meant to stay resident, so only explicit purge
+	 * requests (arena_decay_impl() with all) purge it.
+	 */
+	if (arena_prefault_get(arena) != prefault_disabled) {
+		return false;
+	}
+
 	/* Purge all or nothing if the option is disabled. */
 	ssize_t decay_ms = arena_decay_ms_read(decay);
 	if (decay_ms <= 0) {
-		if (decay_ms == 0) {
+		if (decay_ms == 0 && (is_background_thread ||
+		    !arena_decay_deferred())) {
 			arena_decay_to_limit(tsdn, arena, decay, extents, false,
 			    0, is_background_thread);
 		}
@@ -973,6 +1035,10 @@ arena_decay_stashed(tsdn_t *tsdn, arena_t *arena,
 		    &decay->stats->nmadvise, nmadvise);
 		arena_stats_add_u64(tsdn, &arena->stats, &decay->stats->purged,
 		    npurged);
+		if (!is_background_thread) {
+			arena_stats_add_u64(tsdn, &arena->stats,
+			    &arena->stats.npurge_inline, 1);
+		}
 		arena_stats_sub_zu(tsdn, &arena->stats, &arena->stats.mapped,
 		    nunmapped << LG_PAGE);
 		arena_stats_unlock(tsdn, &arena->stats);
@@ -1058,6 +1124,17 @@ arena_decay_dirty(tsdn_t *tsdn, arena_t *arena, bool is_background_thread,
 	    &arena->extents_dirty, is_background_thread, all);
 }
 
+/* Purges dirty pages right away on behalf of dirty_decay_ms == 0. */
+static void
+arena_decay_dirty_eager(tsdn_t *tsdn, arena_t *arena) {
+	if (arena_decay_deferred()) {
+		background_thread_interval_check(tsdn, arena,
+		    &arena->decay_dirty, 0);
+	} else {
+		arena_decay_dirty(tsdn, arena, false, true);
+	}
+}
+
 static bool
 arena_decay_muzzy(tsdn_t *tsdn, arena_t *arena, bool is_background_thread,
     bool all) {
@@ -1065,12 +1142,31 @@ arena_decay_muzzy(tsdn_t *tsdn, arena_t *arena, bool is_background_thread,
 	    &arena->extents_muzzy, is_background_thread, all);
 }
 
+/* Returns the size class index at which retained memory starts growing. */
+static pszind_t
+arena_extent_grow_first(pszind_t retain_grow_limit) {
+	pszind_t ind = sz_psz2ind(HUGEPAGE);
+	return (ind < retain_grow_limit) ? ind : retain_grow_limit;
+}
+
 void
 arena_decay(tsdn_t *tsdn, arena_t *arena, bool is_background_thread, bool all) {
 	if (arena_decay_dirty(tsdn, arena, is_background_thread, all)) {
 		return;
 	}
 	arena_decay_muzzy(tsdn, arena, is_background_thread, all);
+
+	if (all) {
+		/*
+		 * Once everything has been purged, start growing retained
+		 * memory from the smallest step again, so that a past burst
+		 * doesn't make every later growth a huge mapping.
+		 */
+		malloc_mutex_lock(tsdn, &arena->extent_grow_mtx);
+		arena->extent_grow_next = arena_extent_grow_first(
+		    arena->retain_grow_limit);
+		malloc_mutex_unlock(tsdn, &arena->extent_grow_mtx);
+	}
 }
 
 static void
@@ -1142,67 +1238,83 @@ arena_reset(tsd_t *tsd, arena_t *arena) {
 	 *   stats refreshes would impose an inconvenient burden.
 	 */
 
+	tsdn_t *tsdn = tsd_tsdn(tsd);
+	/*
+	 * Rather than freeing allocations one by one, detach the large list and
+	 * all slabs wholesale, then hand them back to extents_dirty in a single
+	 * batch.  Stats are updated in aggregate.
+	 */
+	extent_list_t extents;
+	extent_list_init(&extents);
+
 	/* Large allocations. */
-	malloc_mutex_lock(tsd_tsdn(tsd), &arena->large_mtx);
-
-	for (extent_t *extent = extent_list_first(&arena->large); extent !=
-	    NULL; extent = extent_list_first(&arena->large)) {
-		void *ptr = extent_base_get(extent);
-		size_t usize;
-
-		malloc_mutex_unlock(tsd_tsdn(tsd), &arena->large_mtx);
-		alloc_ctx_t alloc_ctx;
-		rtree_ctx_t *rtree_ctx = tsd_rtree_ctx(tsd);
-		rtree_szind_slab_read(tsd_tsdn(tsd), &extents_rtree, rtree_ctx,
-		    (uintptr_t)ptr, true, &alloc_ctx.szind, &alloc_ctx.slab);
-		assert(alloc_ctx.szind != NSIZES);
-
-		if (config_stats || (config_prof && opt_prof)) {
-			usize = sz_index2size(alloc_ctx.szind);
-			assert(usize == isalloc(tsd_tsdn(tsd), ptr));
+	extent_list_t large;
+	extent_list_init(&large);
+	malloc_mutex_lock(tsdn, &arena->large_mtx);
+	extent_list_concat(&large, &arena->large);
+	malloc_mutex_unlock(tsdn, &arena->large_mtx);
+
+	/* Junk-fill without holding any locks. */
+	for (extent_t *extent = extent_list_first(&large); extent != NULL;
+	    extent = ql_next(&large, extent, ql_link)) {
+		assert(extent_szind_get(extent) != NSIZES);
+		assert(!extent_slab_get(extent));
+		large_dalloc_maybe_junk(extent_addr_get(extent),
+		    extent_usize_get(extent));
+	}
+	if (config_stats) {
+		arena_stats_lock(tsdn, &arena->stats);
+		for (extent_t *extent = extent_list_first(&large); extent !=
+		    NULL; extent = ql_next(&large, extent, ql_link)) {
+			arena_large_dalloc_stats_update(tsdn, arena,
+			    extent_usize_get(extent));
 		}
-		/* Remove large allocation from prof sample set. */
-		if (config_prof && opt_prof) {
-			prof_free(tsd, ptr, usize, &alloc_ctx);
+		arena_stats_unlock(tsdn, &arena->stats);
+	}
+	/* Remove large allocations from prof sample set. */
+	if (config_prof && opt_prof) {
+		for (extent_t *extent = extent_list_first(&large); extent !=
+		    NULL; extent = ql_next(&large, extent, ql_link)) {
+			alloc_ctx_t alloc_ctx = {extent_szind_get(extent),
+			    false};
+			prof_free(tsd, extent_addr_get(extent),
+			    extent_usize_get(extent), &alloc_ctx);
 		}
-		large_dalloc(tsd_tsdn(tsd), extent);
-		malloc_mutex_lock(tsd_tsdn(tsd), &arena->large_mtx);
 	}
-	malloc_mutex_unlock(tsd_tsdn(tsd), &arena->large_mtx);
+	extent_list_concat(&extents, &large);
 
 	/* Bins. */
 	for (unsigned i = 0; i < NBINS; i++) {
 		extent_t *slab;
 		arena_bin_t *bin = &arena->bins[i];
-		malloc_mutex_lock(tsd_tsdn(tsd), &bin->lock);
+		malloc_mutex_lock(tsdn, &bin->lock);
 		if (bin->slabcur != NULL) {
-			slab = bin->slabcur;
+			extent_list_append(&extents, bin->slabcur);
 			bin->slabcur = NULL;
-			malloc_mutex_unlock(tsd_tsdn(tsd), &bin->lock);
-			arena_slab_dalloc(tsd_tsdn(tsd), arena, slab);
-			malloc_mutex_lock(tsd_tsdn(tsd), &bin->lock);
 		}
 		while ((slab = extent_heap_remove_first(&bin->slabs_nonfull)) !=
 		    NULL) {
-			malloc_mutex_unlock(tsd_tsdn(tsd), &bin->lock);
-			arena_slab_dalloc(tsd_tsdn(tsd), arena, slab);
-			malloc_mutex_lock(tsd_tsdn(tsd), &bin->lock);
-		}
-		for (slab = extent_list_first(&bin->slabs_full); slab != NULL;
-		    slab = extent_list_first(&bin->slabs_full)) {
-			arena_bin_slabs_full_remove(arena, bin, slab);
-			malloc_mutex_unlock(tsd_tsdn(tsd), &bin->lock);
-			arena_slab_dalloc(tsd_tsdn(tsd), arena, slab);
-			malloc_mutex_lock(tsd_tsdn(tsd), &bin->lock);
+			extent_list_append(&extents, slab);
 		}
+		extent_list_concat(&extents, &bin->slabs_full);
 		if (config_stats) {
 			bin->stats.curregs = 0;
 			bin->stats.curslabs = 0;
 		}
-		malloc_mutex_unlock(tsd_tsdn(tsd), &bin->lock);
+		malloc_mutex_unlock(tsdn, &bin->lock);
 	}
 
 	atomic_store_zu(&arena->nactive, 0, ATOMIC_RELAXED);
+
+	extent_hooks_t *extent_hooks = EXTENT_HOOKS_INITIALIZER;
+	extents_dalloc_list(tsdn, arena, &extent_hooks, &arena->extents_dirty,
+	    &extents);
+	if (arena_dirty_decay_ms_get(arena) == 0 && arena_prefault_get(arena)
+	    == prefault_disabled) {
+		arena_decay_dirty_eager(tsdn, arena);
+	} else {
+		arena_background_thread_inactivity_check(tsdn, arena, false);
+	}
 }
 
 static void
@@ -1257,23 +1369,26 @@ arena_destroy(tsd_t *tsd, arena_t *arena) {
 	 * Destroy the base allocator, which manages all metadata ever mapped by
 	 * this arena.
 	 */
+	extent_hooks_t *extent_hooks = base_extent_hooks_get(arena->base);
 	base_delete(arena->base);
+
+	/* Release what arenas.create_backed set up for this arena. */
+	extent_backing_hooks_release(tsd_tsdn(tsd), extent_hooks);
 }
 
 static extent_t *
 arena_slab_alloc_hard(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, const arena_bin_info_t *bin_info,
-    szind_t szind) {
+    szind_t szind, bool *zero) {
 	extent_t *slab;
-	bool zero, commit;
+	bool commit;
 
 	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
 	    WITNESS_RANK_CORE, 0);
 
-	zero = false;
 	commit = true;
 	slab = extent_alloc_wrapper(tsdn, arena, r_extent_hooks, NULL,
-	    bin_info->slab_size, 0, PAGE, true, szind, &zero, &commit);
+	    bin_info->slab_size, 0, PAGE, true, szind, zero, &commit);
 
 	if (config_stats && slab != NULL) {
 		arena_stats_mapped_add(tsdn, &arena->stats,
@@ -1303,7 +1418,7 @@ arena_slab_alloc(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	}
 	if (slab == NULL) {
 		slab = arena_slab_alloc_hard(tsdn, arena, &extent_hooks,
-		    bin_info, szind);
+		    bin_info, szind, &zero);
 		if (slab == NULL) {
 			return NULL;
 		}
@@ -1314,6 +1429,7 @@ arena_slab_alloc(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	arena_slab_data_t *slab_data = extent_slab_data_get(slab);
 	extent_nfree_set(slab, bin_info->nregs);
 	bitmap_init(slab_data->bitmap, &bin_info->bitmap_info, false);
+	slab_data->fresh_regind = zero ? 0 : bin_info->nregs;
 
 	arena_nactive_add(arena, extent_size_get(slab) >> LG_PAGE);
 
@@ -1365,7 +1481,7 @@ arena_bin_nonfull_slab_get(tsdn_t *tsdn, arena_t *arena, arena_bin_t *bin,
 /* Re-fill bin->slabcur, then call arena_slab_reg_alloc(). */
 static void *
 arena_bin_malloc_hard(tsdn_t *tsdn, arena_t *arena, arena_bin_t *bin,
-    szind_t binind) {
+    szind_t binind, bool *zeroed) {
 	const arena_bin_info_t *bin_info;
 	extent_t *slab;
 
@@ -1382,7 +1498,7 @@ arena_bin_malloc_hard(tsdn_t *tsdn, arena_t *arena, arena_bin_t *bin,
 		 */
 		if (extent_nfree_get(bin->slabcur) > 0) {
 			void *ret = arena_slab_reg_alloc(tsdn, bin->slabcur,
-			    bin_info);
+			    bin_info, zeroed);
 			if (slab != NULL) {
 				/*
 				 * arena_slab_alloc() may have allocated slab,
@@ -1415,13 +1531,13 @@ arena_bin_malloc_hard(tsdn_t *tsdn, arena_t *arena, arena_bin_t *bin,
 
 	assert(extent_nfree_get(bin->slabcur) > 0);
 
-	return arena_slab_reg_alloc(tsdn, slab, bin_info);
+	return arena_slab_reg_alloc(tsdn, slab, bin_info, zeroed);
 }
 
 void
 arena_tcache_fill_small(tsdn_t *tsdn, arena_t *arena, tcache_t *tcache,
     tcache_bin_t *tbin, szind_t binind, uint64_t prof_accumbytes) {
-	unsigned i, nfill;
+	unsigned i, nfill, nzeroed;
 	arena_bin_t *bin;
 
 	assert(tbin->ncached == 0);
@@ -1431,16 +1547,18 @@ arena_tcache_fill_small(tsdn_t *tsdn, arena_t *arena, tcache_t *tcache,
 	}
 	bin = &arena->bins[binind];
 	malloc_mutex_lock(tsdn, &bin->lock);
-	for (i = 0, nfill = (tcache_bin_info[binind].ncached_max >>
-	    tcache->lg_fill_div[binind]); i < nfill; i++) {
+	for (i = 0, nzeroed = 0, nfill = (tcache_bin_info[binind].ncached_max
+	    >> tcache->lg_fill_div[binind]); i < nfill; i++) {
 		extent_t *slab;
 		void *ptr;
+		bool zeroed;
 		if ((slab = bin->slabcur) != NULL && extent_nfree_get(slab) >
 		    0) {
 			ptr = arena_slab_reg_alloc(tsdn, slab,
-			    &arena_bin_info[binind]);
+			    &arena_bin_info[binind], &zeroed);
 		} else {
-			ptr = arena_bin_malloc_hard(tsdn, arena, bin, binind);
+			ptr = arena_bin_malloc_hard(tsdn, arena, bin, binind,
+			    &zeroed);
 		}
 		if (ptr == NULL) {
 			/*
@@ -1460,16 +1578,23 @@ arena_tcache_fill_small(tsdn_t *tsdn, arena_t *arena, tcache_t *tcache,
 		}
 		/* Insert such that low regions get used first. */
 		*(tbin->avail - nfill + i) = ptr;
+		/*
+		 * The regions inserted last end up at the bottom of the stack,
+		 * so track how many of those are zeroed (see tcache_bin_t).
+		 */
+		nzeroed = zeroed ? nzeroed + 1 : 0;
 	}
 	if (config_stats) {
 		bin->stats.nmalloc += i;
-		bin->stats.nrequests += tbin->tstats.nrequests;
+		bin->stats.nrequests +=
+		    tcache_bin_stats_get(tcache, binind)->nrequests;
 		bin->stats.curregs += i;
 		bin->stats.nfills++;
-		tbin->tstats.nrequests = 0;
+		tcache_bin_stats_get(tcache, binind)->nrequests = 0;
 	}
 	malloc_mutex_unlock(tsdn, &bin->lock);
 	tbin->ncached = i;
+	tbin->nzeroed = nzeroed;
 	arena_decay_tick(tsdn, arena);
 }
 
@@ -1493,6 +1618,7 @@ arena_malloc_small(tsdn_t *tsdn, arena_t *arena, szind_t binind, bool zero) {
 	arena_bin_t *bin;
 	size_t usize;
 	extent_t *slab;
+	bool zeroed;
 
 	assert(binind < NBINS);
 	bin = &arena->bins[binind];
@@ -1500,9 +1626,10 @@ arena_malloc_small(tsdn_t *tsdn, arena_t *arena, szind_t binind, bool zero) {
 
 	malloc_mutex_lock(tsdn, &bin->lock);
 	if ((slab = bin->slabcur) != NULL && extent_nfree_get(slab) > 0) {
-		ret = arena_slab_reg_alloc(tsdn, slab, &arena_bin_info[binind]);
+		ret = arena_slab_reg_alloc(tsdn, slab, &arena_bin_info[binind],
+		    &zeroed);
 	} else {
-		ret = arena_bin_malloc_hard(tsdn, arena, bin, binind);
+		ret = arena_bin_malloc_hard(tsdn, arena, bin, binind, &zeroed);
 	}
 
 	if (ret == NULL) {
@@ -1534,7 +1661,13 @@ arena_malloc_small(tsdn_t *tsdn, arena_t *arena, szind_t binind, bool zero) {
 			arena_alloc_junk_small(ret, &arena_bin_info[binind],
 			    true);
 		}
-		memset(ret, 0, usize);
+		if (!zeroed) {
+			memset(ret, 0, usize);
+		} else if (config_debug) {
+			for (size_t i = 0; i < usize; i++) {
+				assert(((char *)ret)[i] == 0);
+			}
+		}
 	}
 
 	arena_decay_tick(tsdn, arena);
@@ -1857,6 +1990,60 @@ arena_dss_prec_set(arena_t *arena, dss_prec_t dss_prec) {
 	return false;
 }
 
+prefault_t
+arena_prefault_get(arena_t *arena) {
+	return (prefault_t)atomic_load_u(&arena->prefault, ATOMIC_ACQUIRE);
+}
+
+void
+arena_prefault_set(arena_t *arena, prefault_t prefault) {
+	atomic_store_u(&arena->prefault, (unsigned)prefault, ATOMIC_RELEASE);
+}
+
+prefault_t
+arena_prefault_default_get(void) {
+	return (prefault_t)atomic_load_u(&prefault_default, ATOMIC_RELAXED);
+}
+
+void
+arena_prefault_default_set(prefault_t prefault) {
+	atomic_store_u(&prefault_default, (unsigned)prefault, ATOMIC_RELAXED);
+}
+
+/*
+ * Converts a growth step limit in bytes to the largest page size class that
+ * does not exceed it.
+ */
+static pszind_t
+arena_retain_grow_limit_ind(size_t limit) {
+	assert(limit >= PAGE);
+	return sz_psz2ind(limit + 1) - 1;
+}
+
+size_t
+arena_retain_grow_limit_get(tsdn_t *tsdn, arena_t *arena) {
+	malloc_mutex_lock(tsdn, &arena->extent_grow_mtx);
+	size_t limit = sz_pind2sz(arena->retain_grow_limit);
+	malloc_mutex_unlock(tsdn, &arena->extent_grow_mtx);
+	return limit;
+}
+
+bool
+arena_retain_grow_limit_set(tsdn_t *tsdn, arena_t *arena, size_t limit) {
+	if (limit < PAGE) {
+		return true;
+	}
+	pszind_t ind = arena_retain_grow_limit_ind(limit);
+
+	malloc_mutex_lock(tsdn, &arena->extent_grow_mtx);
+	arena->retain_grow_limit = ind;
+	if (arena->extent_grow_next > ind) {
+		arena->extent_grow_next = ind;
+	}
+	malloc_mutex_unlock(tsdn, &arena->extent_grow_mtx);
+	return false;
+}
+
 ssize_t
 arena_dirty_decay_ms_default_get(void) {
 	return atomic_load_zd(&dirty_decay_ms_default, ATOMIC_RELAXED);
@@ -1914,7 +2101,12 @@ arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 	if (ind == 0) {
 		base = b0get();
 	} else {
-		base = base_new(tsdn, ind, extent_hooks);
+		/*
+		 * Keep the metadata of backed arenas out of their (possibly
+		 * shared) backing.
+		 */
+		base = base_new(tsdn, ind, extent_hooks,
+		    !extent_backing_hooks_is(extent_hooks));
 		if (base == NULL) {
 			return NULL;
 		}
@@ -1963,6 +2155,8 @@ arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 
 	atomic_store_u(&arena->dss_prec, (unsigned)extent_dss_prec_get(),
 	    ATOMIC_RELAXED);
+	atomic_store_u(&arena->prefault, (unsigned)arena_prefault_default_get(),
+	    ATOMIC_RELAXED);
 
 	atomic_store_zu(&arena->nactive, 0, ATOMIC_RELAXED);
 
@@ -2010,7 +2204,11 @@ arena_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 		goto label_error;
 	}
 
-	arena->extent_grow_next = sz_psz2ind(HUGEPAGE);
+	arena->retain_grow_limit = arena_retain_grow_limit_ind(
+	    opt_retain_grow_limit);
+	arena->extent_grow_next = arena_extent_grow_first(
+	    arena->retain_grow_limit);
+	arena->extent_mappings = NULL;
 	if (malloc_mutex_init(&arena->extent_grow_mtx, "extent_grow",
 	    WITNESS_RANK_EXTENT_GROW, malloc_mutex_rank_exclusive)) {
 		goto label_error;
@@ -2070,6 +2268,7 @@ void
 arena_boot(void) {
 	arena_dirty_decay_ms_default_set(opt_dirty_decay_ms);
 	arena_muzzy_decay_ms_default_set(opt_muzzy_decay_ms);
+	arena_prefault_default_set(opt_prefault);
 }
 
 void
@@ -3,6 +3,7 @@
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
 #include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/spin.h"
 
 /******************************************************************************/
 /* Data. */
@@ -11,6 +12,11 @@
 #define BACKGROUND_THREAD_DEFAULT false
 /* Read-only after initialization. */
 bool opt_background_thread = BACKGROUND_THREAD_DEFAULT;
+/*
+ * If enabled, application threads leave all decay-driven purging to the
+ * background threads while they are running.  Read-only after initialization.
+ */
+bool opt_background_purge_only = false;
 
 /* Used for thread creation, termination and stats. */
 malloc_mutex_t background_thread_lock;
@@ -71,6 +77,9 @@ static void
 background_thread_info_init(tsdn_t *tsdn, background_thread_info_t *info) {
 	background_thread_wakeup_time_set(tsdn, info, 0);
 	info->npages_to_purge_new = 0;
+	atomic_store_b(&info->purge_pending, false, ATOMIC_RELAXED);
+	atomic_store_b(&info->going_to_sleep, false, ATOMIC_RELAXED);
+	nstime_init(&info->thp_scan_next, 0);
 	if (config_stats) {
 		info->tot_n_runs = 0;
 		nstime_init(&info->tot_sleep_time, 0);
@@ -96,6 +105,8 @@ set_current_thread_affinity(UNUSED int cpu) {
 #define BILLION UINT64_C(1000000000)
 /* Minimal sleep interval 100 ms. */
 #define BACKGROUND_THREAD_MIN_INTERVAL_NS (BILLION / 10)
+/* Interval between scans of arenas' memory for opt.thp_policy. */
+#define BACKGROUND_THREAD_THP_SCAN_INTERVAL_NS BILLION
 
 static inline size_t
 decay_npurge_after_interval(arena_decay_t *decay, size_t interval) {
@@ -122,8 +133,17 @@ arena_decay_compute_purge_interval_impl(tsdn_t *tsdn, arena_decay_t *decay,
 	uint64_t interval;
 	ssize_t decay_time = atomic_load_zd(&decay->time_ms, ATOMIC_RELAXED);
 	if (decay_time <= 0) {
-		/* Purging is eagerly done or disabled currently. */
-		interval = BACKGROUND_THREAD_INDEFINITE_SLEEP;
+		/*
+		 * Purging is eagerly done or disabled currently.  Eager purging
+		 * is deferred to us with background_purge_only though, so come
+		 * back soon for pages freed while this pass was running.
+		 */
+		if (decay_time == 0 && opt_background_purge_only &&
+		    extents_npages_get(extents) > 0) {
+			interval = BACKGROUND_THREAD_MIN_INTERVAL_NS;
+		} else {
+			interval = BACKGROUND_THREAD_INDEFINITE_SLEEP;
+		}
 		goto label_done;
 	}
 
@@ -219,6 +239,17 @@ background_thread_sleep(tsdn_t *tsdn, background_thread_info_t *info,
 	}
 	info->npages_to_purge_new = 0;
 
+	/*
+	 * Pairs with background_thread_purge_hint(): either the hint is seen
+	 * here, or the hinting thread sees going_to_sleep and signals us once
+	 * we wait.
+	 */
+	atomic_store_b(&info->going_to_sleep, true, ATOMIC_SEQ_CST);
+	if (atomic_load_b(&info->purge_pending, ATOMIC_SEQ_CST) &&
+	    interval > BACKGROUND_THREAD_MIN_INTERVAL_NS) {
+		interval = BACKGROUND_THREAD_MIN_INTERVAL_NS;
+	}
+
 	struct timeval tv;
 	/* Specific clock required by timedwait. */
 	gettimeofday(&tv, NULL);
@@ -230,6 +261,7 @@ background_thread_sleep(tsdn_t *tsdn, background_thread_info_t *info,
 		assert(background_thread_indefinite_sleep(info));
 		ret = pthread_cond_wait(&info->cond, &info->mtx.lock);
 		assert(ret == 0);
+		atomic_store_b(&info->going_to_sleep, false, ATOMIC_SEQ_CST);
 	} else {
 		assert(interval >= BACKGROUND_THREAD_MIN_INTERVAL_NS &&
 		    interval <= BACKGROUND_THREAD_INDEFINITE_SLEEP);
@@ -253,6 +285,7 @@ background_thread_sleep(tsdn_t *tsdn, background_thread_info_t *info,
 		assert(!background_thread_indefinite_sleep(info));
 		ret = pthread_cond_timedwait(&info->cond, &info->mtx.lock, &ts);
 		assert(ret == ETIMEDOUT || ret == 0);
+		atomic_store_b(&info->going_to_sleep, false, ATOMIC_SEQ_CST);
 		background_thread_wakeup_time_set(tsdn, info,
 		    BACKGROUND_THREAD_INDEFINITE_SLEEP);
 	}
@@ -285,6 +318,22 @@ static inline void
 background_work_sleep_once(tsdn_t *tsdn, background_thread_info_t *info, unsigned ind) {
 	uint64_t min_interval = BACKGROUND_THREAD_INDEFINITE_SLEEP;
 	unsigned narenas = narenas_total_get();
+	/* Hints posted from here on are rechecked before sleeping. */
+	atomic_store_b(&info->purge_pending, false, ATOMIC_SEQ_CST);
+
+	bool thp_scan = false;
+	if (opt_thp_policy != thp_policy_default) {
+		nstime_t now;
+		nstime_init(&now, 0);
+		nstime_update(&now);
+		if (nstime_compare(&now, &info->thp_scan_next) >= 0) {
+			thp_scan = true;
+			nstime_copy(&info->thp_scan_next, &now);
+			nstime_iadd(&info->thp_scan_next,
+			    BACKGROUND_THREAD_THP_SCAN_INTERVAL_NS);
+		}
+		min_interval = BACKGROUND_THREAD_THP_SCAN_INTERVAL_NS;
+	}
 
 	for (unsigned i = ind; i < narenas; i += ncpus) {
 		arena_t *arena = arena_get(tsdn, i, false);
@@ -292,6 +341,9 @@ background_work_sleep_once(tsdn_t *tsdn, background_thread_info_t *info, unsigne
 			continue;
 		}
 		arena_decay(tsdn, arena, true, false);
+		if (thp_scan) {
+			extent_thp_scan(tsdn, arena);
+		}
 		if (min_interval == BACKGROUND_THREAD_MIN_INTERVAL_NS) {
 			/* Min interval will be used. */
 			continue;
@@ -626,10 +678,49 @@ background_threads_disable(tsd_t *tsd) {
 	return false;
 }
 
+/*
+ * Wakes up the background thread of an arena whose eager purging is deferred to
+ * it (see opt.background_purge_only), without waiting for the thread's pass to
+ * finish; if the thread is busy, it sees purge_pending before going to sleep.
+ */
+static void
+background_thread_purge_hint(tsdn_t *tsdn, arena_t *arena) {
+	if (extents_npages_get(&arena->extents_dirty) == 0 &&
+	    extents_npages_get(&arena->extents_muzzy) == 0) {
+		return;
+	}
+	background_thread_info_t *info = arena_background_thread_info_get(
+	    arena);
+	atomic_store_b(&info->purge_pending, true, ATOMIC_SEQ_CST);
+
+	spin_t spinner = SPIN_INITIALIZER;
+	while (malloc_mutex_trylock(tsdn, &info->mtx)) {
+		if (!atomic_load_b(&info->going_to_sleep, ATOMIC_SEQ_CST)) {
+			/* Still in its pass; purge_pending will be seen. */
+			return;
+		}
+		/*
+		 * About to wait, or just woken up; either way the mutex is only
+		 * held briefly.
+		 */
+		spin_adaptive(&spinner);
+	}
+	if (info->state == background_thread_started) {
+		pthread_cond_signal(&info->cond);
+	}
+	malloc_mutex_unlock(tsdn, &info->mtx);
+}
+
 /* Check if we need to signal the background thread early. */
 void
 background_thread_interval_check(tsdn_t *tsdn, arena_t *arena,
     arena_decay_t *decay, size_t npages_new) {
+	if (opt_background_purge_only && atomic_load_zd(&decay->time_ms,
+	    ATOMIC_RELAXED) == 0) {
+		background_thread_purge_hint(tsdn, arena);
+		return;
+	}
+
 	background_thread_info_t *info = arena_background_thread_info_get(
 	    arena);
 	if (malloc_mutex_trylock(tsdn, &info->mtx)) {
@@ -193,6 +193,13 @@ base_block_alloc(extent_hooks_t *extent_hooks, unsigned ind,
 	return block;
 }
 
+/* Returns the extent hooks that base's blocks are mapped with. */
+static extent_hooks_t *
+base_block_hooks_get(base_t *base) {
+	return base->metadata_use_hooks ? base_extent_hooks_get(base) :
+	    (extent_hooks_t *)&extent_hooks_default;
+}
+
 /*
  * Allocate an extent that is at least as large as specified size, with
  * specified alignment.
@@ -201,7 +208,7 @@ static extent_t *
 base_extent_alloc(tsdn_t *tsdn, base_t *base, size_t size, size_t alignment) {
 	malloc_mutex_assert_owner(tsdn, &base->mtx);
 
-	extent_hooks_t *extent_hooks = base_extent_hooks_get(base);
+	extent_hooks_t *extent_hooks = base_block_hooks_get(base);
 	/*
 	 * Drop mutex during base_block_alloc(), because an extent hook will be
 	 * called.
@@ -230,11 +237,19 @@ b0get(void) {
 	return b0;
 }
 
+/*
+ * Creates a base whose associated arena uses extent_hooks.  Unless
+ * metadata_use_hooks, the base's own blocks are mapped via the default extent
+ * hooks, i.e. as private anonymous memory.
+ */
 base_t *
-base_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
+base_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks,
+    bool metadata_use_hooks) {
+	extent_hooks_t *block_hooks = metadata_use_hooks ? extent_hooks :
+	    (extent_hooks_t *)&extent_hooks_default;
 	pszind_t pind_last = 0;
 	size_t extent_sn_next = 0;
-	base_block_t *block = base_block_alloc(extent_hooks, ind, &pind_last,
+	base_block_t *block = base_block_alloc(block_hooks, ind, &pind_last,
 	    &extent_sn_next, sizeof(base_t), QUANTUM);
 	if (block == NULL) {
 		return NULL;
@@ -247,9 +262,10 @@ base_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 	    &gap_size, base_size, base_alignment);
 	base->ind = ind;
 	atomic_store_p(&base->extent_hooks, extent_hooks, ATOMIC_RELAXED);
+	base->metadata_use_hooks = metadata_use_hooks;
 	if (malloc_mutex_init(&base->mtx, "base", WITNESS_RANK_BASE,
 	    malloc_mutex_rank_exclusive)) {
-		base_unmap(extent_hooks, ind, block, block->size);
+		base_unmap(block_hooks, ind, block, block->size);
 		return NULL;
 	}
 	base->pind_last = pind_last;
@@ -273,7 +289,7 @@ base_new(tsdn_t *tsdn, unsigned ind, extent_hooks_t *extent_hooks) {
 
 void
 base_delete(base_t *base) {
-	extent_hooks_t *extent_hooks = base_extent_hooks_get(base);
+	extent_hooks_t *extent_hooks = base_block_hooks_get(base);
 	base_block_t *next = base->blocks;
 	do {
 		base_block_t *block = next;
@@ -356,6 +372,28 @@ base_alloc_extent(tsdn_t *tsdn, base_t *base) {
 	return extent;
 }
 
+/*
+ * Allocates nextents extent_t structures with a single base allocation, and
+ * stores pointers to them in extents.  Returns true on error.
+ */
+bool
+base_alloc_extents(tsdn_t *tsdn, base_t *base, extent_t **extents,
+    unsigned nextents) {
+	size_t stride = CACHELINE_CEILING(sizeof(extent_t));
+	size_t esn;
+	void *addr = base_alloc_impl(tsdn, base, stride * nextents, CACHELINE,
+	    &esn);
+	if (addr == NULL) {
+		return true;
+	}
+	for (unsigned i = 0; i < nextents; i++) {
+		extent_t *extent = (extent_t *)((uintptr_t)addr + i * stride);
+		extent_esn_set(extent, esn);
+		extents[i] = extent;
+	}
+	return false;
+}
+
 void
 base_stats_get(tsdn_t *tsdn, base_t *base, size_t *allocated, size_t *resident,
     size_t *mapped) {
@@ -387,6 +425,6 @@ base_postfork_child(tsdn_t *tsdn, base_t *base) {
 
 bool
 base_boot(tsdn_t *tsdn) {
-	b0 = base_new(tsdn, 0, (extent_hooks_t *)&extent_hooks_default);
+	b0 = base_new(tsdn, 0, (extent_hooks_t *)&extent_hooks_default, true);
 	return (b0 == NULL);
 }
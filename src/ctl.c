@@ -4,6 +4,7 @@
 
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/ctl.h"
+#include "jemalloc/internal/extent_backing.h"
 #include "jemalloc/internal/extent_dss.h"
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/mutex.h"
@@ -61,11 +62,15 @@ CTL_PROTO(thread_tcache_enabled)
 CTL_PROTO(thread_tcache_flush)
 CTL_PROTO(thread_prof_name)
 CTL_PROTO(thread_prof_active)
+CTL_PROTO(thread_prof_tag)
 CTL_PROTO(thread_arena)
 CTL_PROTO(thread_allocated)
 CTL_PROTO(thread_allocatedp)
 CTL_PROTO(thread_deallocated)
 CTL_PROTO(thread_deallocatedp)
+CTL_PROTO(thread_rtree_cache_l1_hits)
+CTL_PROTO(thread_rtree_cache_l2_hits)
+CTL_PROTO(thread_rtree_cache_misses)
 CTL_PROTO(config_cache_oblivious)
 CTL_PROTO(config_debug)
 CTL_PROTO(config_fill)
@@ -74,6 +79,8 @@ CTL_PROTO(config_malloc_conf)
 CTL_PROTO(config_prof)
 CTL_PROTO(config_prof_libgcc)
 CTL_PROTO(config_prof_libunwind)
+CTL_PROTO(config_rtree_ctx_stats)
+CTL_PROTO(config_rtree_flat)
 CTL_PROTO(config_stats)
 CTL_PROTO(config_thp)
 CTL_PROTO(config_utrace)
@@ -81,10 +88,17 @@ CTL_PROTO(config_xmalloc)
 CTL_PROTO(opt_abort)
 CTL_PROTO(opt_abort_conf)
 CTL_PROTO(opt_retain)
+CTL_PROTO(opt_retain_grow_limit)
+CTL_PROTO(opt_reserve_vm)
 CTL_PROTO(opt_dss)
+CTL_PROTO(opt_extent_fit)
+CTL_PROTO(opt_zero_purge_threshold)
+CTL_PROTO(opt_thp_policy)
 CTL_PROTO(opt_narenas)
 CTL_PROTO(opt_percpu_arena)
+CTL_PROTO(opt_prefault)
 CTL_PROTO(opt_background_thread)
+CTL_PROTO(opt_background_purge_only)
 CTL_PROTO(opt_dirty_decay_ms)
 CTL_PROTO(opt_muzzy_decay_ms)
 CTL_PROTO(opt_stats_print)
@@ -93,8 +107,11 @@ CTL_PROTO(opt_junk)
 CTL_PROTO(opt_zero)
 CTL_PROTO(opt_utrace)
 CTL_PROTO(opt_xmalloc)
+CTL_PROTO(opt_rtree_flat)
+CTL_PROTO(opt_sized_dealloc_check)
 CTL_PROTO(opt_tcache)
 CTL_PROTO(opt_lg_tcache_max)
+CTL_PROTO(opt_tcache_gc_incr_bytes)
 CTL_PROTO(opt_prof)
 CTL_PROTO(opt_prof_prefix)
 CTL_PROTO(opt_prof_active)
@@ -114,6 +131,8 @@ CTL_PROTO(arena_i_purge)
 CTL_PROTO(arena_i_reset)
 CTL_PROTO(arena_i_destroy)
 CTL_PROTO(arena_i_dss)
+CTL_PROTO(arena_i_prefault)
+CTL_PROTO(arena_i_retain_grow_limit)
 CTL_PROTO(arena_i_dirty_decay_ms)
 CTL_PROTO(arena_i_muzzy_decay_ms)
 CTL_PROTO(arena_i_extent_hooks)
@@ -129,14 +148,21 @@ CTL_PROTO(arenas_dirty_decay_ms)
 CTL_PROTO(arenas_muzzy_decay_ms)
 CTL_PROTO(arenas_quantum)
 CTL_PROTO(arenas_page)
+CTL_PROTO(arenas_reserve_vm_base)
 CTL_PROTO(arenas_tcache_max)
 CTL_PROTO(arenas_nbins)
 CTL_PROTO(arenas_nhbins)
 CTL_PROTO(arenas_nlextents)
 CTL_PROTO(arenas_create)
+CTL_PROTO(arenas_create_backed)
 CTL_PROTO(prof_thread_active_init)
 CTL_PROTO(prof_active)
 CTL_PROTO(prof_dump)
+CTL_PROTO(prof_dump_duration)
+CTL_PROTO(prof_dump_bytes)
+CTL_PROTO(prof_dump_baseline)
+CTL_PROTO(prof_dump_diff)
+CTL_PROTO(prof_dump_diff_threshold)
 CTL_PROTO(prof_gdump)
 CTL_PROTO(prof_reset)
 CTL_PROTO(prof_interval)
@@ -174,12 +200,16 @@ CTL_PROTO(stats_arenas_i_pdirty)
 CTL_PROTO(stats_arenas_i_pmuzzy)
 CTL_PROTO(stats_arenas_i_mapped)
 CTL_PROTO(stats_arenas_i_retained)
+CTL_PROTO(stats_arenas_i_retained_fresh)
+CTL_PROTO(stats_arenas_i_prefaulted)
+CTL_PROTO(stats_arenas_i_thp_collapsed)
 CTL_PROTO(stats_arenas_i_dirty_npurge)
 CTL_PROTO(stats_arenas_i_dirty_nmadvise)
 CTL_PROTO(stats_arenas_i_dirty_purged)
 CTL_PROTO(stats_arenas_i_muzzy_npurge)
 CTL_PROTO(stats_arenas_i_muzzy_nmadvise)
 CTL_PROTO(stats_arenas_i_muzzy_purged)
+CTL_PROTO(stats_arenas_i_npurge_inline)
 CTL_PROTO(stats_arenas_i_base)
 CTL_PROTO(stats_arenas_i_internal)
 CTL_PROTO(stats_arenas_i_tcache_bytes)
@@ -194,6 +224,13 @@ CTL_PROTO(stats_metadata)
 CTL_PROTO(stats_resident)
 CTL_PROTO(stats_mapped)
 CTL_PROTO(stats_retained)
+CTL_PROTO(stats_prof_tags_i_curobjs)
+CTL_PROTO(stats_prof_tags_i_curbytes)
+INDEX_PROTO(stats_prof_tags_i)
+CTL_PROTO(experimental_hooks_prof_backtrace)
+CTL_PROTO(experimental_hooks_prof_dump)
+CTL_PROTO(experimental_hooks_prof_sample)
+CTL_PROTO(experimental_hooks_prof_sample_free)
 
 #define MUTEX_STATS_CTL_PROTO_GEN(n)					\
 CTL_PROTO(stats_##n##_num_ops)						\
@@ -243,7 +280,14 @@ static const ctl_named_node_t	thread_tcache_node[] = {
 
 static const ctl_named_node_t	thread_prof_node[] = {
 	{NAME("name"),		CTL(thread_prof_name)},
-	{NAME("active"),	CTL(thread_prof_active)}
+	{NAME("active"),	CTL(thread_prof_active)},
+	{NAME("tag"),		CTL(thread_prof_tag)}
+};
+
+static const ctl_named_node_t	thread_rtree_cache_node[] = {
+	{NAME("l1_hits"),	CTL(thread_rtree_cache_l1_hits)},
+	{NAME("l2_hits"),	CTL(thread_rtree_cache_l2_hits)},
+	{NAME("misses"),	CTL(thread_rtree_cache_misses)}
 };
 
 static const ctl_named_node_t	thread_node[] = {
@@ -253,7 +297,8 @@ static const ctl_named_node_t	thread_node[] = {
 	{NAME("deallocated"),	CTL(thread_deallocated)},
 	{NAME("deallocatedp"),	CTL(thread_deallocatedp)},
 	{NAME("tcache"),	CHILD(named, thread_tcache)},
-	{NAME("prof"),		CHILD(named, thread_prof)}
+	{NAME("prof"),		CHILD(named, thread_prof)},
+	{NAME("rtree_cache"),	CHILD(named, thread_rtree_cache)}
 };
 
 static const ctl_named_node_t	config_node[] = {
@@ -265,6 +310,8 @@ static const ctl_named_node_t	config_node[] = {
 	{NAME("prof"),		CTL(config_prof)},
 	{NAME("prof_libgcc"),	CTL(config_prof_libgcc)},
 	{NAME("prof_libunwind"), CTL(config_prof_libunwind)},
+	{NAME("rtree_ctx_stats"), CTL(config_rtree_ctx_stats)},
+	{NAME("rtree_flat"),	CTL(config_rtree_flat)},
 	{NAME("stats"),		CTL(config_stats)},
 	{NAME("thp"),		CTL(config_thp)},
 	{NAME("utrace"),	CTL(config_utrace)},
@@ -275,10 +322,17 @@ static const ctl_named_node_t opt_node[] = {
 	{NAME("abort"),		CTL(opt_abort)},
 	{NAME("abort_conf"),	CTL(opt_abort_conf)},
 	{NAME("retain"),	CTL(opt_retain)},
+	{NAME("retain_grow_limit"),	CTL(opt_retain_grow_limit)},
+	{NAME("reserve_vm"),	CTL(opt_reserve_vm)},
 	{NAME("dss"),		CTL(opt_dss)},
+	{NAME("extent_fit"),	CTL(opt_extent_fit)},
+	{NAME("zero_purge_threshold"),	CTL(opt_zero_purge_threshold)},
+	{NAME("thp_policy"),	CTL(opt_thp_policy)},
 	{NAME("narenas"),	CTL(opt_narenas)},
 	{NAME("percpu_arena"),	CTL(opt_percpu_arena)},
+	{NAME("prefault"),	CTL(opt_prefault)},
 	{NAME("background_thread"),	CTL(opt_background_thread)},
+	{NAME("background_purge_only"),	CTL(opt_background_purge_only)},
 	{NAME("dirty_decay_ms"), CTL(opt_dirty_decay_ms)},
 	{NAME("muzzy_decay_ms"), CTL(opt_muzzy_decay_ms)},
 	{NAME("stats_print"),	CTL(opt_stats_print)},
@@ -287,8 +341,11 @@ static const ctl_named_node_t opt_node[] = {
 	{NAME("zero"),		CTL(opt_zero)},
 	{NAME("utrace"),	CTL(opt_utrace)},
 	{NAME("xmalloc"),	CTL(opt_xmalloc)},
+	{NAME("rtree_flat"),	CTL(opt_rtree_flat)},
+	{NAME("sized_dealloc_check"),	CTL(opt_sized_dealloc_check)},
 	{NAME("tcache"),	CTL(opt_tcache)},
 	{NAME("lg_tcache_max"),	CTL(opt_lg_tcache_max)},
+	{NAME("tcache_gc_incr_bytes"),	CTL(opt_tcache_gc_incr_bytes)},
 	{NAME("prof"),		CTL(opt_prof)},
 	{NAME("prof_prefix"),	CTL(opt_prof_prefix)},
 	{NAME("prof_active"),	CTL(opt_prof_active)},
@@ -314,6 +371,8 @@ static const ctl_named_node_t arena_i_node[] = {
 	{NAME("reset"),		CTL(arena_i_reset)},
 	{NAME("destroy"),	CTL(arena_i_destroy)},
 	{NAME("dss"),		CTL(arena_i_dss)},
+	{NAME("prefault"),	CTL(arena_i_prefault)},
+	{NAME("retain_grow_limit"),	CTL(arena_i_retain_grow_limit)},
 	{NAME("dirty_decay_ms"), CTL(arena_i_dirty_decay_ms)},
 	{NAME("muzzy_decay_ms"), CTL(arena_i_muzzy_decay_ms)},
 	{NAME("extent_hooks"),	CTL(arena_i_extent_hooks)}
@@ -356,19 +415,26 @@ static const ctl_named_node_t arenas_node[] = {
 	{NAME("muzzy_decay_ms"), CTL(arenas_muzzy_decay_ms)},
 	{NAME("quantum"),	CTL(arenas_quantum)},
 	{NAME("page"),		CTL(arenas_page)},
+	{NAME("reserve_vm_base"), CTL(arenas_reserve_vm_base)},
 	{NAME("tcache_max"),	CTL(arenas_tcache_max)},
 	{NAME("nbins"),		CTL(arenas_nbins)},
 	{NAME("nhbins"),	CTL(arenas_nhbins)},
 	{NAME("bin"),		CHILD(indexed, arenas_bin)},
 	{NAME("nlextents"),	CTL(arenas_nlextents)},
 	{NAME("lextent"),	CHILD(indexed, arenas_lextent)},
-	{NAME("create"),	CTL(arenas_create)}
+	{NAME("create"),	CTL(arenas_create)},
+	{NAME("create_backed"),	CTL(arenas_create_backed)}
 };
 
 static const ctl_named_node_t	prof_node[] = {
 	{NAME("thread_active_init"), CTL(prof_thread_active_init)},
 	{NAME("active"),	CTL(prof_active)},
 	{NAME("dump"),		CTL(prof_dump)},
+	{NAME("dump_duration"),	CTL(prof_dump_duration)},
+	{NAME("dump_bytes"),	CTL(prof_dump_bytes)},
+	{NAME("dump_baseline"),	CTL(prof_dump_baseline)},
+	{NAME("dump_diff"),	CTL(prof_dump_diff)},
+	{NAME("dump_diff_threshold"),	CTL(prof_dump_diff_threshold)},
 	{NAME("gdump"),		CTL(prof_gdump)},
 	{NAME("reset"),		CTL(prof_reset)},
 	{NAME("interval"),	CTL(prof_interval)},
@@ -466,12 +532,16 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
 	{NAME("pmuzzy"),	CTL(stats_arenas_i_pmuzzy)},
 	{NAME("mapped"),	CTL(stats_arenas_i_mapped)},
 	{NAME("retained"),	CTL(stats_arenas_i_retained)},
+	{NAME("retained_fresh"),	CTL(stats_arenas_i_retained_fresh)},
+	{NAME("prefaulted"),	CTL(stats_arenas_i_prefaulted)},
+	{NAME("thp_collapsed"),	CTL(stats_arenas_i_thp_collapsed)},
 	{NAME("dirty_npurge"),	CTL(stats_arenas_i_dirty_npurge)},
 	{NAME("dirty_nmadvise"), CTL(stats_arenas_i_dirty_nmadvise)},
 	{NAME("dirty_purged"),	CTL(stats_arenas_i_dirty_purged)},
 	{NAME("muzzy_npurge"),	CTL(stats_arenas_i_muzzy_npurge)},
 	{NAME("muzzy_nmadvise"), CTL(stats_arenas_i_muzzy_nmadvise)},
 	{NAME("muzzy_purged"),	CTL(stats_arenas_i_muzzy_purged)},
+	{NAME("npurge_inline"),	CTL(stats_arenas_i_npurge_inline)},
 	{NAME("base"),		CTL(stats_arenas_i_base)},
 	{NAME("internal"),	CTL(stats_arenas_i_internal)},
 	{NAME("tcache_bytes"),	CTL(stats_arenas_i_tcache_bytes)},
@@ -508,6 +578,22 @@ MUTEX_PROF_GLOBAL_MUTEXES
 };
 #undef MUTEX_PROF_DATA_NODE
 
+static const ctl_named_node_t stats_prof_tags_i_node[] = {
+	{NAME("curobjs"),	CTL(stats_prof_tags_i_curobjs)},
+	{NAME("curbytes"),	CTL(stats_prof_tags_i_curbytes)}
+};
+static const ctl_named_node_t super_stats_prof_tags_i_node[] = {
+	{NAME(""),		CHILD(named, stats_prof_tags_i)}
+};
+
+static const ctl_indexed_node_t stats_prof_tags_node[] = {
+	{INDEX(stats_prof_tags_i)}
+};
+
+static const ctl_named_node_t stats_prof_node[] = {
+	{NAME("tags"),		CHILD(indexed, stats_prof_tags)}
+};
+
 static const ctl_named_node_t stats_node[] = {
 	{NAME("allocated"),	CTL(stats_allocated)},
 	{NAME("active"),	CTL(stats_active)},
@@ -518,9 +604,22 @@ static const ctl_named_node_t stats_node[] = {
 	{NAME("background_thread"),
 	 CHILD(named, stats_background_thread)},
 	{NAME("mutexes"),	CHILD(named, stats_mutexes)},
+	{NAME("prof"),		CHILD(named, stats_prof)},
 	{NAME("arenas"),	CHILD(indexed, stats_arenas)}
 };
 
+static const ctl_named_node_t experimental_hooks_node[] = {
+	{NAME("prof_backtrace"),	CTL(experimental_hooks_prof_backtrace)},
+	{NAME("prof_dump"),	CTL(experimental_hooks_prof_dump)},
+	{NAME("prof_sample"),	CTL(experimental_hooks_prof_sample)},
+	{NAME("prof_sample_free"),
+	 CTL(experimental_hooks_prof_sample_free)}
+};
+
+static const ctl_named_node_t experimental_node[] = {
+	{NAME("hooks"),		CHILD(named, experimental_hooks)}
+};
+
 static const ctl_named_node_t	root_node[] = {
 	{NAME("version"),	CTL(version)},
 	{NAME("epoch"),		CTL(epoch)},
@@ -532,7 +631,8 @@ static const ctl_named_node_t	root_node[] = {
 	{NAME("arena"),		CHILD(indexed, arena)},
 	{NAME("arenas"),	CHILD(named, arenas)},
 	{NAME("prof"),		CHILD(named, prof)},
-	{NAME("stats"),		CHILD(named, stats)}
+	{NAME("stats"),		CHILD(named, stats)},
+	{NAME("experimental"),	CHILD(named, experimental)}
 };
 static const ctl_named_node_t super_root_node[] = {
 	{NAME(""),		CHILD(named, root)}
@@ -743,6 +843,8 @@ ctl_arena_stats_sdmerge(ctl_arena_t *ctl_sdarena, ctl_arena_t *ctl_arena,
 			    &astats->astats.mapped);
 			accum_atomic_zu(&sdstats->astats.retained,
 			    &astats->astats.retained);
+			accum_atomic_zu(&sdstats->astats.retained_fresh,
+			    &astats->astats.retained_fresh);
 		}
 
 		accum_arena_stats_u64(&sdstats->astats.decay_dirty.npurge,
@@ -758,6 +860,13 @@ ctl_arena_stats_sdmerge(ctl_arena_t *ctl_sdarena, ctl_arena_t *ctl_arena,
 		    &astats->astats.decay_muzzy.nmadvise);
 		accum_arena_stats_u64(&sdstats->astats.decay_muzzy.purged,
 		    &astats->astats.decay_muzzy.purged);
+		accum_arena_stats_u64(&sdstats->astats.npurge_inline,
+		    &astats->astats.npurge_inline);
+
+		accum_arena_stats_u64(&sdstats->astats.prefaulted,
+		    &astats->astats.prefaulted);
+		accum_arena_stats_u64(&sdstats->astats.thp_collapsed,
+		    &astats->astats.thp_collapsed);
 
 #define OP(mtx) malloc_mutex_prof_merge(				\
 		    &(sdstats->astats.mutex_prof_data[			\
@@ -1558,6 +1667,8 @@ CTL_RO_CONFIG_GEN(config_malloc_conf, const char *)
 CTL_RO_CONFIG_GEN(config_prof, bool)
 CTL_RO_CONFIG_GEN(config_prof_libgcc, bool)
 CTL_RO_CONFIG_GEN(config_prof_libunwind, bool)
+CTL_RO_CONFIG_GEN(config_rtree_ctx_stats, bool)
+CTL_RO_CONFIG_GEN(config_rtree_flat, bool)
 CTL_RO_CONFIG_GEN(config_stats, bool)
 CTL_RO_CONFIG_GEN(config_thp, bool)
 CTL_RO_CONFIG_GEN(config_utrace, bool)
@@ -1568,11 +1679,18 @@ CTL_RO_CONFIG_GEN(config_xmalloc, bool)
 CTL_RO_NL_GEN(opt_abort, opt_abort, bool)
 CTL_RO_NL_GEN(opt_abort_conf, opt_abort_conf, bool)
 CTL_RO_NL_GEN(opt_retain, opt_retain, bool)
+CTL_RO_NL_GEN(opt_retain_grow_limit, opt_retain_grow_limit, size_t)
+CTL_RO_NL_GEN(opt_reserve_vm, opt_reserve_vm, size_t)
 CTL_RO_NL_GEN(opt_dss, opt_dss, const char *)
+CTL_RO_NL_GEN(opt_extent_fit, extent_fit_names[opt_extent_fit], const char *)
+CTL_RO_NL_GEN(opt_zero_purge_threshold, opt_zero_purge_threshold, size_t)
+CTL_RO_NL_GEN(opt_thp_policy, thp_policy_names[opt_thp_policy], const char *)
 CTL_RO_NL_GEN(opt_narenas, opt_narenas, unsigned)
 CTL_RO_NL_GEN(opt_percpu_arena, percpu_arena_mode_names[opt_percpu_arena],
     const char *)
+CTL_RO_NL_GEN(opt_prefault, prefault_names[opt_prefault], const char *)
 CTL_RO_NL_GEN(opt_background_thread, opt_background_thread, bool)
+CTL_RO_NL_GEN(opt_background_purge_only, opt_background_purge_only, bool)
 CTL_RO_NL_GEN(opt_dirty_decay_ms, opt_dirty_decay_ms, ssize_t)
 CTL_RO_NL_GEN(opt_muzzy_decay_ms, opt_muzzy_decay_ms, ssize_t)
 CTL_RO_NL_GEN(opt_stats_print, opt_stats_print, bool)
@@ -1581,8 +1699,11 @@ CTL_RO_NL_CGEN(config_fill, opt_junk, opt_junk, const char *)
 CTL_RO_NL_CGEN(config_fill, opt_zero, opt_zero, bool)
 CTL_RO_NL_CGEN(config_utrace, opt_utrace, opt_utrace, bool)
 CTL_RO_NL_CGEN(config_xmalloc, opt_xmalloc, opt_xmalloc, bool)
+CTL_RO_NL_CGEN(config_rtree_flat, opt_rtree_flat, opt_rtree_flat, bool)
+CTL_RO_NL_GEN(opt_sized_dealloc_check, opt_sized_dealloc_check, bool)
 CTL_RO_NL_GEN(opt_tcache, opt_tcache, bool)
 CTL_RO_NL_GEN(opt_lg_tcache_max, opt_lg_tcache_max, ssize_t)
+CTL_RO_NL_GEN(opt_tcache_gc_incr_bytes, opt_tcache_gc_incr_bytes, size_t)
 CTL_RO_NL_CGEN(config_prof, opt_prof, opt_prof, bool)
 CTL_RO_NL_CGEN(config_prof, opt_prof_prefix, opt_prof_prefix, const char *)
 CTL_RO_NL_CGEN(config_prof, opt_prof_active, opt_prof_active, bool)
@@ -1662,6 +1783,28 @@ CTL_TSD_RO_NL_CGEN(config_stats, thread_deallocated, tsd_thread_deallocated_get,
 CTL_TSD_RO_NL_CGEN(config_stats, thread_deallocatedp,
     tsd_thread_deallocatedp_get, uint64_t *)
 
+static uint64_t
+thread_rtree_cache_l1_hits_get(tsd_t *tsd) {
+	return tsd_rtree_ctx(tsd)->stats.l1_hits;
+}
+
+static uint64_t
+thread_rtree_cache_l2_hits_get(tsd_t *tsd) {
+	return tsd_rtree_ctx(tsd)->stats.l2_hits;
+}
+
+static uint64_t
+thread_rtree_cache_misses_get(tsd_t *tsd) {
+	return tsd_rtree_ctx(tsd)->stats.misses;
+}
+
+CTL_TSD_RO_NL_CGEN(config_rtree_ctx_stats, thread_rtree_cache_l1_hits,
+    thread_rtree_cache_l1_hits_get, uint64_t)
+CTL_TSD_RO_NL_CGEN(config_rtree_ctx_stats, thread_rtree_cache_l2_hits,
+    thread_rtree_cache_l2_hits_get, uint64_t)
+CTL_TSD_RO_NL_CGEN(config_rtree_ctx_stats, thread_rtree_cache_misses,
+    thread_rtree_cache_misses_get, uint64_t)
+
 static int
 thread_tcache_enabled_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
     void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
@@ -1762,6 +1905,35 @@ label_return:
 	return ret;
 }
 
+static int
+thread_prof_tag_ctl(tsd_t *tsd, const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	unsigned oldval;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	oldval = prof_thread_tag_get(tsd);
+	if (newp != NULL) {
+		if (newlen != sizeof(unsigned) || *(unsigned *)newp >=
+		    PROF_NTAGS) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		if (prof_thread_tag_set(tsd, *(unsigned *)newp)) {
+			ret = EAGAIN;
+			goto label_return;
+		}
+	}
+	READ(oldval, unsigned);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
 /******************************************************************************/
 
 static int
@@ -2101,6 +2273,112 @@ label_return:
 	return ret;
 }
 
+static int
+arena_i_prefault_ctl(tsd_t *tsd, const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	const char *prefault = NULL;
+	unsigned arena_ind;
+	prefault_t prefault_old = prefault_limit;
+	prefault_t prefault_new = prefault_limit;
+
+	malloc_mutex_lock(tsd_tsdn(tsd), &ctl_mtx);
+	WRITE(prefault, const char *);
+	MIB_UNSIGNED(arena_ind, 1);
+	if (prefault != NULL) {
+		int i;
+		bool match = false;
+
+		for (i = 0; i < prefault_limit; i++) {
+			if (strcmp(prefault_names[i], prefault) == 0) {
+				prefault_new = i;
+				match = true;
+				break;
+			}
+		}
+
+		if (!match) {
+			ret = EINVAL;
+			goto label_return;
+		}
+	}
+
+	if (arena_ind == MALLCTL_ARENAS_ALL) {
+		/* Applies to all existing arenas and to those created later. */
+		prefault_old = arena_prefault_default_get();
+		if (prefault_new != prefault_limit) {
+			unsigned i, narenas = narenas_total_get();
+
+			arena_prefault_default_set(prefault_new);
+			for (i = 0; i < narenas; i++) {
+				arena_t *arena = arena_get(tsd_tsdn(tsd), i,
+				    false);
+				if (arena != NULL) {
+					arena_prefault_set(arena,
+					    prefault_new);
+				}
+			}
+		}
+	} else {
+		arena_t *arena;
+		if (arena_ind >= narenas_total_get() || (arena =
+		    arena_get(tsd_tsdn(tsd), arena_ind, false)) == NULL) {
+			ret = EFAULT;
+			goto label_return;
+		}
+		prefault_old = arena_prefault_get(arena);
+		if (prefault_new != prefault_limit) {
+			arena_prefault_set(arena, prefault_new);
+		}
+	}
+
+	prefault = prefault_names[prefault_old];
+	READ(prefault, const char *);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(tsd_tsdn(tsd), &ctl_mtx);
+	return ret;
+}
+
+static int
+arena_i_retain_grow_limit_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	unsigned arena_ind;
+	arena_t *arena;
+
+	if (!opt_retain) {
+		/* Only relevant when retain is enabled. */
+		return ENOENT;
+	}
+
+	MIB_UNSIGNED(arena_ind, 1);
+	if (arena_ind >= narenas_total_get() || (arena = arena_get(tsd_tsdn(tsd),
+	    arena_ind, false)) == NULL) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	size_t old_limit = arena_retain_grow_limit_get(tsd_tsdn(tsd), arena);
+	READ(old_limit, size_t);
+	if (newp != NULL) {
+		if (newlen != sizeof(size_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		if (arena_retain_grow_limit_set(tsd_tsdn(tsd), arena,
+		    *(size_t *)newp)) {
+			ret = EFAULT;
+			goto label_return;
+		}
+	}
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
 static int
 arena_i_decay_ms_ctl_impl(tsd_t *tsd, const size_t *mib, size_t miblen,
     void *oldp, size_t *oldlenp, void *newp, size_t newlen, bool dirty) {
@@ -2275,6 +2553,7 @@ arenas_muzzy_decay_ms_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
 
 CTL_RO_NL_GEN(arenas_quantum, QUANTUM, size_t)
 CTL_RO_NL_GEN(arenas_page, PAGE, size_t)
+CTL_RO_NL_GEN(arenas_reserve_vm_base, extent_mmap_reserve_base(), void *)
 CTL_RO_NL_GEN(arenas_tcache_max, tcache_maxclass, size_t)
 CTL_RO_NL_GEN(arenas_nbins, NBINS, unsigned)
 CTL_RO_NL_GEN(arenas_nhbins, nhbins, unsigned)
@@ -2325,6 +2604,41 @@ label_return:
 	return ret;
 }
 
+static int
+arenas_create_backed_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	const char *backing = NULL;
+	extent_hooks_t *extent_hooks;
+	unsigned arena_ind;
+
+	malloc_mutex_lock(tsd_tsdn(tsd), &ctl_mtx);
+
+	WRITE(backing, const char *);
+	if (backing == NULL || extent_backing_hooks_new(tsd_tsdn(tsd),
+	    backing, &extent_hooks)) {
+		ret = EINVAL;
+		goto label_return;
+	}
+	/*
+	 * The arena's metadata does not come from the backing, so check that
+	 * the backing can supply memory at all before creating the arena.
+	 */
+	if (extent_backing_hooks_prime(tsd_tsdn(tsd), extent_hooks) ||
+	    (arena_ind = ctl_arena_init(tsd_tsdn(tsd), extent_hooks)) ==
+	    UINT_MAX) {
+		extent_backing_hooks_release(tsd_tsdn(tsd), extent_hooks);
+		ret = EAGAIN;
+		goto label_return;
+	}
+	READ(arena_ind, unsigned);
+
+	ret = 0;
+label_return:
+	malloc_mutex_unlock(tsd_tsdn(tsd), &ctl_mtx);
+	return ret;
+}
+
 /******************************************************************************/
 
 static int
@@ -2403,6 +2717,116 @@ label_return:
 	return ret;
 }
 
+static int
+prof_dump_duration_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	uint64_t duration_ns;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	READONLY();
+	prof_dump_stats_get(tsd_tsdn(tsd), &duration_ns, NULL);
+	READ(duration_ns, uint64_t);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+prof_dump_bytes_ctl(tsd_t *tsd, const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	uint64_t nbytes;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	READONLY();
+	prof_dump_stats_get(tsd_tsdn(tsd), NULL, &nbytes);
+	READ(nbytes, uint64_t);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+prof_dump_baseline_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	READONLY();
+	WRITEONLY();
+
+	if (prof_dump_baseline(tsd)) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+prof_dump_diff_ctl(tsd_t *tsd, const size_t *mib, size_t miblen, void *oldp,
+    size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	const char *filename = NULL;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	WRITEONLY();
+	WRITE(filename, const char *);
+
+	if (prof_dump_diff(tsd, filename)) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+prof_dump_diff_threshold_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	size_t oldval;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	if (newp != NULL) {
+		if (newlen != sizeof(size_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		oldval = prof_dump_diff_threshold_set(tsd_tsdn(tsd),
+		    *(size_t *)newp);
+	} else {
+		oldval = prof_dump_diff_threshold_get(tsd_tsdn(tsd));
+	}
+	READ(oldval, size_t);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
 static int
 prof_gdump_ctl(tsd_t *tsd, const size_t *mib, size_t miblen, void *oldp,
     size_t *oldlenp, void *newp, size_t newlen) {
@@ -2488,6 +2912,15 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_mapped,
 CTL_RO_CGEN(config_stats, stats_arenas_i_retained,
     atomic_load_zu(&arenas_i(mib[2])->astats->astats.retained, ATOMIC_RELAXED),
     size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_retained_fresh,
+    atomic_load_zu(&arenas_i(mib[2])->astats->astats.retained_fresh,
+    ATOMIC_RELAXED), size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_prefaulted,
+    arena_stats_read_u64(&arenas_i(mib[2])->astats->astats.prefaulted),
+    uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_thp_collapsed,
+    arena_stats_read_u64(&arenas_i(mib[2])->astats->astats.thp_collapsed),
+    uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_dirty_npurge,
     arena_stats_read_u64(&arenas_i(mib[2])->astats->astats.decay_dirty.npurge),
@@ -2508,6 +2941,9 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_muzzy_nmadvise,
 CTL_RO_CGEN(config_stats, stats_arenas_i_muzzy_purged,
     arena_stats_read_u64(&arenas_i(mib[2])->astats->astats.decay_muzzy.purged),
     uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_npurge_inline,
+    arena_stats_read_u64(&arenas_i(mib[2])->astats->astats.npurge_inline),
+    uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_base,
     atomic_load_zu(&arenas_i(mib[2])->astats->astats.base, ATOMIC_RELAXED),
@@ -2679,6 +3115,53 @@ stats_arenas_i_lextents_j_index(tsdn_t *tsdn, const size_t *mib, size_t miblen,
 	return super_stats_arenas_i_lextents_j_node;
 }
 
+static int
+stats_prof_tags_i_curobjs_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	size_t curobjs;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	READONLY();
+	prof_tag_stats_get((unsigned)mib[3], &curobjs, NULL);
+	READ(curobjs, size_t);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+stats_prof_tags_i_curbytes_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+	size_t curbytes;
+
+	if (!config_prof) {
+		return ENOENT;
+	}
+
+	READONLY();
+	prof_tag_stats_get((unsigned)mib[3], NULL, &curbytes);
+	READ(curbytes, size_t);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static const ctl_named_node_t *
+stats_prof_tags_i_index(tsdn_t *tsdn, const size_t *mib, size_t miblen,
+    size_t i) {
+	if (!config_prof || i >= PROF_NTAGS) {
+		return NULL;
+	}
+	return super_stats_prof_tags_i_node;
+}
+
 static const ctl_named_node_t *
 stats_arenas_i_index(tsdn_t *tsdn, const size_t *mib, size_t miblen, size_t i) {
 	const ctl_named_node_t *ret;
@@ -2696,3 +3179,45 @@ label_return:
 	malloc_mutex_unlock(tsdn, &ctl_mtx);
 	return ret;
 }
+
+/******************************************************************************/
+
+/*
+ * Hooks are swapped atomically and take effect for subsequent events.  A NULL
+ * hook disables the corresponding callback, except for the backtrace hook,
+ * which must always be set.
+ */
+#define EXPERIMENTAL_PROF_HOOK_CTL_GEN(n, null_ok)			\
+static int								\
+experimental_hooks_##n##_ctl(tsd_t *tsd, const size_t *mib,		\
+    size_t miblen, void *oldp, size_t *oldlenp, void *newp,		\
+    size_t newlen) {							\
+	int ret;							\
+									\
+	if (!config_prof) {						\
+		return ENOENT;						\
+	}								\
+									\
+	if (oldp != NULL) {						\
+		n##_hook_t old_hook = n##_hook_get();			\
+		READ(old_hook, n##_hook_t);				\
+	}								\
+	if (newp != NULL) {						\
+		n##_hook_t new_hook JEMALLOC_CC_SILENCE_INIT(NULL);	\
+		WRITE(new_hook, n##_hook_t);				\
+		if (!(null_ok) && new_hook == NULL) {			\
+			ret = EINVAL;					\
+			goto label_return;				\
+		}							\
+		n##_hook_set(new_hook);					\
+	}								\
+	ret = 0;							\
+label_return:								\
+	return ret;							\
+}
+
+EXPERIMENTAL_PROF_HOOK_CTL_GEN(prof_backtrace, false)
+EXPERIMENTAL_PROF_HOOK_CTL_GEN(prof_dump, true)
+EXPERIMENTAL_PROF_HOOK_CTL_GEN(prof_sample, true)
+EXPERIMENTAL_PROF_HOOK_CTL_GEN(prof_sample_free, true)
+#undef EXPERIMENTAL_PROF_HOOK_CTL_GEN
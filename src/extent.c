@@ -17,6 +17,20 @@ rtree_t		extents_rtree;
 /* Keyed by the address of the extent_t being protected. */
 mutex_pool_t	extent_mutex_pool;
 
+extent_fit_t	opt_extent_fit = EXTENT_FIT_DEFAULT;
+const char	*extent_fit_names[] = {
+	"default",
+	"segregated"
+};
+
+size_t		opt_zero_purge_threshold = ZERO_PURGE_THRESHOLD_DEFAULT;
+
+thp_policy_t	opt_thp_policy = THP_POLICY_DEFAULT;
+const char	*thp_policy_names[] = {
+	"default",
+	"dense"
+};
+
 static const bitmap_info_t extents_bitmap_info =
     BITMAP_INFO_INITIALIZER(NPSIZES+1);
 
@@ -65,6 +79,8 @@ static bool extent_merge_default(extent_hooks_t *extent_hooks, void *addr_a,
 static bool extent_merge_impl(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, extent_t *a, extent_t *b,
     bool growing_retained);
+static void extent_interior_stale_clear(tsdn_t *tsdn, rtree_ctx_t *rtree_ctx,
+    extent_t *extent);
 
 const extent_hooks_t	extent_hooks_default = {
 	extent_alloc_default,
@@ -111,6 +127,9 @@ static extent_t *extent_recycle(tsdn_t *tsdn, arena_t *arena,
 static extent_t *extent_try_coalesce(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, rtree_ctx_t *rtree_ctx, extents_t *extents,
     extent_t *extent, bool *coalesced, bool growing_retained);
+static void extent_record_locked(tsdn_t *tsdn, arena_t *arena,
+    extent_hooks_t **r_extent_hooks, rtree_ctx_t *rtree_ctx, extents_t *extents,
+    extent_t *extent, bool growing_retained);
 static void extent_record(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, extents_t *extents, extent_t *extent,
     bool growing_retained);
@@ -171,8 +190,96 @@ extent_lock_from_addr(tsdn_t *tsdn, rtree_ctx_t *rtree_ctx, void *addr) {
 	return ret;
 }
 
+/*
+ * Returns the calling thread's auto tcache if it caches extent_t structures for
+ * arena, or NULL otherwise.  Like the tcache bins, the cache is bypassed on
+ * reentrancy, which may interrupt a refill.
+ */
+static tcache_t *
+extent_avail_tcache_get(tsdn_t *tsdn, arena_t *arena) {
+	if (tsdn_null(tsdn)) {
+		return NULL;
+	}
+	tsd_t *tsd = tsdn_tsd(tsdn);
+	if (tsd_reentrancy_level_get(tsd) > 0 || !tcache_available(tsd)) {
+		return NULL;
+	}
+	tcache_t *tcache = tsd_tcachep_get(tsd);
+	return (tcache->arena == arena) ? tcache : NULL;
+}
+
+/*
+ * Refills an empty tcache with half of TCACHE_NEXTENTS_MAX extent_t structures,
+ * taken from the arena under a single lock acquisition if possible, or else
+ * carved from base all at once.
+ */
+static void
+extent_avail_fill(tsdn_t *tsdn, arena_t *arena, tcache_t *tcache) {
+	assert(tcache->nextents_avail == 0);
+	unsigned nfill = TCACHE_NEXTENTS_MAX >> 1;
+
+	malloc_mutex_lock(tsdn, &arena->extent_avail_mtx);
+	for (unsigned i = 0; i < nfill; i++) {
+		extent_t *extent = extent_avail_first(&arena->extent_avail);
+		if (extent == NULL) {
+			break;
+		}
+		extent_avail_remove(&arena->extent_avail, extent);
+		tcache->extents_avail[tcache->nextents_avail++] = extent;
+	}
+	malloc_mutex_unlock(tsdn, &arena->extent_avail_mtx);
+
+	if (tcache->nextents_avail != 0) {
+		return;
+	}
+	/*
+	 * Carving may call the base's extent hooks, which may in turn call
+	 * malloc().  Mark the call as reentrant so that nested extent_alloc()
+	 * calls leave the cache alone until it has been refilled.
+	 */
+	tsd_t *tsd = tsdn_tsd(tsdn);
+	pre_reentrancy(tsd);
+	bool err = base_alloc_extents(tsdn, arena->base, tcache->extents_avail,
+	    nfill);
+	post_reentrancy(tsd);
+	if (!err) {
+		tcache->nextents_avail = nfill;
+	}
+}
+
+/* Returns all but the rem most recently cached extent_t's to the arena. */
+void
+extent_avail_flush(tsdn_t *tsdn, tcache_t *tcache, unsigned rem) {
+	if (tcache->nextents_avail <= rem) {
+		return;
+	}
+	arena_t *arena = tcache->arena;
+	unsigned nflush = tcache->nextents_avail - rem;
+
+	malloc_mutex_lock(tsdn, &arena->extent_avail_mtx);
+	for (unsigned i = 0; i < nflush; i++) {
+		extent_avail_insert(&arena->extent_avail,
+		    tcache->extents_avail[i]);
+	}
+	malloc_mutex_unlock(tsdn, &arena->extent_avail_mtx);
+	memmove(tcache->extents_avail, &tcache->extents_avail[nflush],
+	    rem * sizeof(extent_t *));
+	tcache->nextents_avail = rem;
+}
+
 extent_t *
 extent_alloc(tsdn_t *tsdn, arena_t *arena) {
+	tcache_t *tcache = extent_avail_tcache_get(tsdn, arena);
+	if (tcache != NULL) {
+		if (tcache->nextents_avail == 0) {
+			extent_avail_fill(tsdn, arena, tcache);
+			if (tcache->nextents_avail == 0) {
+				return NULL;
+			}
+		}
+		return tcache->extents_avail[--tcache->nextents_avail];
+	}
+
 	malloc_mutex_lock(tsdn, &arena->extent_avail_mtx);
 	extent_t *extent = extent_avail_first(&arena->extent_avail);
 	if (extent == NULL) {
@@ -186,6 +293,16 @@ extent_alloc(tsdn_t *tsdn, arena_t *arena) {
 
 void
 extent_dalloc(tsdn_t *tsdn, arena_t *arena, extent_t *extent) {
+	tcache_t *tcache = extent_avail_tcache_get(tsdn, arena);
+	if (tcache != NULL) {
+		if (tcache->nextents_avail == TCACHE_NEXTENTS_MAX) {
+			extent_avail_flush(tsdn, tcache,
+			    TCACHE_NEXTENTS_MAX >> 1);
+		}
+		tcache->extents_avail[tcache->nextents_avail++] = extent;
+		return;
+	}
+
 	malloc_mutex_lock(tsdn, &arena->extent_avail_mtx);
 	extent_avail_insert(&arena->extent_avail, extent);
 	malloc_mutex_unlock(tsdn, &arena->extent_avail_mtx);
@@ -288,6 +405,7 @@ extents_init(tsdn_t *tsdn, extents_t *extents, extent_state_t state,
 	bitmap_init(extents->bitmap, &extents_bitmap_info, true);
 	extent_list_init(&extents->lru);
 	atomic_store_zu(&extents->npages, 0, ATOMIC_RELAXED);
+	atomic_store_zu(&extents->nfresh_pages, 0, ATOMIC_RELAXED);
 	extents->state = state;
 	extents->delay_coalesce = delay_coalesce;
 	return false;
@@ -303,6 +421,11 @@ extents_npages_get(extents_t *extents) {
 	return atomic_load_zu(&extents->npages, ATOMIC_RELAXED);
 }
 
+size_t
+extents_nfresh_pages_get(extents_t *extents) {
+	return atomic_load_zu(&extents->nfresh_pages, ATOMIC_RELAXED);
+}
+
 static void
 extents_insert_locked(tsdn_t *tsdn, extents_t *extents, extent_t *extent,
     bool preserve_lru) {
@@ -330,6 +453,11 @@ extents_insert_locked(tsdn_t *tsdn, extents_t *extents, extent_t *extent,
 	    atomic_load_zu(&extents->npages, ATOMIC_RELAXED);
 	atomic_store_zu(&extents->npages, cur_extents_npages + npages,
 	    ATOMIC_RELAXED);
+	if (extent_fresh_get(extent)) {
+		atomic_store_zu(&extents->nfresh_pages,
+		    atomic_load_zu(&extents->nfresh_pages, ATOMIC_RELAXED) +
+		    npages, ATOMIC_RELAXED);
+	}
 }
 
 static void
@@ -359,6 +487,13 @@ extents_remove_locked(tsdn_t *tsdn, extents_t *extents, extent_t *extent,
 	assert(cur_extents_npages >= npages);
 	atomic_store_zu(&extents->npages,
 	    cur_extents_npages - (size >> LG_PAGE), ATOMIC_RELAXED);
+	if (extent_fresh_get(extent)) {
+		size_t cur_nfresh_pages = atomic_load_zu(&extents->nfresh_pages,
+		    ATOMIC_RELAXED);
+		assert(cur_nfresh_pages >= npages);
+		atomic_store_zu(&extents->nfresh_pages,
+		    cur_nfresh_pages - npages, ATOMIC_RELAXED);
+	}
 }
 
 /* Do any-best-fit extent selection, i.e. select any extent that best fits. */
@@ -407,20 +542,75 @@ extents_first_fit_locked(tsdn_t *tsdn, arena_t *arena, extents_t *extents,
 	return ret;
 }
 
+/* Returns true if extent can hold esize bytes at the given alignment. */
+static bool
+extent_aligned_fits(const extent_t *extent, size_t esize, size_t alignment) {
+	uintptr_t base = (uintptr_t)extent_base_get(extent);
+	size_t leadsize = ALIGNMENT_CEILING(base, PAGE_CEILING(alignment)) -
+	    base;
+	return extent_size_get(extent) >= leadsize + esize;
+}
+
+/*
+ * Do segregated-fit extent selection, i.e. select the oldest/lowest extent in
+ * the smallest non-empty size class that is large enough.  This costs one
+ * bitmap search regardless of how many size classes are populated, and keeps
+ * larger extents intact for larger requests.
+ *
+ * For alignments greater than PAGE, the extent selected for esize is used if
+ * it happens to be suitably aligned, which avoids both consuming (and
+ * splitting) an extent from the worst-case alloc_size class and splitting off
+ * a lead.
+ */
+static extent_t *
+extents_segregated_fit_locked(tsdn_t *tsdn, arena_t *arena, extents_t *extents,
+    size_t esize, size_t alloc_size, size_t alignment) {
+	pszind_t pind = sz_psz2ind(extent_size_quantize_ceil(esize));
+	pszind_t i = (pszind_t)bitmap_ffu(extents->bitmap, &extents_bitmap_info,
+	    (size_t)pind);
+	if (i == NPSIZES+1) {
+		return NULL;
+	}
+	assert(!extent_heap_empty(&extents->heaps[i]));
+	extent_t *extent = extent_heap_first(&extents->heaps[i]);
+	assert(extent_size_get(extent) >= esize);
+	if (alloc_size == esize || extent_aligned_fits(extent, esize,
+	    alignment)) {
+		return extent;
+	}
+
+	pind = sz_psz2ind(extent_size_quantize_ceil(alloc_size));
+	i = (pszind_t)bitmap_ffu(extents->bitmap, &extents_bitmap_info,
+	    (size_t)pind);
+	if (i == NPSIZES+1) {
+		return NULL;
+	}
+	assert(!extent_heap_empty(&extents->heaps[i]));
+	extent = extent_heap_first(&extents->heaps[i]);
+	assert(extent_size_get(extent) >= alloc_size);
+	return extent;
+}
+
 /*
- * Do {best,first}-fit extent selection, where the selection policy choice is
- * based on extents->delay_coalesce.  Best-fit selection requires less
- * searching, but its layout policy is less stable and may cause higher virtual
- * memory fragmentation as a side effect.
+ * Do {best,first,segregated}-fit extent selection, where the selection policy
+ * choice is based on opt_extent_fit and extents->delay_coalesce.  Best-fit
+ * selection requires less searching, but its layout policy is less stable and
+ * may cause higher virtual memory fragmentation as a side effect.
  */
 static extent_t *
 extents_fit_locked(tsdn_t *tsdn, arena_t *arena, extents_t *extents,
-    size_t size) {
+    size_t esize, size_t alignment) {
 	malloc_mutex_assert_owner(tsdn, &extents->mtx);
 
+	size_t alloc_size = esize + PAGE_CEILING(alignment) - PAGE;
+	assert(alloc_size >= esize);
+	if (opt_extent_fit == extent_fit_segregated) {
+		return extents_segregated_fit_locked(tsdn, arena, extents,
+		    esize, alloc_size, alignment);
+	}
 	return extents->delay_coalesce ? extents_best_fit_locked(tsdn, arena,
-	    extents, size) : extents_first_fit_locked(tsdn, arena, extents,
-	    size);
+	    extents, alloc_size) : extents_first_fit_locked(tsdn, arena,
+	    extents, alloc_size);
 }
 
 static bool
@@ -440,6 +630,24 @@ extent_try_delayed_coalesce(tsdn_t *tsdn, arena_t *arena,
 	return false;
 }
 
+/*
+ * Faults in the pages of a newly allocated extent if the arena is configured to
+ * do so (opt.prefault).  Dirty extents need not be prefaulted, since their
+ * pages are resident unless they were allocated before prefaulting was enabled.
+ */
+static void
+extent_prefault(tsdn_t *tsdn, arena_t *arena, extent_t *extent) {
+	if (arena_prefault_get(arena) == prefault_disabled ||
+	    !extent_committed_get(extent)) {
+		return;
+	}
+
+	size_t size = extent_size_get(extent);
+	if (!pages_populate(extent_base_get(extent), size) && config_stats) {
+		arena_stats_prefaulted_add(tsdn, &arena->stats, size);
+	}
+}
+
 extent_t *
 extents_alloc(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
     extents_t *extents, void *new_addr, size_t size, size_t pad,
@@ -449,8 +657,13 @@ extents_alloc(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
 	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
 	    WITNESS_RANK_CORE, 0);
 
-	return extent_recycle(tsdn, arena, r_extent_hooks, extents, new_addr,
-	    size, pad, alignment, slab, szind, zero, commit, false);
+	extent_t *extent = extent_recycle(tsdn, arena, r_extent_hooks, extents,
+	    new_addr, size, pad, alignment, slab, szind, zero, commit, false);
+	if (extent != NULL && extents_state_get(extents) !=
+	    extent_state_dirty) {
+		extent_prefault(tsdn, arena, extent);
+	}
+	return extent;
 }
 
 void
@@ -467,6 +680,39 @@ extents_dalloc(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
 	extent_record(tsdn, arena, r_extent_hooks, extents, extent, false);
 }
 
+/*
+ * Like extents_dalloc(), but for a whole list of extents (linked via ql_link),
+ * which are recorded in batches of up to EXTENTS_DALLOC_LIST_BATCH extents per
+ * acquisition of extents->mtx, so that allocations from extents aren't stalled
+ * for the whole list.  The list is left empty.
+ */
+void
+extents_dalloc_list(tsdn_t *tsdn, arena_t *arena,
+    extent_hooks_t **r_extent_hooks, extents_t *extents, extent_list_t *list) {
+	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
+	    WITNESS_RANK_CORE, 0);
+	rtree_ctx_t rtree_ctx_fallback;
+	rtree_ctx_t *rtree_ctx = tsdn_rtree_ctx(tsdn, &rtree_ctx_fallback);
+
+	while (extent_list_first(list) != NULL) {
+		malloc_mutex_lock(tsdn, &extents->mtx);
+		extent_hooks_assure_initialized(arena, r_extent_hooks);
+		extent_t *extent;
+		for (unsigned i = 0; i < EXTENTS_DALLOC_LIST_BATCH && (extent =
+		    extent_list_first(list)) != NULL; i++) {
+			assert(extent_base_get(extent) != NULL);
+			assert(extent_size_get(extent) != 0);
+			extent_list_remove(list, extent);
+
+			extent_addr_set(extent, extent_base_get(extent));
+			extent_zeroed_set(extent, false);
+			extent_record_locked(tsdn, arena, r_extent_hooks,
+			    rtree_ctx, extents, extent, false);
+		}
+		malloc_mutex_unlock(tsdn, &extents->mtx);
+	}
+}
+
 extent_t *
 extents_evict(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
     extents_t *extents, size_t npages_min) {
@@ -509,6 +755,7 @@ extents_evict(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
 		 */
 	}
 
+	extent_interior_stale_clear(tsdn, rtree_ctx, extent);
 	/*
 	 * Either mark the extent active or deregister it to protect against
 	 * concurrent operations.
@@ -629,11 +876,16 @@ extent_interior_register(tsdn_t *tsdn, rtree_ctx_t *rtree_ctx, extent_t *extent,
     szind_t szind) {
 	assert(extent_slab_get(extent));
 
-	/* Register interior. */
-	for (size_t i = 1; i < (extent_size_get(extent) >> LG_PAGE) - 1; i++) {
-		rtree_write(tsdn, &extents_rtree, rtree_ctx,
-		    (uintptr_t)extent_base_get(extent) + (uintptr_t)(i <<
-		    LG_PAGE), extent, szind, true);
+	/*
+	 * Register interior.  The elements may still hold stale mappings if
+	 * the extent was recycled without clearing them (see
+	 * extent_recycle_extract()); they are simply overwritten.
+	 */
+	size_t npages = extent_size_get(extent) >> LG_PAGE;
+	if (npages > 2) {
+		rtree_write_range(tsdn, &extents_rtree, rtree_ctx,
+		    (uintptr_t)extent_base_get(extent) + PAGE, npages - 2,
+		    extent, szind, true);
 	}
 }
 
@@ -726,14 +978,22 @@ extent_reregister(tsdn_t *tsdn, extent_t *extent) {
 static void
 extent_interior_deregister(tsdn_t *tsdn, rtree_ctx_t *rtree_ctx,
     extent_t *extent) {
-	size_t i;
+	assert(extent_slab_get(extent) || extent_interior_stale_get(extent));
 
-	assert(extent_slab_get(extent));
+	size_t npages = extent_size_get(extent) >> LG_PAGE;
+	if (npages > 2) {
+		rtree_clear_range(tsdn, &extents_rtree, rtree_ctx,
+		    (uintptr_t)extent_base_get(extent) + PAGE, npages - 2);
+	}
+}
 
-	for (i = 1; i < (extent_size_get(extent) >> LG_PAGE) - 1; i++) {
-		rtree_clear(tsdn, &extents_rtree, rtree_ctx,
-		    (uintptr_t)extent_base_get(extent) + (uintptr_t)(i <<
-		    LG_PAGE));
+/* Clears interior mappings left behind by a slab, if any. */
+static void
+extent_interior_stale_clear(tsdn_t *tsdn, rtree_ctx_t *rtree_ctx,
+    extent_t *extent) {
+	if (extent_interior_stale_get(extent)) {
+		extent_interior_deregister(tsdn, rtree_ctx, extent);
+		extent_interior_stale_set(extent, false);
 	}
 }
 
@@ -752,6 +1012,7 @@ extent_deregister(tsdn_t *tsdn, extent_t *extent) {
 		extent_interior_deregister(tsdn, rtree_ctx, extent);
 		extent_slab_set(extent, false);
 	}
+	extent_interior_stale_clear(tsdn, rtree_ctx, extent);
 
 	extent_unlock(tsdn, extent);
 
@@ -812,13 +1073,24 @@ extent_recycle_extract(tsdn_t *tsdn, arena_t *arena,
 			extent_unlock(tsdn, unlock_extent);
 		}
 	} else {
-		extent = extents_fit_locked(tsdn, arena, extents, alloc_size);
+		extent = extents_fit_locked(tsdn, arena, extents, esize,
+		    alignment);
 	}
 	if (extent == NULL) {
 		malloc_mutex_unlock(tsdn, &extents->mtx);
 		return NULL;
 	}
 
+	if (slab && extent_size_get(extent) == esize && alignment <= PAGE) {
+		/*
+		 * Reused as a slab without splitting, so the stale interior
+		 * (if any) is about to be overwritten by
+		 * extent_interior_register().
+		 */
+		extent_interior_stale_set(extent, false);
+	} else {
+		extent_interior_stale_clear(tsdn, rtree_ctx, extent);
+	}
 	extent_activate_locked(tsdn, arena, extents, extent, false);
 	malloc_mutex_unlock(tsdn, &extents->mtx);
 
@@ -892,6 +1164,23 @@ extent_recycle_split(tsdn_t *tsdn, arena_t *arena,
 	return extent;
 }
 
+/*
+ * Zero-fills the memory of a newly allocated extent, either via memset() or by
+ * forced purging, after which pages read back as zeros as they are faulted
+ * back in (see opt.zero_purge_threshold).  Forced purging goes through the
+ * extent hooks, since e.g. MADV_DONTNEED does not zero shared file mappings;
+ * memset() is the fallback for hooks that cannot purge.
+ */
+static void
+extent_zero_fill(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
+    extent_t *extent, bool growing_retained) {
+	size_t size = extent_size_get(extent);
+	if (size < opt_zero_purge_threshold || extent_purge_forced_impl(tsdn,
+	    arena, r_extent_hooks, extent, 0, size, growing_retained)) {
+		memset(extent_base_get(extent), 0, size);
+	}
+}
+
 static extent_t *
 extent_recycle(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
     extents_t *extents, void *new_addr, size_t size, size_t pad,
@@ -933,6 +1222,7 @@ extent_recycle(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
 		}
 		extent_zeroed_set(extent, true);
 	}
+	extent_fresh_set(extent, false);
 
 	if (pad != 0) {
 		extent_addr_randomize(tsdn, extent, alignment);
@@ -947,9 +1237,8 @@ extent_recycle(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
 		void *addr = extent_base_get(extent);
 		size_t size = extent_size_get(extent);
 		if (!extent_zeroed_get(extent)) {
-			if (pages_purge_forced(addr, size)) {
-				memset(addr, 0, size);
-			}
+			extent_zero_fill(tsdn, arena, r_extent_hooks, extent,
+			    growing_retained);
 		} else if (config_debug) {
 			size_t *p = (size_t *)(uintptr_t)addr;
 			for (size_t i = 0; i < size / sizeof(size_t); i++) {
@@ -1025,6 +1314,242 @@ extent_alloc_default(extent_hooks_t *extent_hooks, void *new_addr, size_t size,
 	    alignment, zero, commit);
 }
 
+/* Tracks a mapping grown by extent_grow_retained() for opt.thp_policy. */
+static void
+extent_mapping_record(tsdn_t *tsdn, arena_t *arena, void *addr, size_t size) {
+	malloc_mutex_assert_owner(tsdn, &arena->extent_grow_mtx);
+
+	uintptr_t hbase = HUGEPAGE_CEILING((uintptr_t)addr);
+	uintptr_t hpast = (uintptr_t)HUGEPAGE_ADDR2BASE((uintptr_t)addr +
+	    size);
+	if (hbase >= hpast) {
+		return;
+	}
+	size_t nhuge = (hpast - hbase) >> LG_HUGEPAGE;
+	/* Failing to track the mapping only forgoes the hints. */
+	extent_mapping_t *mapping = (extent_mapping_t *)base_alloc(tsdn,
+	    arena->base, sizeof(extent_mapping_t) + nhuge, CACHELINE);
+	if (mapping == NULL) {
+		return;
+	}
+	mapping->addr = addr;
+	mapping->size = size;
+	mapping->hints = (uint8_t *)&mapping[1];
+	memset(mapping->hints, extent_thp_hint_none, nhuge);
+	mapping->next = arena->extent_mappings;
+	arena->extent_mappings = mapping;
+}
+
+/* A run of adjacent huge pages of a mapping that get the same madvise() hint. */
+typedef struct extent_thp_run_s extent_thp_run_t;
+struct extent_thp_run_s {
+	/* Index of the run's first huge page within the mapping. */
+	size_t		ind;
+	size_t		n;
+	/* extent_thp_hint_huge or extent_thp_hint_nohuge. */
+	uint8_t		hint;
+};
+
+static void
+extent_thp_collapse(tsdn_t *tsdn, arena_t *arena, void *addr, uint8_t *hint) {
+	/*
+	 * Collapsing fails if e.g. there's no huge page to spare right now, or
+	 * the region is being modified concurrently.  Retry on the next scan,
+	 * unless khugepaged gets there first.
+	 */
+	if (pages_collapse(addr, HUGEPAGE)) {
+		*hint = extent_thp_hint_collapse;
+		return;
+	}
+	*hint = extent_thp_hint_huge;
+	if (config_stats) {
+		arena_stats_thp_collapsed_add(tsdn, &arena->stats, HUGEPAGE);
+	}
+}
+
+/*
+ * Advises a whole run at once, which keeps the number of madvise() calls (and
+ * transient VMA splits) proportional to the number of runs.
+ */
+static void
+extent_thp_run_flush(tsdn_t *tsdn, arena_t *arena, extent_mapping_t *mapping,
+    extent_thp_run_t *run) {
+	if (run->n == 0) {
+		return;
+	}
+	void *addr = (void *)(HUGEPAGE_CEILING((uintptr_t)mapping->addr) +
+	    (run->ind << LG_HUGEPAGE));
+	size_t size = run->n << LG_HUGEPAGE;
+	uint8_t *hints = &mapping->hints[run->ind];
+	if (run->hint == extent_thp_hint_nohuge) {
+		/*
+		 * Huge pages would mostly back unused memory here, and keep it
+		 * from being returned to the system page by page.
+		 */
+		pages_nohuge(addr, size);
+		memset(hints, extent_thp_hint_nohuge, run->n);
+	} else if (pages_huge(addr, size)) {
+		/* No THP support; nothing more to do. */
+		memset(hints, extent_thp_hint_huge, run->n);
+	} else {
+		for (size_t i = 0; i < run->n; i++) {
+			extent_thp_collapse(tsdn, arena, (void *)((uintptr_t)addr
+			    + (i << LG_HUGEPAGE)), &hints[i]);
+		}
+	}
+	run->n = 0;
+}
+
+/*
+ * Applies opt.thp_policy to the ind'th huge page of mapping, which has nactive
+ * active pages.  Hint changes are deferred to run, and flushed once the next
+ * one does not extend it.
+ */
+static void
+extent_thp_region_apply(tsdn_t *tsdn, arena_t *arena, extent_mapping_t *mapping,
+    extent_thp_run_t *run, size_t ind, size_t nactive) {
+	uint8_t *hint = &mapping->hints[ind];
+	uint8_t new_hint;
+	if (nactive == (HUGEPAGE >> LG_PAGE)) {
+		if (*hint == extent_thp_hint_huge) {
+			return;
+		}
+		if (*hint == extent_thp_hint_collapse) {
+			/* Already advised. */
+			extent_thp_collapse(tsdn, arena, (void *)
+			    (HUGEPAGE_CEILING((uintptr_t)mapping->addr) + (ind <<
+			    LG_HUGEPAGE)), hint);
+			return;
+		}
+		new_hint = extent_thp_hint_huge;
+	} else if (nactive <= (HUGEPAGE >> LG_PAGE) / 4) {
+		if (*hint == extent_thp_hint_nohuge) {
+			return;
+		}
+		new_hint = extent_thp_hint_nohuge;
+	} else {
+		return;
+	}
+
+	if (run->n != 0 && (run->hint != new_hint || run->ind + run->n !=
+	    ind)) {
+		extent_thp_run_flush(tsdn, arena, mapping, run);
+	}
+	if (run->n == 0) {
+		run->ind = ind;
+		run->hint = new_hint;
+	}
+	run->n++;
+}
+
+/*
+ * Looks up the extent containing the page at addr, and returns its bounds and
+ * whether it is active.  Fails if addr is not registered in the rtree, which
+ * only maps the first and last pages of unslabbed extents.
+ */
+static bool
+extent_thp_lookup(tsdn_t *tsdn, rtree_ctx_t *rtree_ctx, uintptr_t addr,
+    uintptr_t *r_ebase, uintptr_t *r_epast, bool *r_active) {
+	extent_t *extent = extent_lock_from_addr(tsdn, rtree_ctx, (void *)addr);
+	if (extent == NULL) {
+		return true;
+	}
+	uintptr_t ebase = (uintptr_t)extent_base_get(extent);
+	uintptr_t epast = (uintptr_t)extent_past_get(extent);
+	bool active = (extent_state_get(extent) == extent_state_active);
+	extent_unlock(tsdn, extent);
+	if (ebase > addr || epast <= addr) {
+		/* Raced with a split or merge. */
+		return true;
+	}
+	*r_ebase = ebase;
+	*r_epast = epast;
+	*r_active = active;
+	return false;
+}
+
+/*
+ * Counts the active pages in each huge page of mapping by walking the extents
+ * covering it in address order, and applies opt.thp_policy accordingly.  The
+ * walk starts at the mapping's first extent, and finds each following extent at
+ * the end of the previous one.  Where that fails, e.g. because an inactive
+ * extent merged across adjacent mappings, or extents changed concurrently, the
+ * walk resumes from the extent covering the last page of the huge page, and the
+ * pages it skipped leave that huge page alone.  Each huge page therefore costs
+ * at most two lookups besides those of the extents starting in it.
+ */
+static void
+extent_thp_mapping_scan(tsdn_t *tsdn, arena_t *arena, rtree_ctx_t *rtree_ctx,
+    extent_mapping_t *mapping) {
+	uintptr_t mbase = (uintptr_t)mapping->addr;
+	uintptr_t hbase = HUGEPAGE_CEILING(mbase);
+	uintptr_t hpast = (uintptr_t)HUGEPAGE_ADDR2BASE(mbase + mapping->size);
+	extent_thp_run_t run = {0, 0, extent_thp_hint_none};
+
+	/* The extent the walk is in; none if epast is 0. */
+	uintptr_t ebase, epast = 0;
+	bool active = false;
+	for (uintptr_t addr = mbase; addr < hbase; addr = epast) {
+		if (extent_thp_lookup(tsdn, rtree_ctx, addr, &ebase, &epast,
+		    &active)) {
+			epast = 0;
+			break;
+		}
+	}
+
+	for (uintptr_t region = hbase; region < hpast; region += HUGEPAGE) {
+		uintptr_t rpast = region + HUGEPAGE;
+		size_t nactive = 0;
+		bool known = true;
+		for (uintptr_t pos = region; pos < rpast;) {
+			if (epast <= pos && extent_thp_lookup(tsdn, rtree_ctx,
+			    pos, &ebase, &epast, &active)) {
+				if (rpast - PAGE == pos ||
+				    extent_thp_lookup(tsdn, rtree_ctx, rpast -
+				    PAGE, &ebase, &epast, &active)) {
+					epast = 0;
+					known = false;
+					break;
+				}
+				if (ebase > pos) {
+					known = false;
+					pos = ebase;
+				}
+			}
+			uintptr_t end = (epast < rpast) ? epast : rpast;
+			if (active) {
+				nactive += (end - pos) >> LG_PAGE;
+			}
+			pos = end;
+		}
+		if (known) {
+			extent_thp_region_apply(tsdn, arena, mapping, &run,
+			    (region - hbase) >> LG_HUGEPAGE, nactive);
+		}
+	}
+	extent_thp_run_flush(tsdn, arena, mapping, &run);
+}
+
+/*
+ * Applies opt.thp_policy to the memory arena has grown so far.  Only called by
+ * the background thread in charge of arena.
+ */
+void
+extent_thp_scan(tsdn_t *tsdn, arena_t *arena) {
+	assert(opt_thp_policy != thp_policy_default);
+
+	malloc_mutex_lock(tsdn, &arena->extent_grow_mtx);
+	extent_mapping_t *mappings = arena->extent_mappings;
+	malloc_mutex_unlock(tsdn, &arena->extent_grow_mtx);
+
+	rtree_ctx_t rtree_ctx_fallback;
+	rtree_ctx_t *rtree_ctx = tsdn_rtree_ctx(tsdn, &rtree_ctx_fallback);
+	for (extent_mapping_t *mapping = mappings; mapping != NULL; mapping =
+	    mapping->next) {
+		extent_thp_mapping_scan(tsdn, arena, rtree_ctx, mapping);
+	}
+}
+
 /*
  * If virtual memory is retained, create increasingly larger extents from which
  * to split requested extents in order to limit the total number of disjoint
@@ -1081,6 +1606,7 @@ extent_grow_retained(tsdn_t *tsdn, arena_t *arena,
 	extent_init(extent, arena, ptr, alloc_size, false, NSIZES,
 	    arena_extent_sn_next(arena), extent_state_active, zeroed,
 	    committed);
+	extent_fresh_set(extent, true);
 	if (ptr == NULL) {
 		extent_dalloc(tsdn, arena, extent);
 		goto label_err;
@@ -1090,6 +1616,10 @@ extent_grow_retained(tsdn_t *tsdn, arena_t *arena,
 		    &arena->extents_retained, extent, true);
 		goto label_err;
 	}
+	if (opt_thp_policy != thp_policy_default && *r_extent_hooks ==
+	    &extent_hooks_default) {
+		extent_mapping_record(tsdn, arena, ptr, alloc_size);
+	}
 
 	size_t leadsize = ALIGNMENT_CEILING((uintptr_t)ptr,
 	    PAGE_CEILING(alignment)) - (uintptr_t)ptr;
@@ -1161,15 +1691,17 @@ extent_grow_retained(tsdn_t *tsdn, arena_t *arena,
 		}
 		extent_zeroed_set(extent, true);
 	}
+	extent_fresh_set(extent, false);
 
 	/*
-	 * Increment extent_grow_next if doing so wouldn't exceed the legal
-	 * range.
+	 * Increment extent_grow_next if doing so wouldn't exceed the allowed
+	 * range (arena.<i>.retain_grow_limit).
 	 */
-	if (arena->extent_grow_next + egn_skip + 1 < NPSIZES) {
+	if (arena->extent_grow_next + egn_skip + 1 <=
+	    arena->retain_grow_limit) {
 		arena->extent_grow_next += egn_skip + 1;
 	} else {
-		arena->extent_grow_next = NPSIZES - 1;
+		arena->extent_grow_next = arena->retain_grow_limit;
 	}
 	/* All opportunities for failure are past. */
 	malloc_mutex_unlock(tsdn, &arena->extent_grow_mtx);
@@ -1190,11 +1722,7 @@ extent_grow_retained(tsdn_t *tsdn, arena_t *arena,
 		extent_interior_register(tsdn, rtree_ctx, extent, szind);
 	}
 	if (*zero && !extent_zeroed_get(extent)) {
-		void *addr = extent_base_get(extent);
-		size_t size = extent_size_get(extent);
-		if (pages_purge_forced(addr, size)) {
-			memset(addr, 0, size);
-		}
+		extent_zero_fill(tsdn, arena, r_extent_hooks, extent, false);
 	}
 
 	return extent;
@@ -1283,6 +1811,9 @@ extent_alloc_wrapper(tsdn_t *tsdn, arena_t *arena,
 		extent = extent_alloc_wrapper_hard(tsdn, arena, r_extent_hooks,
 		    new_addr, size, pad, alignment, slab, szind, zero, commit);
 	}
+	if (extent != NULL) {
+		extent_prefault(tsdn, arena, extent);
+	}
 
 	return extent;
 }
@@ -1309,10 +1840,14 @@ extent_can_coalesce(arena_t *arena, extents_t *extents, const extent_t *inner,
 
 static bool
 extent_coalesce(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
-    extents_t *extents, extent_t *inner, extent_t *outer, bool forward,
-    bool growing_retained) {
+    rtree_ctx_t *rtree_ctx, extents_t *extents, extent_t *inner,
+    extent_t *outer, bool forward, bool growing_retained) {
 	assert(extent_can_coalesce(arena, extents, inner, outer));
 
+	/* The merged extent's interior must be clean. */
+	extent_interior_stale_clear(tsdn, rtree_ctx, inner);
+	extent_interior_stale_clear(tsdn, rtree_ctx, outer);
+
 	if (forward && extents->delay_coalesce) {
 		/*
 		 * The extent that remains after coalescing must occupy the
@@ -1367,8 +1902,8 @@ extent_try_coalesce(tsdn_t *tsdn, arena_t *arena,
 			extent_unlock(tsdn, next);
 
 			if (can_coalesce && !extent_coalesce(tsdn, arena,
-			    r_extent_hooks, extents, extent, next, true,
-			    growing_retained)) {
+			    r_extent_hooks, rtree_ctx, extents, extent, next,
+			    true, growing_retained)) {
 				if (extents->delay_coalesce) {
 					/* Do minimal coalescing. */
 					*coalesced = true;
@@ -1387,8 +1922,8 @@ extent_try_coalesce(tsdn_t *tsdn, arena_t *arena,
 			extent_unlock(tsdn, prev);
 
 			if (can_coalesce && !extent_coalesce(tsdn, arena,
-			    r_extent_hooks, extents, extent, prev, false,
-			    growing_retained)) {
+			    r_extent_hooks, rtree_ctx, extents, extent, prev,
+			    false, growing_retained)) {
 				extent = prev;
 				if (extents->delay_coalesce) {
 					/* Do minimal coalescing. */
@@ -1407,21 +1942,27 @@ extent_try_coalesce(tsdn_t *tsdn, arena_t *arena,
 }
 
 static void
-extent_record(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
-    extents_t *extents, extent_t *extent, bool growing_retained) {
-	rtree_ctx_t rtree_ctx_fallback;
-	rtree_ctx_t *rtree_ctx = tsdn_rtree_ctx(tsdn, &rtree_ctx_fallback);
-
+extent_record_locked(tsdn_t *tsdn, arena_t *arena,
+    extent_hooks_t **r_extent_hooks, rtree_ctx_t *rtree_ctx, extents_t *extents,
+    extent_t *extent, bool growing_retained) {
+	malloc_mutex_assert_owner(tsdn, &extents->mtx);
 	assert((extents_state_get(extents) != extent_state_dirty &&
 	    extents_state_get(extents) != extent_state_muzzy) ||
 	    !extent_zeroed_get(extent));
 
-	malloc_mutex_lock(tsdn, &extents->mtx);
-	extent_hooks_assure_initialized(arena, r_extent_hooks);
-
+	assert(!extent_interior_stale_get(extent));
 	extent_szind_set(extent, NSIZES);
 	if (extent_slab_get(extent)) {
-		extent_interior_deregister(tsdn, rtree_ctx, extent);
+		/*
+		 * Dirty extents are the likeliest to be reused as slabs, so
+		 * defer clearing the interior until the extent is reused or
+		 * leaves extents_dirty.
+		 */
+		if (extents_state_get(extents) == extent_state_dirty) {
+			extent_interior_stale_set(extent, true);
+		} else {
+			extent_interior_deregister(tsdn, rtree_ctx, extent);
+		}
 		extent_slab_set(extent, false);
 	}
 
@@ -1434,7 +1975,18 @@ extent_record(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
 	}
 
 	extent_deactivate_locked(tsdn, arena, extents, extent, false);
+}
 
+static void
+extent_record(tsdn_t *tsdn, arena_t *arena, extent_hooks_t **r_extent_hooks,
+    extents_t *extents, extent_t *extent, bool growing_retained) {
+	rtree_ctx_t rtree_ctx_fallback;
+	rtree_ctx_t *rtree_ctx = tsdn_rtree_ctx(tsdn, &rtree_ctx_fallback);
+
+	malloc_mutex_lock(tsdn, &extents->mtx);
+	extent_hooks_assure_initialized(arena, r_extent_hooks);
+	extent_record_locked(tsdn, arena, r_extent_hooks, rtree_ctx, extents,
+	    extent, growing_retained);
 	malloc_mutex_unlock(tsdn, &extents->mtx);
 }
 
@@ -1548,7 +2100,10 @@ extent_dalloc_wrapper(tsdn_t *tsdn, arena_t *arena,
 
 static void
 extent_destroy_default_impl(void *addr, size_t size) {
-	if (!have_dss || !extent_in_dss(addr)) {
+	if (extent_in_reserve(addr)) {
+		/* Keep the reservation intact, and only drop the pages. */
+		pages_purge_forced(addr, size);
+	} else if (!have_dss || !extent_in_dss(addr)) {
 		pages_unmap(addr, size);
 	}
 }
@@ -1727,6 +2282,7 @@ extent_split_impl(tsdn_t *tsdn, arena_t *arena,
     szind_t szind_a, bool slab_a, size_t size_b, szind_t szind_b, bool slab_b,
     bool growing_retained) {
 	assert(extent_size_get(extent) == size_a + size_b);
+	assert(!extent_interior_stale_get(extent));
 	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
 	    WITNESS_RANK_CORE, growing_retained ? 1 : 0);
 
@@ -1745,6 +2301,7 @@ extent_split_impl(tsdn_t *tsdn, arena_t *arena,
 	    size_a), size_b, slab_b, szind_b, extent_sn_get(extent),
 	    extent_state_get(extent), extent_zeroed_get(extent),
 	    extent_committed_get(extent));
+	extent_fresh_set(trail, extent_fresh_get(extent));
 
 	rtree_ctx_t rtree_ctx_fallback;
 	rtree_ctx_t *rtree_ctx = tsdn_rtree_ctx(tsdn, &rtree_ctx_fallback);
@@ -1812,6 +2369,9 @@ extent_merge_default_impl(void *addr_a, void *addr_b) {
 	if (have_dss && !extent_dss_mergeable(addr_a, addr_b)) {
 		return true;
 	}
+	if (!extent_mmap_mergeable(addr_a, addr_b)) {
+		return true;
+	}
 
 	return false;
 }
@@ -1828,6 +2388,7 @@ static bool
 extent_merge_impl(tsdn_t *tsdn, arena_t *arena,
     extent_hooks_t **r_extent_hooks, extent_t *a, extent_t *b,
     bool growing_retained) {
+	assert(!extent_interior_stale_get(a) && !extent_interior_stale_get(b));
 	witness_assert_depth_to_rank(tsdn_witness_tsdp_get(tsdn),
 	    WITNESS_RANK_CORE, growing_retained ? 1 : 0);
 
@@ -1884,6 +2445,7 @@ extent_merge_impl(tsdn_t *tsdn, arena_t *arena,
 	extent_sn_set(a, (extent_sn_get(a) < extent_sn_get(b)) ?
 	    extent_sn_get(a) : extent_sn_get(b));
 	extent_zeroed_set(a, extent_zeroed_get(a) && extent_zeroed_get(b));
+	extent_fresh_set(a, extent_fresh_get(a) && extent_fresh_get(b));
 
 	extent_rtree_write_acquired(tsdn, a_elm_a, b_elm_b, a, NSIZES, false);
 
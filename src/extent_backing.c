@@ -0,0 +1,496 @@
+#define JEMALLOC_EXTENT_BACKING_C_
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/extent_backing.h"
+#include "jemalloc/internal/mutex.h"
+
+#ifndef _WIN32
+#  include <sys/stat.h>
+#endif
+
+/******************************************************************************/
+/* Data. */
+
+/*
+ * Address space reserved per backing.  Extents are carved from the
+ * reservation in address order, and are only handed back to the system when
+ * the arena is destroyed, so this bounds the amount of memory an arena can ever
+ * allocate from its backing.
+ */
+#if LG_SIZEOF_PTR == 3
+#  define EXTENT_BACKING_RESERVE	(ZU(1) << 40)
+#else
+#  define EXTENT_BACKING_RESERVE	(ZU(1) << 28)
+#endif
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#  define MAP_HUGE_SHIFT 26
+#endif
+
+typedef struct extent_backing_s extent_backing_t;
+struct extent_backing_s {
+	/* Must be first, so that the hooks can be cast to the backing. */
+	extent_hooks_t		hooks;
+
+	/* Linkage for fork handling and reuse; immutable once published. */
+	extent_backing_t	*next;
+	/* False once released, until reused by extent_backing_hooks_new(). */
+	atomic_b_t		in_use;
+
+	/* Backing file descriptor, or -1 for hugetlb backings. */
+	int			fd;
+	/* Granularity with which the reservation is mapped. */
+	size_t			gran;
+	/* mmap() flags for hugetlb backings. */
+	int			mmap_flags;
+
+	/* Reservation; immutable while in use. */
+	void			*reserve_addr;
+	size_t			reserve_size;
+	uintptr_t		base;
+	size_t			limit;
+
+	/* Protects cur and mapped. */
+	malloc_mutex_t		mtx;
+	/* Offset past the last extent carved from the reservation. */
+	size_t			cur;
+	/* Offset past the mapped prefix of the reservation (gran-aligned). */
+	size_t			mapped;
+};
+
+/*
+ * All backings ever created, for fork handling.  Backing structures are base
+ * allocated, so those of destroyed arenas are kept on the list for reuse.
+ */
+static atomic_p_t	backings;
+
+/******************************************************************************/
+
+#ifndef _WIN32
+static bool
+extent_backing_map(extent_backing_t *backing, size_t offset, size_t size) {
+	void *addr = (void *)(backing->base + offset);
+	void *ret;
+
+	if (backing->fd == -1) {
+		ret = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE |
+		    MAP_ANONYMOUS | MAP_FIXED | backing->mmap_flags, -1, 0);
+	} else {
+#ifdef JEMALLOC_HAVE_POSIX_FALLOCATE
+		/* Allocate file space up front, rather than SIGBUS later. */
+		if (posix_fallocate(backing->fd, (off_t)offset, (off_t)size)
+		    != 0) {
+			return true;
+		}
+#else
+		if (ftruncate(backing->fd, (off_t)(offset + size)) != 0) {
+			return true;
+		}
+#endif
+		ret = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED |
+		    MAP_FIXED, backing->fd, (off_t)offset);
+	}
+	return (ret == MAP_FAILED);
+}
+
+/*
+ * Discards the contents of [addr, addr+size), such that it reads back as
+ * zeros.  Returns true if that is not possible, e.g. because the range is
+ * not aligned to the hugetlb page size.
+ */
+static bool
+extent_backing_discard(extent_backing_t *backing, void *addr, size_t size) {
+	if (backing->fd == -1) {
+		if (ALIGNMENT_ADDR2OFFSET(addr, backing->gran) != 0 ||
+		    ALIGNMENT_CEILING(size, backing->gran) != size) {
+			return true;
+		}
+		return (madvise(addr, size, MADV_DONTNEED) != 0);
+	}
+#ifdef JEMALLOC_HAVE_FALLOCATE_PUNCH_HOLE
+	return (fallocate(backing->fd, FALLOC_FL_PUNCH_HOLE |
+	    FALLOC_FL_KEEP_SIZE, (off_t)((uintptr_t)addr - backing->base),
+	    (off_t)size) != 0);
+#else
+	return true;
+#endif
+}
+#endif
+
+static void *
+extent_backing_alloc(extent_hooks_t *extent_hooks, void *new_addr, size_t size,
+    size_t alignment, bool *zero, bool *commit, unsigned arena_ind) {
+#ifdef _WIN32
+	not_reached();
+	return NULL;
+#else
+	extent_backing_t *backing = (extent_backing_t *)extent_hooks;
+	tsdn_t *tsdn = tsdn_fetch();
+	void *ret = NULL;
+
+	alignment = ALIGNMENT_CEILING(alignment, PAGE);
+	malloc_mutex_lock(tsdn, &backing->mtx);
+	size_t offset = ALIGNMENT_CEILING(backing->base + backing->cur,
+	    alignment) - backing->base;
+	/* Beware size_t wrap-around. */
+	if (offset < backing->cur || offset > backing->limit ||
+	    size > backing->limit - offset) {
+		goto label_return;
+	}
+	if (new_addr != NULL && (uintptr_t)new_addr != backing->base + offset) {
+		goto label_return;
+	}
+	size_t end = offset + size;
+	if (end > backing->mapped) {
+		size_t mapped = ALIGNMENT_CEILING(end, backing->gran);
+		if (extent_backing_map(backing, backing->mapped, mapped -
+		    backing->mapped)) {
+			goto label_return;
+		}
+		backing->mapped = mapped;
+	}
+	backing->cur = end;
+	ret = (void *)(backing->base + offset);
+	/* Carved memory has never been handed out before. */
+	*zero = true;
+	*commit = true;
+label_return:
+	malloc_mutex_unlock(tsdn, &backing->mtx);
+	return ret;
+#endif
+}
+
+static bool
+extent_backing_dalloc(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    bool committed, unsigned arena_ind) {
+	/* Retain everything; the reservation is never handed back. */
+	return true;
+}
+
+static void
+extent_backing_destroy(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    bool committed, unsigned arena_ind) {
+#ifndef _WIN32
+	extent_backing_t *backing = (extent_backing_t *)extent_hooks;
+	/* Release as much of the backing memory as possible. */
+	if (backing->fd == -1) {
+		void *start = (void *)ALIGNMENT_CEILING((uintptr_t)addr,
+		    backing->gran);
+		void *past = ALIGNMENT_ADDR2BASE((uintptr_t)addr + size,
+		    backing->gran);
+		if ((uintptr_t)past > (uintptr_t)start) {
+			extent_backing_discard(backing, start, (uintptr_t)past -
+			    (uintptr_t)start);
+		}
+	} else {
+		extent_backing_discard(backing, addr, size);
+	}
+#endif
+}
+
+static bool
+extent_backing_commit(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    size_t offset, size_t length, unsigned arena_ind) {
+	/* All memory is committed as soon as it is carved. */
+	return false;
+}
+
+static bool
+extent_backing_decommit(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    size_t offset, size_t length, unsigned arena_ind) {
+	return true;
+}
+
+static bool
+extent_backing_purge_lazy(extent_hooks_t *extent_hooks, void *addr,
+    size_t size, size_t offset, size_t length, unsigned arena_ind) {
+	return true;
+}
+
+static bool
+extent_backing_purge_forced(extent_hooks_t *extent_hooks, void *addr,
+    size_t size, size_t offset, size_t length, unsigned arena_ind) {
+#ifdef _WIN32
+	return true;
+#else
+	return extent_backing_discard((extent_backing_t *)extent_hooks,
+	    (void *)((uintptr_t)addr + offset), length);
+#endif
+}
+
+static bool
+extent_backing_split(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    size_t size_a, size_t size_b, bool committed, unsigned arena_ind) {
+	return false;
+}
+
+static bool
+extent_backing_merge(extent_hooks_t *extent_hooks, void *addr_a, size_t size_a,
+    void *addr_b, size_t size_b, bool committed, unsigned arena_ind) {
+	/* Extents are carved from a single mapping. */
+	return false;
+}
+
+#ifndef _WIN32
+/* Parses "<n>[KMG]" into *r_size.  Returns true on error. */
+static bool
+extent_backing_parse_size(const char *s, size_t *r_size) {
+	char *end;
+	set_errno(0);
+	uintmax_t um = malloc_strtoumax(s, &end, 0);
+	if (get_errno() != 0 || end == s) {
+		return true;
+	}
+	unsigned lg = 0;
+	switch (*end) {
+	case 'K': case 'k': lg = 10; end++; break;
+	case 'M': case 'm': lg = 20; end++; break;
+	case 'G': case 'g': lg = 30; end++; break;
+	default: break;
+	}
+	if (*end != '\0' || um > (SIZE_T_MAX >> lg)) {
+		return true;
+	}
+	*r_size = (size_t)um << lg;
+	return false;
+}
+
+static int
+extent_backing_open(const char *path) {
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd == -1) {
+#ifdef O_TMPFILE
+		if (errno == EISDIR) {
+			fd = open(path, O_RDWR | O_TMPFILE | O_CLOEXEC, 0600);
+		}
+#endif
+		return fd;
+	}
+	/* Prior file contents are discarded. */
+	if (ftruncate(fd, 0) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Returns a released backing for reuse if there is one, or else a newly
+ * allocated one that the caller has to publish on the backings list.
+ */
+static extent_backing_t *
+extent_backing_get_unused(tsdn_t *tsdn, bool *r_reused) {
+	for (extent_backing_t *backing = (extent_backing_t *)atomic_load_p(
+	    &backings, ATOMIC_ACQUIRE); backing != NULL;
+	    backing = backing->next) {
+		bool in_use = false;
+		if (atomic_compare_exchange_strong_b(&backing->in_use, &in_use,
+		    true, ATOMIC_ACQUIRE, ATOMIC_RELAXED)) {
+			*r_reused = true;
+			return backing;
+		}
+	}
+
+	extent_backing_t *backing = (extent_backing_t *)base_alloc(tsdn,
+	    b0get(), sizeof(extent_backing_t), CACHELINE);
+	if (backing == NULL) {
+		return NULL;
+	}
+	if (malloc_mutex_init(&backing->mtx, "extent_backing",
+	    WITNESS_RANK_EXTENT_BACKING, malloc_mutex_rank_exclusive)) {
+		/* The base allocation is leaked, as all base allocations are. */
+		return NULL;
+	}
+	atomic_store_b(&backing->in_use, true, ATOMIC_RELAXED);
+	*r_reused = false;
+	return backing;
+}
+#endif
+
+bool
+extent_backing_hooks_new(tsdn_t *tsdn, const char *backing_str,
+    extent_hooks_t **r_extent_hooks) {
+	if (strcmp(backing_str, "anonymous") == 0) {
+		*r_extent_hooks = (extent_hooks_t *)&extent_hooks_default;
+		return false;
+	}
+#ifdef _WIN32
+	return true;
+#else
+	int fd = -1;
+	size_t gran;
+	int mmap_flags = 0;
+
+	if (strncmp(backing_str, "hugetlb", strlen("hugetlb")) == 0) {
+#ifdef MAP_HUGETLB
+		const char *s = backing_str + strlen("hugetlb");
+		if (*s == '\0') {
+			gran = HUGEPAGE;
+		} else if (*s != ':' || extent_backing_parse_size(s + 1,
+		    &gran)) {
+			return true;
+		}
+		if (gran < PAGE || (gran & (gran - 1)) != 0) {
+			return true;
+		}
+		mmap_flags = MAP_HUGETLB | ((int)lg_floor(gran) << MAP_HUGE_SHIFT);
+#else
+		return true;
+#endif
+	} else if (strncmp(backing_str, "file:", strlen("file:")) == 0) {
+		fd = extent_backing_open(backing_str + strlen("file:"));
+		if (fd == -1) {
+			return true;
+		}
+		/* Map in units of the file system block size (if sane). */
+		struct stat st;
+		gran = PAGE;
+		if (fstat(fd, &st) == 0 && st.st_blksize > 0 &&
+		    ((size_t)st.st_blksize & ((size_t)st.st_blksize - 1)) ==
+		    0 && (size_t)st.st_blksize > gran) {
+			gran = (size_t)st.st_blksize;
+		}
+	} else {
+		return true;
+	}
+
+	if (gran > EXTENT_BACKING_RESERVE / 2) {
+		goto label_error;
+	}
+	size_t limit = EXTENT_BACKING_RESERVE - ALIGNMENT_ADDR2OFFSET(
+	    EXTENT_BACKING_RESERVE, gran);
+	void *addr = pages_reserve(limit + gran);
+	if (addr == NULL) {
+		goto label_error;
+	}
+	bool reused;
+	extent_backing_t *backing = extent_backing_get_unused(tsdn, &reused);
+	if (backing == NULL) {
+		pages_unmap(addr, limit + gran);
+		goto label_error;
+	}
+	backing->hooks.alloc = extent_backing_alloc;
+	backing->hooks.dalloc = extent_backing_dalloc;
+	backing->hooks.destroy = extent_backing_destroy;
+	backing->hooks.commit = extent_backing_commit;
+	backing->hooks.decommit = extent_backing_decommit;
+	backing->hooks.purge_lazy = extent_backing_purge_lazy;
+	backing->hooks.purge_forced = extent_backing_purge_forced;
+	backing->hooks.split = extent_backing_split;
+	backing->hooks.merge = extent_backing_merge;
+	backing->fd = fd;
+	backing->gran = gran;
+	backing->mmap_flags = mmap_flags;
+	backing->reserve_addr = addr;
+	backing->reserve_size = limit + gran;
+	/* Align the reservation to gran, as hugetlb mappings require. */
+	backing->base = ALIGNMENT_CEILING((uintptr_t)addr, gran);
+	backing->limit = limit;
+	backing->cur = 0;
+	backing->mapped = 0;
+
+	if (!reused) {
+		extent_backing_t *head = (extent_backing_t *)atomic_load_p(
+		    &backings, ATOMIC_RELAXED);
+		do {
+			backing->next = head;
+		} while (!atomic_compare_exchange_weak_p(&backings,
+		    (void **)&head, backing, ATOMIC_RELEASE, ATOMIC_RELAXED));
+	}
+
+	*r_extent_hooks = &backing->hooks;
+	return false;
+label_error:
+	if (fd != -1) {
+		close(fd);
+	}
+	return true;
+#endif
+}
+
+void
+extent_backing_hooks_release(tsdn_t *tsdn, extent_hooks_t *extent_hooks) {
+#ifndef _WIN32
+	if (!extent_backing_hooks_is(extent_hooks)) {
+		return;
+	}
+	extent_backing_t *backing = (extent_backing_t *)extent_hooks;
+	assert(atomic_load_b(&backing->in_use, ATOMIC_RELAXED));
+
+	pages_unmap(backing->reserve_addr, backing->reserve_size);
+	if (backing->fd != -1) {
+		close(backing->fd);
+	}
+	atomic_store_b(&backing->in_use, false, ATOMIC_RELEASE);
+#endif
+}
+
+bool
+extent_backing_hooks_prime(tsdn_t *tsdn, extent_hooks_t *extent_hooks) {
+	if (!extent_backing_hooks_is(extent_hooks)) {
+		return false;
+	}
+#ifdef _WIN32
+	not_reached();
+	return true;
+#else
+	extent_backing_t *backing = (extent_backing_t *)extent_hooks;
+	bool err = false;
+
+	malloc_mutex_lock(tsdn, &backing->mtx);
+	if (backing->mapped == 0) {
+		err = extent_backing_map(backing, 0, backing->gran);
+		if (!err) {
+			backing->mapped = backing->gran;
+		}
+	}
+	malloc_mutex_unlock(tsdn, &backing->mtx);
+	return err;
+#endif
+}
+
+bool
+extent_backing_hooks_is(const extent_hooks_t *extent_hooks) {
+#ifdef _WIN32
+	return false;
+#else
+	return extent_hooks->alloc == extent_backing_alloc;
+#endif
+}
+
+void
+extent_backing_prefork(tsdn_t *tsdn) {
+	for (extent_backing_t *backing = (extent_backing_t *)atomic_load_p(
+	    &backings, ATOMIC_ACQUIRE); backing != NULL;
+	    backing = backing->next) {
+		malloc_mutex_prefork(tsdn, &backing->mtx);
+	}
+}
+
+void
+extent_backing_postfork_parent(tsdn_t *tsdn) {
+	for (extent_backing_t *backing = (extent_backing_t *)atomic_load_p(
+	    &backings, ATOMIC_ACQUIRE); backing != NULL;
+	    backing = backing->next) {
+		malloc_mutex_postfork_parent(tsdn, &backing->mtx);
+	}
+}
+
+void
+extent_backing_postfork_child(tsdn_t *tsdn) {
+	for (extent_backing_t *backing = (extent_backing_t *)atomic_load_p(
+	    &backings, ATOMIC_ACQUIRE); backing != NULL;
+	    backing = backing->next) {
+		malloc_mutex_postfork_child(tsdn, &backing->mtx);
+		/*
+		 * File mappings remain shared with the parent, which keeps
+		 * carving from the same file offsets, so the child must not grow
+		 * them any further.
+		 */
+		if (backing->fd != -1) {
+			backing->limit = backing->cur;
+		}
+	}
+}
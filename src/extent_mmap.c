@@ -16,13 +16,65 @@ bool	opt_retain =
 #endif
     ;
 
+size_t	opt_reserve_vm = 0;
+
+/*
+ * Address space reserved at boot (see opt.reserve_vm), from which extents are
+ * carved in address order.  Immutable after extent_mmap_boot(), except for
+ * reserve_cur, which only ever grows.
+ */
+static uintptr_t	reserve_base;
+static size_t		reserve_size;
+static atomic_zu_t	reserve_cur;
+
 /******************************************************************************/
 
+static void *
+extent_alloc_reserve(void *new_addr, size_t size, size_t alignment,
+    bool *zero, bool *commit) {
+	size_t cur = atomic_load_zu(&reserve_cur, ATOMIC_RELAXED);
+	size_t offset, end;
+	do {
+		offset = ALIGNMENT_CEILING(reserve_base + cur, alignment) -
+		    reserve_base;
+		if (new_addr != NULL && (uintptr_t)new_addr != reserve_base +
+		    offset) {
+			return NULL;
+		}
+		end = offset + size;
+		/* Beware size_t wrap-around. */
+		if (end < offset || end > reserve_size) {
+			return NULL;
+		}
+	} while (!atomic_compare_exchange_weak_zu(&reserve_cur, &cur, end,
+	    ATOMIC_RELAXED, ATOMIC_RELAXED));
+
+	void *ret = (void *)(reserve_base + offset);
+	if (pages_map_reserved(ret, size, commit)) {
+		/* The range is lost, which is of no consequence. */
+		return NULL;
+	}
+	if (*commit) {
+		*zero = true;
+	}
+	return ret;
+}
+
 void *
 extent_alloc_mmap(void *new_addr, size_t size, size_t alignment, bool *zero,
     bool *commit) {
-	void *ret = pages_map(new_addr, size, ALIGNMENT_CEILING(alignment,
-	    PAGE), commit);
+	alignment = ALIGNMENT_CEILING(alignment, PAGE);
+	if (reserve_size != 0) {
+		void *ret = extent_alloc_reserve(new_addr, size, alignment,
+		    zero, commit);
+		if (ret != NULL || (new_addr != NULL &&
+		    extent_in_reserve(new_addr))) {
+			return ret;
+		}
+		/* Fall back to mapping memory once the reservation is used up. */
+	}
+
+	void *ret = pages_map(new_addr, size, alignment, commit);
 	if (ret == NULL) {
 		return NULL;
 	}
@@ -35,8 +87,48 @@ extent_alloc_mmap(void *new_addr, size_t size, size_t alignment, bool *zero,
 
 bool
 extent_dalloc_mmap(void *addr, size_t size) {
-	if (!opt_retain) {
+	/* Reserved address space is never handed back. */
+	if (!opt_retain && !extent_in_reserve(addr)) {
 		pages_unmap(addr, size);
+		return false;
+	}
+	return true;
+}
+
+bool
+extent_in_reserve(void *addr) {
+	return (uintptr_t)addr - reserve_base < reserve_size;
+}
+
+bool
+extent_mmap_mergeable(void *addr_a, void *addr_b) {
+	return extent_in_reserve(addr_a) == extent_in_reserve(addr_b);
+}
+
+void *
+extent_mmap_reserve_base(void) {
+	return (void *)reserve_base;
+}
+
+bool
+extent_mmap_boot(void) {
+	atomic_store_zu(&reserve_cur, 0, ATOMIC_RELAXED);
+	if (opt_reserve_vm == 0) {
+		return false;
+	}
+
+	size_t size = ALIGNMENT_CEILING(opt_reserve_vm, PAGE);
+	/* Beware size_t wrap-around. */
+	void *base = (size < opt_reserve_vm) ? NULL : pages_reserve(size);
+	if (base == NULL) {
+		malloc_write("<jemalloc>: Unable to reserve virtual memory "
+		    "(opt.reserve_vm)\n");
+		if (opt_abort) {
+			abort();
+		}
+		return false;
 	}
-	return opt_retain;
+	reserve_base = (uintptr_t)base;
+	reserve_size = size;
+	return false;
 }
@@ -5,6 +5,7 @@
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/atomic.h"
 #include "jemalloc/internal/ctl.h"
+#include "jemalloc/internal/extent_backing.h"
 #include "jemalloc/internal/extent_dss.h"
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/jemalloc_internal_types.h"
@@ -14,6 +15,7 @@
 #include "jemalloc/internal/size_classes.h"
 #include "jemalloc/internal/spin.h"
 #include "jemalloc/internal/sz.h"
+#include "jemalloc/internal/thread_event.h"
 #include "jemalloc/internal/ticker.h"
 #include "jemalloc/internal/util.h"
 
@@ -65,6 +67,7 @@ bool	opt_junk_free =
 bool	opt_utrace = false;
 bool	opt_xmalloc = false;
 bool	opt_zero = false;
+bool	opt_sized_dealloc_check = false;
 unsigned	opt_narenas = 0;
 
 unsigned	ncpus;
@@ -104,7 +107,8 @@ enum {
 	flag_opt_junk_free	= (1U << 1),
 	flag_opt_zero		= (1U << 2),
 	flag_opt_utrace		= (1U << 3),
-	flag_opt_xmalloc	= (1U << 4)
+	flag_opt_xmalloc	= (1U << 4),
+	flag_opt_sized_dealloc_check	= (1U << 5)
 };
 static uint8_t	malloc_slow_flags;
 
@@ -864,7 +868,8 @@ malloc_slow_flag_init(void) {
 	    | (opt_junk_free ? flag_opt_junk_free : 0)
 	    | (opt_zero ? flag_opt_zero : 0)
 	    | (opt_utrace ? flag_opt_utrace : 0)
-	    | (opt_xmalloc ? flag_opt_xmalloc : 0);
+	    | (opt_xmalloc ? flag_opt_xmalloc : 0)
+	    | (opt_sized_dealloc_check ? flag_opt_sized_dealloc_check : 0);
 
 	malloc_slow = (malloc_slow_flags != 0);
 }
@@ -1055,6 +1060,14 @@ malloc_conf_init(void) {
 				malloc_abort_invalid_conf();
 			}
 			CONF_HANDLE_BOOL(opt_retain, "retain")
+			CONF_HANDLE_SIZE_T(opt_retain_grow_limit,
+			    "retain_grow_limit", PAGE, LARGE_MAXCLASS, yes, yes,
+			    true)
+			CONF_HANDLE_SIZE_T(opt_reserve_vm, "reserve_vm", 0,
+			    SIZE_T_MAX, no, no, false)
+			CONF_HANDLE_SIZE_T(opt_zero_purge_threshold,
+			    "zero_purge_threshold", 0, SIZE_T_MAX, no, no,
+			    false)
 			if (strncmp("dss", k, klen) == 0) {
 				int i;
 				bool match = false;
@@ -1079,6 +1092,40 @@ malloc_conf_init(void) {
 				}
 				continue;
 			}
+			if (strncmp("thp_policy", k, klen) == 0) {
+				int i;
+				bool match = false;
+				for (i = 0; i < thp_policy_limit; i++) {
+					if (strncmp(thp_policy_names[i], v,
+					    vlen) == 0) {
+						opt_thp_policy = i;
+						match = true;
+						break;
+					}
+				}
+				if (!match) {
+					malloc_conf_error("Invalid conf value",
+					    k, klen, v, vlen);
+				}
+				continue;
+			}
+			if (strncmp("extent_fit", k, klen) == 0) {
+				int i;
+				bool match = false;
+				for (i = 0; i < extent_fit_limit; i++) {
+					if (strncmp(extent_fit_names[i], v,
+					    vlen) == 0) {
+						opt_extent_fit = i;
+						match = true;
+						break;
+					}
+				}
+				if (!match) {
+					malloc_conf_error("Invalid conf value",
+					    k, klen, v, vlen);
+				}
+				continue;
+			}
 			CONF_HANDLE_UNSIGNED(opt_narenas, "narenas", 1,
 			    UINT_MAX, yes, no, false)
 			CONF_HANDLE_SSIZE_T(opt_dirty_decay_ms,
@@ -1127,9 +1174,16 @@ malloc_conf_init(void) {
 			if (config_xmalloc) {
 				CONF_HANDLE_BOOL(opt_xmalloc, "xmalloc")
 			}
+			if (config_rtree_flat) {
+				CONF_HANDLE_BOOL(opt_rtree_flat, "rtree_flat")
+			}
+			CONF_HANDLE_BOOL(opt_sized_dealloc_check,
+			    "sized_dealloc_check")
 			CONF_HANDLE_BOOL(opt_tcache, "tcache")
 			CONF_HANDLE_SSIZE_T(opt_lg_tcache_max, "lg_tcache_max",
 			    -1, (sizeof(size_t) << 3) - 1)
+			CONF_HANDLE_SIZE_T(opt_tcache_gc_incr_bytes,
+			    "tcache_gc_incr_bytes", 0, SIZE_T_MAX, no, no, false)
 			if (strncmp("percpu_arena", k, klen) == 0) {
 				int i;
 				bool match = false;
@@ -1153,8 +1207,27 @@ malloc_conf_init(void) {
 				}
 				continue;
 			}
+			if (strncmp("prefault", k, klen) == 0) {
+				int i;
+				bool match = false;
+				for (i = 0; i < prefault_limit; i++) {
+					if (strncmp(prefault_names[i], v, vlen)
+					    == 0) {
+						opt_prefault = i;
+						match = true;
+						break;
+					}
+				}
+				if (!match) {
+					malloc_conf_error("Invalid conf value",
+					    k, klen, v, vlen);
+				}
+				continue;
+			}
 			CONF_HANDLE_BOOL(opt_background_thread,
 			    "background_thread");
+			CONF_HANDLE_BOOL(opt_background_purge_only,
+			    "background_purge_only");
 			if (config_prof) {
 				CONF_HANDLE_BOOL(opt_prof, "prof")
 				CONF_HANDLE_CHAR_P(opt_prof_prefix,
@@ -1237,6 +1310,9 @@ malloc_init_hard_a0_locked() {
 	if (pages_boot()) {
 		return true;
 	}
+	if (extent_mmap_boot()) {
+		return true;
+	}
 	if (base_boot(TSDN_NULL)) {
 		return true;
 	}
@@ -1628,6 +1704,7 @@ imalloc_no_sample(static_opts_t *sopts, dynamic_opts_t *dopts, tsd_t *tsd,
 		tcache = NULL;
 	} else {
 		tcache = tcaches_get(tsd, dopts->tcache_ind);
+		tcache_explicit_event(tsd, tcache, usize);
 	}
 
 	/* Fill in the arena. */
@@ -1774,10 +1851,8 @@ imalloc_body(static_opts_t *sopts, dynamic_opts_t *dopts, tsd_t *tsd) {
 		if (unlikely(ind >= NSIZES)) {
 			goto label_oom;
 		}
-		if (config_stats || (config_prof && opt_prof)) {
-			usize = sz_index2size(ind);
-			assert(usize > 0 && usize <= LARGE_MAXCLASS);
-		}
+		usize = sz_index2size(ind);
+		assert(usize > 0 && usize <= LARGE_MAXCLASS);
 	} else {
 		usize = sz_sa2u(size, dopts->alignment);
 		if (unlikely(usize == 0 || usize > LARGE_MAXCLASS)) {
@@ -1812,7 +1887,7 @@ imalloc_body(static_opts_t *sopts, dynamic_opts_t *dopts, tsd_t *tsd) {
 		 * initialized in the previous if statement.
 		 */
 		prof_tctx_t *tctx = prof_alloc_prep(
-		    tsd, usize, prof_active_get_unlocked(), true);
+		    tsd, usize, prof_active_get_unlocked());
 
 		alloc_ctx_t alloc_ctx;
 		if (likely((uintptr_t)tctx == (uintptr_t)1U)) {
@@ -1832,7 +1907,7 @@ imalloc_body(static_opts_t *sopts, dynamic_opts_t *dopts, tsd_t *tsd) {
 		}
 
 		if (unlikely(allocation == NULL)) {
-			prof_alloc_rollback(tsd, tctx, true);
+			prof_alloc_rollback(tsd, tctx);
 			goto label_oom;
 		}
 		prof_malloc(tsd_tsdn(tsd), allocation, usize, &alloc_ctx, tctx);
@@ -1857,10 +1932,8 @@ imalloc_body(static_opts_t *sopts, dynamic_opts_t *dopts, tsd_t *tsd) {
 	assert(dopts->alignment == 0
 	    || ((uintptr_t)allocation & (dopts->alignment - 1)) == ZU(0));
 
-	if (config_stats) {
-		assert(usize == isalloc(tsd_tsdn(tsd), allocation));
-		*tsd_thread_allocatedp_get(tsd) += usize;
-	}
+	assert(usize == isalloc(tsd_tsdn(tsd), allocation));
+	thread_alloc_event(tsd, usize);
 
 	if (sopts->slow) {
 		UTRACE(0, size, allocation);
@@ -1954,10 +2027,8 @@ imalloc(static_opts_t *sopts, dynamic_opts_t *dopts) {
  * Begin malloc(3)-compatible functions.
  */
 
-JEMALLOC_EXPORT JEMALLOC_ALLOCATOR JEMALLOC_RESTRICT_RETURN
-void JEMALLOC_NOTHROW *
-JEMALLOC_ATTR(malloc) JEMALLOC_ALLOC_SIZE(1)
-je_malloc(size_t size) {
+JEMALLOC_NOINLINE void *
+malloc_default(size_t size) {
 	void *ret;
 	static_opts_t sopts;
 	dynamic_opts_t dopts;
@@ -1979,6 +2050,13 @@ je_malloc(size_t size) {
 	return ret;
 }
 
+JEMALLOC_EXPORT JEMALLOC_ALLOCATOR JEMALLOC_RESTRICT_RETURN
+void JEMALLOC_NOTHROW *
+JEMALLOC_ATTR(malloc) JEMALLOC_ALLOC_SIZE(1)
+je_malloc(size_t size) {
+	return imalloc_fastpath(size, &malloc_default);
+}
+
 JEMALLOC_EXPORT int JEMALLOC_NOTHROW
 JEMALLOC_ATTR(nonnull(1))
 je_posix_memalign(void **memptr, size_t alignment, size_t size) {
@@ -2092,14 +2170,14 @@ irealloc_prof(tsd_t *tsd, void *old_ptr, size_t old_usize, size_t usize,
 
 	prof_active = prof_active_get_unlocked();
 	old_tctx = prof_tctx_get(tsd_tsdn(tsd), old_ptr, alloc_ctx);
-	tctx = prof_alloc_prep(tsd, usize, prof_active, true);
+	tctx = prof_alloc_prep(tsd, usize, prof_active);
 	if (unlikely((uintptr_t)tctx != (uintptr_t)1U)) {
 		p = irealloc_prof_sample(tsd, old_ptr, old_usize, usize, tctx);
 	} else {
 		p = iralloc(tsd, old_ptr, old_usize, usize, 0, false);
 	}
 	if (unlikely(p == NULL)) {
-		prof_alloc_rollback(tsd, tctx, true);
+		prof_alloc_rollback(tsd, tctx);
 		return NULL;
 	}
 	prof_realloc(tsd, p, usize, tctx, prof_active, true, old_ptr, old_usize,
@@ -2127,16 +2205,11 @@ ifree(tsd_t *tsd, void *ptr, tcache_t *tcache, bool slow_path) {
 	    (uintptr_t)ptr, true, &alloc_ctx.szind, &alloc_ctx.slab);
 	assert(alloc_ctx.szind != NSIZES);
 
-	size_t usize;
+	size_t usize = sz_index2size(alloc_ctx.szind);
 	if (config_prof && opt_prof) {
-		usize = sz_index2size(alloc_ctx.szind);
 		prof_free(tsd, ptr, usize, &alloc_ctx);
-	} else if (config_stats) {
-		usize = sz_index2size(alloc_ctx.szind);
-	}
-	if (config_stats) {
-		*tsd_thread_deallocatedp_get(tsd) += usize;
 	}
+	thread_dalloc_event(tsd, usize);
 
 	if (likely(!slow_path)) {
 		idalloctm(tsd_tsdn(tsd), ptr, tcache, &alloc_ctx, false,
@@ -2172,9 +2245,7 @@ isfree(tsd_t *tsd, void *ptr, size_t usize, tcache_t *tcache, bool slow_path) {
 		ctx = NULL;
 	}
 
-	if (config_stats) {
-		*tsd_thread_deallocatedp_get(tsd) += usize;
-	}
+	thread_dalloc_event(tsd, usize);
 
 	if (likely(!slow_path)) {
 		isdalloct(tsd_tsdn(tsd), ptr, usize, tcache, ctx, false);
@@ -2222,15 +2293,12 @@ je_realloc(void *ptr, size_t size) {
 		assert(alloc_ctx.szind != NSIZES);
 		old_usize = sz_index2size(alloc_ctx.szind);
 		assert(old_usize == isalloc(tsd_tsdn(tsd), ptr));
+		usize = sz_s2u(size);
 		if (config_prof && opt_prof) {
-			usize = sz_s2u(size);
 			ret = unlikely(usize == 0 || usize > LARGE_MAXCLASS) ?
 			    NULL : irealloc_prof(tsd, ptr, old_usize, usize,
 			    &alloc_ctx);
 		} else {
-			if (config_stats) {
-				usize = sz_s2u(size);
-			}
 			ret = iralloc(tsd, ptr, old_usize, size, 0, false);
 		}
 		tsdn = tsd_tsdn(tsd);
@@ -2247,21 +2315,21 @@ je_realloc(void *ptr, size_t size) {
 		}
 		set_errno(ENOMEM);
 	}
-	if (config_stats && likely(ret != NULL)) {
+	if (likely(ret != NULL)) {
 		tsd_t *tsd;
 
 		assert(usize == isalloc(tsdn, ret));
 		tsd = tsdn_tsd(tsdn);
-		*tsd_thread_allocatedp_get(tsd) += usize;
-		*tsd_thread_deallocatedp_get(tsd) += old_usize;
+		thread_alloc_event(tsd, usize);
+		thread_dalloc_event(tsd, old_usize);
 	}
 	UTRACE(ptr, size, ret);
 	check_entry_exit_locking(tsdn);
 	return ret;
 }
 
-JEMALLOC_EXPORT void JEMALLOC_NOTHROW
-je_free(void *ptr) {
+JEMALLOC_NOINLINE void
+free_default(void *ptr) {
 	UTRACE(ptr, 0, 0);
 	if (likely(ptr != NULL)) {
 		/*
@@ -2293,6 +2361,13 @@ je_free(void *ptr) {
 	}
 }
 
+JEMALLOC_EXPORT void JEMALLOC_NOTHROW
+je_free(void *ptr) {
+	if (!free_fastpath(ptr, 0, false)) {
+		free_default(ptr);
+	}
+}
+
 /*
  * End malloc(3)-compatible functions.
  */
@@ -2502,7 +2577,7 @@ irallocx_prof(tsd_t *tsd, void *old_ptr, size_t old_usize, size_t size,
 
 	prof_active = prof_active_get_unlocked();
 	old_tctx = prof_tctx_get(tsd_tsdn(tsd), old_ptr, alloc_ctx);
-	tctx = prof_alloc_prep(tsd, *usize, prof_active, false);
+	tctx = prof_alloc_prep(tsd, *usize, prof_active);
 	if (unlikely((uintptr_t)tctx != (uintptr_t)1U)) {
 		p = irallocx_prof_sample(tsd_tsdn(tsd), old_ptr, old_usize,
 		    *usize, alignment, zero, tcache, arena, tctx);
@@ -2511,7 +2586,7 @@ irallocx_prof(tsd_t *tsd, void *old_ptr, size_t old_usize, size_t size,
 		    zero, tcache, arena);
 	}
 	if (unlikely(p == NULL)) {
-		prof_alloc_rollback(tsd, tctx, false);
+		prof_alloc_rollback(tsd, tctx);
 		return NULL;
 	}
 
@@ -2544,6 +2619,7 @@ je_rallocx(void *ptr, size_t size, int flags) {
 	bool zero = flags & MALLOCX_ZERO;
 	arena_t *arena;
 	tcache_t *tcache;
+	bool tcache_explicit = false;
 
 	assert(ptr != NULL);
 	assert(size != 0);
@@ -2566,6 +2642,7 @@ je_rallocx(void *ptr, size_t size, int flags) {
 			tcache = NULL;
 		} else {
 			tcache = tcaches_get(tsd, MALLOCX_TCACHE_GET(flags));
+			tcache_explicit = true;
 		}
 	} else {
 		tcache = tcache_get(tsd);
@@ -2595,15 +2672,14 @@ je_rallocx(void *ptr, size_t size, int flags) {
 		if (unlikely(p == NULL)) {
 			goto label_oom;
 		}
-		if (config_stats) {
-			usize = isalloc(tsd_tsdn(tsd), p);
-		}
+		usize = isalloc(tsd_tsdn(tsd), p);
 	}
 	assert(alignment == 0 || ((uintptr_t)p & (alignment - 1)) == ZU(0));
 
-	if (config_stats) {
-		*tsd_thread_allocatedp_get(tsd) += usize;
-		*tsd_thread_deallocatedp_get(tsd) += old_usize;
+	thread_alloc_event(tsd, usize);
+	thread_dalloc_event(tsd, old_usize);
+	if (unlikely(tcache_explicit)) {
+		tcache_explicit_event(tsd, tcache, usize + old_usize);
 	}
 	UTRACE(ptr, size, p);
 	check_entry_exit_locking(tsd_tsdn(tsd));
@@ -2675,7 +2751,7 @@ ixallocx_prof(tsd_t *tsd, void *ptr, size_t old_usize, size_t size,
 			usize_max = LARGE_MAXCLASS;
 		}
 	}
-	tctx = prof_alloc_prep(tsd, usize_max, prof_active, false);
+	tctx = prof_alloc_prep(tsd, usize_max, prof_active);
 
 	if (unlikely((uintptr_t)tctx != (uintptr_t)1U)) {
 		usize = ixallocx_prof_sample(tsd_tsdn(tsd), ptr, old_usize,
@@ -2685,7 +2761,7 @@ ixallocx_prof(tsd_t *tsd, void *ptr, size_t old_usize, size_t size,
 		    extra, alignment, zero);
 	}
 	if (usize == old_usize) {
-		prof_alloc_rollback(tsd, tctx, false);
+		prof_alloc_rollback(tsd, tctx);
 		return usize;
 	}
 	prof_realloc(tsd, ptr, usize, tctx, prof_active, false, ptr, old_usize,
@@ -2743,10 +2819,8 @@ je_xallocx(void *ptr, size_t size, size_t extra, int flags) {
 		goto label_not_resized;
 	}
 
-	if (config_stats) {
-		*tsd_thread_allocatedp_get(tsd) += usize;
-		*tsd_thread_deallocatedp_get(tsd) += old_usize;
-	}
+	thread_alloc_event(tsd, usize);
+	thread_dalloc_event(tsd, old_usize);
 label_not_resized:
 	UTRACE(ptr, size, ptr);
 	check_entry_exit_locking(tsd_tsdn(tsd));
@@ -2793,6 +2867,8 @@ je_dallocx(void *ptr, int flags) {
 			tcache = NULL;
 		} else {
 			tcache = tcaches_get(tsd, MALLOCX_TCACHE_GET(flags));
+			tcache_explicit_event(tsd, tcache, isalloc(tsd_tsdn(tsd),
+			    ptr));
 		}
 	} else {
 		if (likely(fast)) {
@@ -2831,14 +2907,36 @@ inallocx(tsdn_t *tsdn, size_t size, int flags) {
 	return usize;
 }
 
-JEMALLOC_EXPORT void JEMALLOC_NOTHROW
-je_sdallocx(void *ptr, size_t size, int flags) {
+/*
+ * Reports a size passed to sdallocx() that does not match ptr's size class,
+ * and returns the correct usable size so that the deallocation can proceed
+ * safely.
+ */
+static size_t
+sdallocx_size_check(tsd_t *tsd, void *ptr, size_t usize) {
+	size_t actual = isalloc(tsd_tsdn(tsd), ptr);
+	if (unlikely(actual != usize)) {
+		malloc_printf("<jemalloc>: Size mismatch in sized deallocation "
+		    "of %p (size class %zu, actual size class %zu)\n", ptr,
+		    usize, actual);
+		if (opt_abort) {
+			abort();
+		}
+	}
+	return actual;
+}
+
+JEMALLOC_NOINLINE void
+sdallocx_default(void *ptr, size_t size, int flags) {
 	assert(ptr != NULL);
 	assert(malloc_initialized() || IS_INITIALIZER);
 
 	tsd_t *tsd = tsd_fetch();
 	bool fast = tsd_fast(tsd);
 	size_t usize = inallocx(tsd_tsdn(tsd), size, flags);
+	if (unlikely(opt_sized_dealloc_check)) {
+		usize = sdallocx_size_check(tsd, ptr, usize);
+	}
 	assert(usize == isalloc(tsd_tsdn(tsd), ptr));
 	check_entry_exit_locking(tsd_tsdn(tsd));
 
@@ -2850,6 +2948,7 @@ je_sdallocx(void *ptr, size_t size, int flags) {
 			tcache = NULL;
 		} else {
 			tcache = tcaches_get(tsd, MALLOCX_TCACHE_GET(flags));
+			tcache_explicit_event(tsd, tcache, usize);
 		}
 	} else {
 		if (likely(fast)) {
@@ -2874,6 +2973,13 @@ je_sdallocx(void *ptr, size_t size, int flags) {
 	check_entry_exit_locking(tsd_tsdn(tsd));
 }
 
+JEMALLOC_EXPORT void JEMALLOC_NOTHROW
+je_sdallocx(void *ptr, size_t size, int flags) {
+	if (flags != 0 || !free_fastpath(ptr, size, true)) {
+		sdallocx_default(ptr, size, flags);
+	}
+}
+
 JEMALLOC_EXPORT size_t JEMALLOC_NOTHROW
 JEMALLOC_ATTR(pure)
 je_nallocx(size_t size, int flags) {
@@ -3082,6 +3188,7 @@ _malloc_prefork(void)
 		}
 	}
 	prof_prefork1(tsd_tsdn(tsd));
+	extent_backing_prefork(tsd_tsdn(tsd));
 }
 
 #ifndef JEMALLOC_MUTEX_INIT_CB
@@ -3106,6 +3213,7 @@ _malloc_postfork(void)
 
 	witness_postfork_parent(tsd_witness_tsdp_get(tsd));
 	/* Release all mutexes, now that fork() has completed. */
+	extent_backing_postfork_parent(tsd_tsdn(tsd));
 	for (i = 0, narenas = narenas_total_get(); i < narenas; i++) {
 		arena_t *arena;
 
@@ -3133,6 +3241,7 @@ jemalloc_postfork_child(void) {
 
 	witness_postfork_child(tsd_witness_tsdp_get(tsd));
 	/* Release all mutexes, now that fork() has completed. */
+	extent_backing_postfork_child(tsd_tsdn(tsd));
 	for (i = 0, narenas = narenas_total_get(); i < narenas; i++) {
 		arena_t *arena;
 
@@ -39,12 +39,38 @@ void	operator delete(void *ptr, std::size_t size) noexcept;
 void	operator delete[](void *ptr, std::size_t size) noexcept;
 #endif
 
-template <bool IsNoExcept>
-void *
-newImpl(std::size_t size) noexcept(IsNoExcept) {
-	void *ptr = je_malloc(size);
-	if (likely(ptr != nullptr))
-		return ptr;
+#if __cpp_aligned_new >= 201606
+/* C++17's over-aligned operators. */
+void	*operator new(std::size_t size, std::align_val_t);
+void	*operator new[](std::size_t size, std::align_val_t);
+void	*operator new(std::size_t size, std::align_val_t,
+    const std::nothrow_t &) noexcept;
+void	*operator new[](std::size_t size, std::align_val_t,
+    const std::nothrow_t &) noexcept;
+void	operator delete(void *ptr, std::align_val_t) noexcept;
+void	operator delete[](void *ptr, std::align_val_t) noexcept;
+void	operator delete(void *ptr, std::align_val_t,
+    const std::nothrow_t &) noexcept;
+void	operator delete[](void *ptr, std::align_val_t,
+    const std::nothrow_t &) noexcept;
+void	operator delete(void *ptr, std::size_t size,
+    std::align_val_t) noexcept;
+void	operator delete[](void *ptr, std::size_t size,
+    std::align_val_t) noexcept;
+#endif
+
+static void *
+alignedAlloc(std::size_t size, std::size_t alignment) noexcept {
+	if (alignment == 0)
+		return je_malloc(size);
+	return je_mallocx(size == 0 ? 1 : size, MALLOCX_ALIGN(alignment));
+}
+
+/* Runs the new-handler loop; only reached once an allocation has failed. */
+JEMALLOC_NOINLINE
+static void *
+handleOOM(std::size_t size, std::size_t alignment, bool nothrow) {
+	void *ptr = nullptr;
 
 	while (ptr == nullptr) {
 		std::new_handler handler;
@@ -65,14 +91,37 @@ newImpl(std::size_t size) noexcept(IsNoExcept) {
 			break;
 		}
 
-		ptr = je_malloc(size);
+		ptr = alignedAlloc(size, alignment);
 	}
 
-	if (ptr == nullptr && !IsNoExcept)
+	if (ptr == nullptr && !nothrow)
 		std::__throw_bad_alloc();
 	return ptr;
 }
 
+template <bool IsNoExcept>
+JEMALLOC_NOINLINE
+static void *
+fallbackNewImpl(std::size_t size) noexcept(IsNoExcept) {
+	void *ptr = malloc_default(size);
+	if (likely(ptr != nullptr))
+		return ptr;
+
+	return handleOOM(size, 0, IsNoExcept);
+}
+
+/*
+ * The malloc() fast path is inlined here, rather than reached through
+ * je_malloc(), so that the common case pays for neither the call through the
+ * PLT nor the new-handler machinery.
+ */
+template <bool IsNoExcept>
+JEMALLOC_ALWAYS_INLINE
+void *
+newImpl(std::size_t size) noexcept(IsNoExcept) {
+	return imalloc_fastpath(size, &fallbackNewImpl<IsNoExcept>);
+}
+
 void *
 operator new(std::size_t size) {
 	return newImpl<false>(size);
@@ -93,40 +142,189 @@ operator new[](std::size_t size, const std::nothrow_t &) noexcept {
 	return newImpl<true>(size);
 }
 
+JEMALLOC_ALWAYS_INLINE
+void
+deleteImpl(void *ptr) noexcept {
+	if (unlikely(!free_fastpath(ptr, 0, false)))
+		free_default(ptr);
+}
+
 void
 operator delete(void *ptr) noexcept {
-	je_free(ptr);
+	deleteImpl(ptr);
 }
 
 void
 operator delete[](void *ptr) noexcept {
-	je_free(ptr);
+	deleteImpl(ptr);
 }
 
 void
 operator delete(void *ptr, const std::nothrow_t &) noexcept {
-	je_free(ptr);
+	deleteImpl(ptr);
 }
 
 void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
-	je_free(ptr);
+	deleteImpl(ptr);
 }
 
 #if __cpp_sized_deallocation >= 201309
 
+JEMALLOC_ALWAYS_INLINE
 void
-operator delete(void *ptr, std::size_t size) noexcept {
+sizedDeleteImpl(void *ptr, std::size_t size) noexcept {
 	if (unlikely(ptr == nullptr)) {
 		return;
 	}
-	je_sdallocx(ptr, size, /*flags=*/0);
+	if (unlikely(!free_fastpath(ptr, size, true)))
+		sdallocx_default(ptr, size, /*flags=*/0);
+}
+
+void
+operator delete(void *ptr, std::size_t size) noexcept {
+	sizedDeleteImpl(ptr, size);
 }
 
 void operator delete[](void *ptr, std::size_t size) noexcept {
+	sizedDeleteImpl(ptr, size);
+}
+
+#endif  // __cpp_sized_deallocation
+
+#if __cpp_aligned_new >= 201606
+
+/*
+ * For alignments below PAGE, sz_sa2u() picks a small size class whose objects
+ * are all suitably aligned, so a request for that size can take the ordinary
+ * malloc()/free() fast paths.  Everything else goes through mallocx() and
+ * sdallocx() with MALLOCX_ALIGN().
+ */
+JEMALLOC_ALWAYS_INLINE
+std::size_t
+alignedSmallUsize(std::size_t size, std::size_t alignment) noexcept {
+	if (likely(alignment < PAGE)) {
+		std::size_t usize = sz_sa2u(size == 0 ? 1 : size, alignment);
+		if (likely(usize <= SMALL_MAXCLASS))
+			return usize;
+	}
+	return 0;
+}
+
+template <bool IsNoExcept>
+JEMALLOC_NOINLINE
+static void *
+fallbackAlignedNewImpl(std::size_t size, std::size_t alignment)
+    noexcept(IsNoExcept) {
+	void *ptr = alignedAlloc(size, alignment);
+	if (likely(ptr != nullptr))
+		return ptr;
+
+	return handleOOM(size, alignment, IsNoExcept);
+}
+
+/*
+ * Fallback for the fast path below, which only passes on usize.  Objects of a
+ * small size class are aligned at the lowest set bit of usize, which is at least
+ * the requested alignment.  Capping it below PAGE keeps usize unchanged, so that
+ * sized deletion still finds the same size class.  The alignment is passed on
+ * explicitly, since e.g. prof-sampled objects are promoted to large ones with
+ * a randomized offset otherwise.
+ */
+template <bool IsNoExcept>
+JEMALLOC_NOINLINE
+static void *
+fallbackAlignedSmallNewImpl(std::size_t usize) noexcept(IsNoExcept) {
+	std::size_t alignment = usize & (~usize + 1);
+	if (alignment >= PAGE)
+		alignment = PAGE >> 1;
+	return fallbackAlignedNewImpl<IsNoExcept>(usize, alignment);
+}
+
+template <bool IsNoExcept>
+JEMALLOC_ALWAYS_INLINE
+void *
+alignedNewImpl(std::size_t size, std::align_val_t alignment)
+    noexcept(IsNoExcept) {
+	std::size_t align = static_cast<std::size_t>(alignment);
+	std::size_t usize = alignedSmallUsize(size, align);
+	if (likely(usize != 0)) {
+		return imalloc_fastpath(usize,
+		    &fallbackAlignedSmallNewImpl<IsNoExcept>);
+	}
+	return fallbackAlignedNewImpl<IsNoExcept>(size, align);
+}
+
+JEMALLOC_ALWAYS_INLINE
+void
+alignedSizedDeleteImpl(void *ptr, std::size_t size,
+    std::align_val_t alignment) noexcept {
 	if (unlikely(ptr == nullptr)) {
 		return;
 	}
-	je_sdallocx(ptr, size, /*flags=*/0);
+	if (unlikely(size == 0)) {
+		/* Zero-sized requests were allocated as one byte. */
+		size = 1;
+	}
+	std::size_t align = static_cast<std::size_t>(alignment);
+	std::size_t usize = alignedSmallUsize(size, align);
+	if (likely(usize != 0) && likely(free_fastpath(ptr, usize, true)))
+		return;
+	sdallocx_default(ptr, size, MALLOCX_ALIGN(align));
 }
 
-#endif  // __cpp_sized_deallocation
+void *
+operator new(std::size_t size, std::align_val_t alignment) {
+	return alignedNewImpl<false>(size, alignment);
+}
+
+void *
+operator new[](std::size_t size, std::align_val_t alignment) {
+	return alignedNewImpl<false>(size, alignment);
+}
+
+void *
+operator new(std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t &) noexcept {
+	return alignedNewImpl<true>(size, alignment);
+}
+
+void *
+operator new[](std::size_t size, std::align_val_t alignment,
+    const std::nothrow_t &) noexcept {
+	return alignedNewImpl<true>(size, alignment);
+}
+
+void
+operator delete(void *ptr, std::align_val_t) noexcept {
+	deleteImpl(ptr);
+}
+
+void
+operator delete[](void *ptr, std::align_val_t) noexcept {
+	deleteImpl(ptr);
+}
+
+void
+operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept {
+	deleteImpl(ptr);
+}
+
+void
+operator delete[](void *ptr, std::align_val_t,
+    const std::nothrow_t &) noexcept {
+	deleteImpl(ptr);
+}
+
+void
+operator delete(void *ptr, std::size_t size,
+    std::align_val_t alignment) noexcept {
+	alignedSizedDeleteImpl(ptr, size, alignment);
+}
+
+void
+operator delete[](void *ptr, std::size_t size,
+    std::align_val_t alignment) noexcept {
+	alignedSizedDeleteImpl(ptr, size, alignment);
+}
+
+#endif  // __cpp_aligned_new
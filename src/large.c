@@ -8,6 +8,13 @@
 #include "jemalloc/internal/rtree.h"
 #include "jemalloc/internal/util.h"
 
+/*
+ * Minimum size of an allocation whose pages large_ralloc() moves rather than
+ * copies.  Below this, memcpy() is about as fast as the remapping (and the TLB
+ * shootdown that comes with it), and each move may fragment the mappings.
+ */
+#define LARGE_RALLOC_MOVE_MINSIZE	HUGEPAGE
+
 /******************************************************************************/
 
 void *
@@ -269,6 +276,88 @@ large_ralloc_move_helper(tsdn_t *tsdn, arena_t *arena, size_t usize,
 	return large_palloc(tsdn, arena, usize, alignment, zero);
 }
 
+/*
+ * Fills [addr, addr+size) the way a new allocation made by
+ * large_ralloc_move_helper() is filled.
+ */
+static void
+large_ralloc_move_fill(void *addr, size_t size, bool zero) {
+	if (zero || (config_fill && unlikely(opt_zero))) {
+		memset(addr, 0, size);
+	} else if (config_fill && unlikely(opt_junk_alloc)) {
+		memset(addr, JEMALLOC_ALLOC_JUNK, size);
+	}
+}
+
+/*
+ * Moves the pages backing extent into the newly allocated ret by remapping
+ * them rather than copying their contents, and returns the address of the
+ * moved allocation, or NULL if the pages cannot be moved.  This only applies
+ * to mmap()ed memory managed by the default extent hooks.  The old extent is
+ * left mapped, but without pages, so it can be deallocated as usual.
+ */
+static void *
+large_ralloc_move_pages(tsdn_t *tsdn, extent_t *extent, void *ret, size_t usize,
+    size_t alignment, bool zero) {
+	size_t oldusize = extent_usize_get(extent);
+
+	if (oldusize < LARGE_RALLOC_MOVE_MINSIZE || usize <= oldusize) {
+		return NULL;
+	}
+	extent_t *dst = iealloc(tsdn, ret);
+	/*
+	 * Remapping discards the pages that back the destination, and leaves
+	 * the source range without pages, to be faulted in again once reused.
+	 * That only pays off if the destination is not backed by (dirty) pages
+	 * to begin with; otherwise copying into them is cheaper overall.
+	 */
+	if (!extent_zeroed_get(dst)) {
+		return NULL;
+	}
+	if (extent_hooks_get(extent_arena_get(dst)) != &extent_hooks_default ||
+	    extent_hooks_get(extent_arena_get(extent)) !=
+	    &extent_hooks_default) {
+		return NULL;
+	}
+	if (have_dss && (extent_in_dss(extent_base_get(extent)) ||
+	    extent_in_dss(ret))) {
+		return NULL;
+	}
+
+	/*
+	 * Moving pages preserves offsets within them, so the moved allocation
+	 * has to be at the same offset from the extent base as the old one
+	 * (which differs from that of ret if cache-oblivious randomization is
+	 * in effect).
+	 */
+	size_t offset = (uintptr_t)extent_addr_get(extent) -
+	    (uintptr_t)extent_base_get(extent);
+	void *addr = (void *)((uintptr_t)extent_base_get(dst) + offset);
+	if ((alignment != 0 && ALIGNMENT_ADDR2OFFSET(addr, alignment) != 0) ||
+	    (uintptr_t)addr + usize > (uintptr_t)extent_past_get(dst)) {
+		return NULL;
+	}
+	size_t size = PAGE_CEILING(offset + oldusize);
+	if (pages_move(extent_base_get(dst), extent_base_get(extent), size)) {
+		return NULL;
+	}
+	extent_addr_set(dst, addr);
+
+	/*
+	 * The tail of the last moved page comes from the old extent, and if
+	 * the allocation moved up, its end lies beyond the range that was
+	 * filled when it was allocated.
+	 */
+	void *moved_end = (void *)((uintptr_t)extent_base_get(dst) + size);
+	large_ralloc_move_fill((void *)((uintptr_t)addr + oldusize),
+	    (uintptr_t)moved_end - ((uintptr_t)addr + oldusize), zero);
+	if ((uintptr_t)addr > (uintptr_t)ret) {
+		large_ralloc_move_fill((void *)((uintptr_t)ret + usize),
+		    (uintptr_t)addr - (uintptr_t)ret, zero);
+	}
+	return addr;
+}
+
 void *
 large_ralloc(tsdn_t *tsdn, arena_t *arena, extent_t *extent, size_t usize,
     size_t alignment, bool zero, tcache_t *tcache) {
@@ -295,8 +384,14 @@ large_ralloc(tsdn_t *tsdn, arena_t *arena, extent_t *extent, size_t usize,
 		return NULL;
 	}
 
-	size_t copysize = (usize < oldusize) ? usize : oldusize;
-	memcpy(ret, extent_addr_get(extent), copysize);
+	void *moved = large_ralloc_move_pages(tsdn, extent, ret, usize,
+	    alignment, zero);
+	if (moved != NULL) {
+		ret = moved;
+	} else {
+		size_t copysize = (usize < oldusize) ? usize : oldusize;
+		memcpy(ret, extent_addr_get(extent), copysize);
+	}
 	isdalloct(tsdn, extent_addr_get(extent), oldusize, tcache, NULL, true);
 	return ret;
 }
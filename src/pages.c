@@ -24,6 +24,28 @@ static size_t	os_page;
 static int	mmap_flags;
 #endif
 static bool	os_overcommits;
+#ifdef JEMALLOC_HAVE_MREMAP_DONTUNMAP
+/* Cleared if the kernel turns out not to support pages_move(). */
+static atomic_b_t	pages_can_move = ATOMIC_INIT(true);
+#endif
+#ifdef JEMALLOC_HAVE_MADVISE_POPULATE_WRITE
+/* Cleared if the kernel turns out not to support MADV_POPULATE_WRITE. */
+static atomic_b_t	pages_can_populate = ATOMIC_INIT(true);
+#endif
+#if defined(JEMALLOC_THP) && defined(__linux__)
+#  ifndef MADV_COLLAPSE
+/* Not defined by C libraries predating Linux 6.1; the value is kernel ABI. */
+#    define MADV_COLLAPSE 25
+#  endif
+/* Whether the kernel supports MADV_COLLAPSE, probed on first use. */
+typedef enum {
+	pages_collapse_unknown		= 0,
+	pages_collapse_supported	= 1,
+	pages_collapse_unsupported	= 2
+} pages_collapse_support_t;
+static atomic_u_t	pages_collapse_support = ATOMIC_INIT(
+    pages_collapse_unknown);
+#endif
 
 /******************************************************************************/
 /*
@@ -201,15 +223,30 @@ pages_unmap(void *addr, size_t size) {
 	os_pages_unmap(addr, size);
 }
 
-static bool
-pages_commit_impl(void *addr, size_t size, bool commit) {
-	assert(PAGE_ADDR2BASE(addr) == addr);
-	assert(PAGE_CEILING(size) == size);
+/*
+ * Reserves size bytes of address space, without committing (or, where
+ * possible, accounting for) any memory.  Parts of the range are then mapped
+ * via pages_map_reserved().
+ */
+void *
+pages_reserve(size_t size) {
+	assert(ALIGNMENT_CEILING(size, os_page) == size);
+	assert(size != 0);
 
-	if (os_overcommits) {
-		return true;
-	}
+#ifdef _WIN32
+	return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	int flags = mmap_flags;
+#  ifdef MAP_NORESERVE
+	flags |= MAP_NORESERVE;
+#  endif
+	void *ret = mmap(NULL, size, PAGES_PROT_DECOMMIT, flags, -1, 0);
+	return (ret == MAP_FAILED) ? NULL : ret;
+#endif
+}
 
+static bool
+os_pages_commit(void *addr, size_t size, bool commit) {
 #ifdef _WIN32
 	return (commit ? (addr != VirtualAlloc(addr, size, MEM_COMMIT,
 	    PAGE_READWRITE)) : (!VirtualFree(addr, size, MEM_DECOMMIT)));
@@ -234,6 +271,35 @@ pages_commit_impl(void *addr, size_t size, bool commit) {
 #endif
 }
 
+/*
+ * Makes [addr, addr+size), which lies within a range returned by
+ * pages_reserve(), available for use, with the same commit semantics as
+ * pages_map().  Returns true on error.
+ */
+bool
+pages_map_reserved(void *addr, size_t size, bool *commit) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+
+	if (os_overcommits) {
+		*commit = true;
+	}
+	/* Reserved pages start out decommitted. */
+	return *commit && os_pages_commit(addr, size, true);
+}
+
+static bool
+pages_commit_impl(void *addr, size_t size, bool commit) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+
+	if (os_overcommits) {
+		return true;
+	}
+
+	return os_pages_commit(addr, size, commit);
+}
+
 bool
 pages_commit(void *addr, size_t size) {
 	return pages_commit_impl(addr, size, true);
@@ -310,6 +376,99 @@ pages_nohuge(void *addr, size_t size) {
 #endif
 }
 
+/*
+ * Synchronously backs [addr, addr+size) with huge pages, rather than leaving
+ * it to khugepaged.  Returns true if the range could not be collapsed.
+ */
+bool
+pages_collapse(void *addr, size_t size) {
+	assert(HUGEPAGE_ADDR2BASE(addr) == addr);
+	assert(HUGEPAGE_CEILING(size) == size);
+
+#if defined(JEMALLOC_THP) && defined(__linux__)
+	unsigned support = atomic_load_u(&pages_collapse_support,
+	    ATOMIC_RELAXED);
+	if (support == pages_collapse_unknown) {
+		/*
+		 * Collapsing may fail with EINVAL for transient reasons too,
+		 * so probe with an empty range instead, which only kernels
+		 * prior to Linux 6.1 reject.
+		 */
+		support = (madvise(NULL, 0, MADV_COLLAPSE) == 0) ?
+		    pages_collapse_supported : pages_collapse_unsupported;
+		atomic_store_u(&pages_collapse_support, support,
+		    ATOMIC_RELAXED);
+	}
+	if (support == pages_collapse_unsupported) {
+		return true;
+	}
+	return (madvise(addr, size, MADV_COLLAPSE) != 0);
+#else
+	return true;
+#endif
+}
+
+/*
+ * Moves the pages backing [src, src+size) to [dst, dst+size) by remapping them,
+ * replacing whatever was mapped at dst.  The source range stays mapped, but is
+ * left without any pages, i.e. it reads as zeros.  Returns true if the pages
+ * could not be moved, in which case neither range is modified.
+ */
+bool
+pages_move(void *dst, void *src, size_t size) {
+	assert(PAGE_ADDR2BASE(dst) == dst);
+	assert(PAGE_ADDR2BASE(src) == src);
+	assert(PAGE_CEILING(size) == size);
+
+#ifdef JEMALLOC_HAVE_MREMAP_DONTUNMAP
+	if (!atomic_load_b(&pages_can_move, ATOMIC_RELAXED)) {
+		return true;
+	}
+	void *ret = mremap(src, size, size, MREMAP_MAYMOVE | MREMAP_FIXED |
+	    MREMAP_DONTUNMAP, dst);
+	if (ret == MAP_FAILED) {
+		/* Kernels prior to Linux 5.7 reject MREMAP_DONTUNMAP. */
+		if (get_errno() == EINVAL) {
+			atomic_store_b(&pages_can_move, false, ATOMIC_RELAXED);
+		}
+		return true;
+	}
+	assert(ret == dst);
+	return false;
+#else
+	return true;
+#endif
+}
+
+/*
+ * Faults in writable pages for the committed range [addr, addr+size) without
+ * modifying its contents, so that subsequent first touches do not fault.
+ */
+bool
+pages_populate(void *addr, size_t size) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+
+#ifdef JEMALLOC_HAVE_MADVISE_POPULATE_WRITE
+	if (atomic_load_b(&pages_can_populate, ATOMIC_RELAXED)) {
+		if (madvise(addr, size, MADV_POPULATE_WRITE) == 0) {
+			return false;
+		}
+		/* Kernels prior to Linux 5.14 reject MADV_POPULATE_WRITE. */
+		if (get_errno() != EINVAL) {
+			return true;
+		}
+		atomic_store_b(&pages_can_populate, false, ATOMIC_RELAXED);
+	}
+#endif
+	for (uintptr_t p = (uintptr_t)addr; p < (uintptr_t)addr + size; p +=
+	    PAGE) {
+		volatile char *c = (volatile char *)p;
+		*c = *c;
+	}
+	return false;
+}
+
 static size_t
 os_page_detect(void) {
 #ifdef _WIN32
@@ -7,6 +7,7 @@
 #include "jemalloc/internal/hash.h"
 #include "jemalloc/internal/malloc_io.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/thread_event.h"
 
 /******************************************************************************/
 
@@ -111,6 +112,7 @@ static uint64_t		prof_dump_seq;
 static uint64_t		prof_dump_iseq;
 static uint64_t		prof_dump_mseq;
 static uint64_t		prof_dump_useq;
+static uint64_t		prof_dump_dseq;
 
 /*
  * This buffer is rather large for stack allocation, so use a single buffer for
@@ -128,6 +130,58 @@ static char		prof_dump_buf[
 static size_t		prof_dump_buf_end;
 static int		prof_dump_fd;
 
+/*
+ * Snapshot of the tctx's captured by the dump in progress, in gctx dump order.
+ * This allows the profile to be formatted and written without holding any
+ * gctx locks.  Protected by prof_dump_mtx.
+ */
+static prof_tctx_t	**prof_dump_tctxs;
+
+/* Bytes written by the dump in progress, protected by prof_dump_mtx. */
+static uint64_t		prof_dump_nwritten;
+
+/*
+ * Duration and size of the most recent successful dump, protected by
+ * prof_dump_mtx.
+ */
+static uint64_t		prof_dump_last_ns;
+static uint64_t		prof_dump_last_bytes;
+
+/*
+ * Sequence number of the current diff baseline; gctx baselines recorded under
+ * any other sequence number are treated as empty.  prof_dump_diff_threshold is
+ * the minimum growth in live bytes for a backtrace to be included in a diff
+ * dump.  Both are protected by prof_dump_mtx.
+ */
+static uint64_t		prof_dump_baseline_seq;
+static size_t		prof_dump_diff_threshold;
+
+/*
+ * Hooks installed via experimental.hooks.prof_*.  The backtrace hook is
+ * never NULL once profiling has been booted; the others are NULL unless set.
+ */
+static atomic_p_t	prof_backtrace_hook;
+static atomic_p_t	prof_dump_hook;
+static atomic_p_t	prof_sample_hook;
+static atomic_p_t	prof_sample_free_hook;
+
+/*
+ * Sampled live objects/bytes per thread.prof.tag value.  Updated only when
+ * sampled objects are allocated or freed, so atomics suffice.
+ */
+struct prof_tag_cnt_s {
+	atomic_zu_t	curobjs;
+	atomic_zu_t	curbytes;
+};
+static struct prof_tag_cnt_s	prof_tag_cnts[
+    /* Minimize memory bloat for non-prof builds. */
+#ifdef JEMALLOC_PROF
+    PROF_NTAGS
+#else
+    1
+#endif
+];
+
 /* Do not dump any profiles until bootstrapping is complete. */
 static bool		prof_booted = false;
 
@@ -208,24 +262,9 @@ rb_gen(static UNUSED, tdata_tree_, prof_tdata_tree_t, prof_tdata_t, tdata_link,
 /******************************************************************************/
 
 void
-prof_alloc_rollback(tsd_t *tsd, prof_tctx_t *tctx, bool updated) {
-	prof_tdata_t *tdata;
-
+prof_alloc_rollback(tsd_t *tsd, prof_tctx_t *tctx) {
 	cassert(config_prof);
 
-	if (updated) {
-		/*
-		 * Compute a new sample threshold.  This isn't very important in
-		 * practice, because this function is rarely executed, so the
-		 * potential for sample bias is minimal except in contrived
-		 * programs.
-		 */
-		tdata = prof_tdata_get(tsd, true);
-		if (tdata != NULL) {
-			prof_sample_threshold_update(tdata);
-		}
-	}
-
 	if ((uintptr_t)tctx > (uintptr_t)1U) {
 		malloc_mutex_lock(tsd_tsdn(tsd), tctx->tdata->lock);
 		tctx->prepared = false;
@@ -251,10 +290,43 @@ prof_malloc_sample_object(tsdn_t *tsdn, const void *ptr, size_t usize,
 	}
 	tctx->prepared = false;
 	malloc_mutex_unlock(tsdn, tctx->tdata->lock);
+
+	struct prof_tag_cnt_s *tag_cnt = &prof_tag_cnts[tctx->key.tag];
+	atomic_fetch_add_zu(&tag_cnt->curobjs, 1, ATOMIC_RELAXED);
+	atomic_fetch_add_zu(&tag_cnt->curbytes, usize, ATOMIC_RELAXED);
+
+	prof_sample_hook_t prof_sample_hook = prof_sample_hook_get();
+	if (prof_sample_hook != NULL) {
+		/*
+		 * The tctx holds a reference to its gctx while curobjs is
+		 * nonzero, so the backtrace remains valid here.
+		 */
+		assert(!tsdn_null(tsdn));
+		tsd_t *tsd = tsdn_tsd(tsdn);
+		prof_bt_t *bt = &tctx->gctx->bt;
+		pre_reentrancy(tsd);
+		prof_sample_hook(ptr, usize, bt->vec, bt->len);
+		post_reentrancy(tsd);
+	}
+}
+
+void
+prof_sample_free_event(tsd_t *tsd, const void *ptr, size_t usize) {
+	prof_sample_free_hook_t prof_sample_free_hook =
+	    prof_sample_free_hook_get();
+	if (prof_sample_free_hook != NULL) {
+		pre_reentrancy(tsd);
+		prof_sample_free_hook(ptr, usize);
+		post_reentrancy(tsd);
+	}
 }
 
 void
 prof_free_sampled_object(tsd_t *tsd, size_t usize, prof_tctx_t *tctx) {
+	struct prof_tag_cnt_s *tag_cnt = &prof_tag_cnts[tctx->key.tag];
+	atomic_fetch_sub_zu(&tag_cnt->curobjs, 1, ATOMIC_RELAXED);
+	atomic_fetch_sub_zu(&tag_cnt->curbytes, usize, ATOMIC_RELAXED);
+
 	malloc_mutex_lock(tsd_tsdn(tsd), tctx->tdata->lock);
 	assert(tctx->cnts.curobjs > 0);
 	assert(tctx->cnts.curbytes >= usize);
@@ -316,19 +388,20 @@ prof_leave(tsd_t *tsd, prof_tdata_t *tdata) {
 }
 
 #ifdef JEMALLOC_PROF_LIBUNWIND
-void
-prof_backtrace(prof_bt_t *bt) {
+static void
+prof_backtrace_impl(void **vec, unsigned *len, unsigned max_len) {
 	int nframes;
 
 	cassert(config_prof);
-	assert(bt->len == 0);
-	assert(bt->vec != NULL);
+	assert(*len == 0);
+	assert(vec != NULL);
+	assert(max_len == PROF_BT_MAX);
 
-	nframes = unw_backtrace(bt->vec, PROF_BT_MAX);
+	nframes = unw_backtrace(vec, PROF_BT_MAX);
 	if (nframes <= 0) {
 		return;
 	}
-	bt->len = nframes;
+	*len = nframes;
 }
 #elif (defined(JEMALLOC_PROF_LIBGCC))
 static _Unwind_Reason_Code
@@ -349,28 +422,28 @@ prof_unwind_callback(struct _Unwind_Context *context, void *arg) {
 	if (ip == NULL) {
 		return _URC_END_OF_STACK;
 	}
-	data->bt->vec[data->bt->len] = ip;
-	data->bt->len++;
-	if (data->bt->len == data->max) {
+	data->vec[*data->len] = ip;
+	(*data->len)++;
+	if (*data->len == data->max) {
 		return _URC_END_OF_STACK;
 	}
 
 	return _URC_NO_REASON;
 }
 
-void
-prof_backtrace(prof_bt_t *bt) {
-	prof_unwind_data_t data = {bt, PROF_BT_MAX};
+static void
+prof_backtrace_impl(void **vec, unsigned *len, unsigned max_len) {
+	prof_unwind_data_t data = {vec, len, max_len};
 
 	cassert(config_prof);
 
 	_Unwind_Backtrace(prof_unwind_callback, &data);
 }
 #elif (defined(JEMALLOC_PROF_GCC))
-void
-prof_backtrace(prof_bt_t *bt) {
+static void
+prof_backtrace_impl(void **vec, unsigned *len, unsigned max_len) {
 #define BT_FRAME(i)							\
-	if ((i) < PROF_BT_MAX) {					\
+	if ((i) < max_len) {						\
 		void *p;						\
 		if (__builtin_frame_address(i) == 0) {			\
 			return;						\
@@ -379,13 +452,15 @@ prof_backtrace(prof_bt_t *bt) {
 		if (p == NULL) {					\
 			return;						\
 		}							\
-		bt->vec[(i)] = p;					\
-		bt->len = (i) + 1;					\
+		vec[(i)] = p;						\
+		*len = (i) + 1;						\
 	} else {							\
 		return;							\
 	}
 
 	cassert(config_prof);
+	assert(vec != NULL);
+	assert(max_len == PROF_BT_MAX);
 
 	BT_FRAME(0)
 	BT_FRAME(1)
@@ -530,13 +605,72 @@ prof_backtrace(prof_bt_t *bt) {
 #undef BT_FRAME
 }
 #else
-void
-prof_backtrace(prof_bt_t *bt) {
+static void
+prof_backtrace_impl(void **vec, unsigned *len, unsigned max_len) {
 	cassert(config_prof);
 	not_reached();
 }
 #endif
 
+void
+prof_backtrace(tsd_t *tsd, prof_bt_t *bt) {
+	cassert(config_prof);
+	assert(bt->len == 0);
+
+	prof_backtrace_hook_t prof_backtrace_hook = prof_backtrace_hook_get();
+	assert(prof_backtrace_hook != NULL);
+
+	/* The hook may be user code, which is free to allocate. */
+	pre_reentrancy(tsd);
+	prof_backtrace_hook(bt->vec, &bt->len, PROF_BT_MAX);
+	post_reentrancy(tsd);
+	assert(bt->len <= PROF_BT_MAX);
+}
+
+void
+prof_backtrace_hook_set(prof_backtrace_hook_t hook) {
+	atomic_store_p(&prof_backtrace_hook, hook, ATOMIC_RELEASE);
+}
+
+prof_backtrace_hook_t
+prof_backtrace_hook_get(void) {
+	return (prof_backtrace_hook_t)atomic_load_p(&prof_backtrace_hook,
+	    ATOMIC_ACQUIRE);
+}
+
+void
+prof_dump_hook_set(prof_dump_hook_t hook) {
+	atomic_store_p(&prof_dump_hook, hook, ATOMIC_RELEASE);
+}
+
+prof_dump_hook_t
+prof_dump_hook_get(void) {
+	return (prof_dump_hook_t)atomic_load_p(&prof_dump_hook,
+	    ATOMIC_ACQUIRE);
+}
+
+void
+prof_sample_hook_set(prof_sample_hook_t hook) {
+	atomic_store_p(&prof_sample_hook, hook, ATOMIC_RELEASE);
+}
+
+prof_sample_hook_t
+prof_sample_hook_get(void) {
+	return (prof_sample_hook_t)atomic_load_p(&prof_sample_hook,
+	    ATOMIC_ACQUIRE);
+}
+
+void
+prof_sample_free_hook_set(prof_sample_free_hook_t hook) {
+	atomic_store_p(&prof_sample_free_hook, hook, ATOMIC_RELEASE);
+}
+
+prof_sample_free_hook_t
+prof_sample_free_hook_get(void) {
+	return (prof_sample_free_hook_t)atomic_load_p(&prof_sample_free_hook,
+	    ATOMIC_ACQUIRE);
+}
+
 static malloc_mutex_t *
 prof_gctx_mutex_choose(void) {
 	unsigned ngctxs = atomic_fetch_add_u(&cum_gctxs, 1, ATOMIC_RELAXED);
@@ -568,6 +702,11 @@ prof_gctx_create(tsdn_t *tsdn, prof_bt_t *bt) {
 	 */
 	gctx->nlimbo = 1;
 	tctx_tree_new(&gctx->tctxs);
+	gctx->dumping = false;
+	gctx->dump_ntctxs = 0;
+	gctx->baseline_seq = 0;
+	gctx->baseline_curobjs = 0;
+	gctx->baseline_curbytes = 0;
 	/* Duplicate bt. */
 	memcpy(gctx->vec, bt->vec, bt->len * sizeof(void *));
 	gctx->bt.vec = gctx->vec;
@@ -654,7 +793,7 @@ prof_tctx_destroy(tsd_t *tsd, prof_tctx_t *tctx) {
 	assert(tctx->cnts.accumobjs == 0);
 	assert(tctx->cnts.accumbytes == 0);
 
-	ckh_remove(tsd, &tdata->bt2tctx, &gctx->bt, NULL, NULL);
+	ckh_remove(tsd, &tdata->bt2tctx, &tctx->key, NULL, NULL);
 	destroy_tdata = prof_tdata_should_destroy(tsd_tsdn(tsd), tdata, false);
 	malloc_mutex_unlock(tsd_tsdn(tsd), tdata->lock);
 
@@ -788,6 +927,7 @@ prof_lookup(tsd_t *tsd, prof_bt_t *bt) {
 		void		*v;
 	} ret;
 	prof_tdata_t *tdata;
+	prof_tctx_key_t key;
 	bool not_found;
 
 	cassert(config_prof);
@@ -797,8 +937,10 @@ prof_lookup(tsd_t *tsd, prof_bt_t *bt) {
 		return NULL;
 	}
 
+	key.bt = bt;
+	key.tag = tdata->tag;
 	malloc_mutex_lock(tsd_tsdn(tsd), tdata->lock);
-	not_found = ckh_search(&tdata->bt2tctx, bt, NULL, &ret.v);
+	not_found = ckh_search(&tdata->bt2tctx, &key, NULL, &ret.v);
 	if (!not_found) { /* Note double negative! */
 		ret.p->prepared = true;
 	}
@@ -832,11 +974,13 @@ prof_lookup(tsd_t *tsd, prof_bt_t *bt) {
 		ret.p->thr_discrim = tdata->thr_discrim;
 		memset(&ret.p->cnts, 0, sizeof(prof_cnt_t));
 		ret.p->gctx = gctx;
+		ret.p->key.bt = (prof_bt_t *)btkey;
+		ret.p->key.tag = key.tag;
 		ret.p->tctx_uid = tdata->tctx_uid_next++;
 		ret.p->prepared = true;
 		ret.p->state = prof_tctx_state_initializing;
 		malloc_mutex_lock(tsd_tsdn(tsd), tdata->lock);
-		error = ckh_insert(tsd, &tdata->bt2tctx, btkey, ret.v);
+		error = ckh_insert(tsd, &tdata->bt2tctx, &ret.p->key, ret.v);
 		malloc_mutex_unlock(tsd_tsdn(tsd), tdata->lock);
 		if (error) {
 			if (new_gctx) {
@@ -868,30 +1012,25 @@ prof_lookup(tsd_t *tsd, prof_bt_t *bt) {
  * (e.g.
  * -mno-sse) in order for the workaround to be complete.
  */
-void
-prof_sample_threshold_update(prof_tdata_t *tdata) {
+uint64_t
+prof_sample_new_event_wait(tsd_t *tsd) {
 #ifdef JEMALLOC_PROF
 	uint64_t r;
 	double u;
 
-	if (!config_prof) {
-		return;
-	}
-
 	if (lg_prof_sample == 0) {
-		tdata->bytes_until_sample = 0;
-		return;
+		return 0;
 	}
 
 	/*
 	 * Compute sample interval as a geometrically distributed random
 	 * variable with mean (2^lg_prof_sample).
 	 *
-	 *                             __        __
-	 *                             |  log(u)  |                     1
-	 * tdata->bytes_until_sample = | -------- |, where p = ---------------
-	 *                             | log(1-p) |             lg_prof_sample
-	 *                                                     2
+	 *        __        __
+	 *        |  log(u)  |                     1
+	 * wait = | -------- |, where p = ---------------
+	 *        | log(1-p) |             lg_prof_sample
+	 *                                2
 	 *
 	 * For more information on the math, see:
 	 *
@@ -901,11 +1040,14 @@ prof_sample_threshold_update(prof_tdata_t *tdata) {
 	 *   pp 500
 	 *   (http://luc.devroye.org/rnbookindex.html)
 	 */
-	r = prng_lg_range_u64(&tdata->prng_state, 53);
+	r = prng_lg_range_u64(tsd_prng_statep_get(tsd), 53);
 	u = (double)r * (1.0/9007199254740992.0L);
-	tdata->bytes_until_sample = (uint64_t)(log(u) /
+	return (uint64_t)(log(u) /
 	    log(1.0 - (1.0 / (double)((uint64_t)1U << lg_prof_sample))))
 	    + (uint64_t)1U;
+#else
+	not_reached();
+	return THREAD_EVENT_MAX_START_WAIT;
 #endif
 }
 
@@ -988,6 +1130,8 @@ prof_dump_flush(bool propagate_err) {
 			}
 		}
 		ret = true;
+	} else {
+		prof_dump_nwritten += (uint64_t)err;
 	}
 	prof_dump_buf_end = 0;
 
@@ -1063,6 +1207,11 @@ prof_tctx_merge_tdata(tsdn_t *tsdn, prof_tctx_t *tctx, prof_tdata_t *tdata) {
 		malloc_mutex_unlock(tsdn, tctx->gctx->lock);
 		return;
 	case prof_tctx_state_nominal:
+		if (!tctx->gctx->dumping) {
+			/* gctx was created after dumping started; ignore. */
+			malloc_mutex_unlock(tsdn, tctx->gctx->lock);
+			return;
+		}
 		tctx->state = prof_tctx_state_dumping;
 		malloc_mutex_unlock(tsdn, tctx->gctx->lock);
 
@@ -1108,6 +1257,7 @@ prof_tctx_merge_iter(prof_tctx_tree_t *tctxs, prof_tctx_t *tctx, void *arg) {
 	case prof_tctx_state_dumping:
 	case prof_tctx_state_purgatory:
 		prof_tctx_merge_gctx(tsdn, tctx, tctx->gctx);
+		tctx->gctx->dump_ntctxs++;
 		break;
 	default:
 		not_reached();
@@ -1116,17 +1266,10 @@ prof_tctx_merge_iter(prof_tctx_tree_t *tctxs, prof_tctx_t *tctx, void *arg) {
 	return NULL;
 }
 
-struct prof_tctx_dump_iter_arg_s {
-	tsdn_t	*tsdn;
-	bool	propagate_err;
-};
-
 static prof_tctx_t *
-prof_tctx_dump_iter(prof_tctx_tree_t *tctxs, prof_tctx_t *tctx, void *opaque) {
-	struct prof_tctx_dump_iter_arg_s *arg =
-	    (struct prof_tctx_dump_iter_arg_s *)opaque;
-
-	malloc_mutex_assert_owner(arg->tsdn, tctx->gctx->lock);
+prof_tctx_snapshot_iter(prof_tctx_tree_t *tctxs, prof_tctx_t *tctx,
+    void *arg) {
+	size_t *tctx_ind = (size_t *)arg;
 
 	switch (tctx->state) {
 	case prof_tctx_state_initializing:
@@ -1135,13 +1278,12 @@ prof_tctx_dump_iter(prof_tctx_tree_t *tctxs, prof_tctx_t *tctx, void *opaque) {
 		break;
 	case prof_tctx_state_dumping:
 	case prof_tctx_state_purgatory:
-		if (prof_dump_printf(arg->propagate_err,
-		    "  t%"FMTu64": %"FMTu64": %"FMTu64" [%"FMTu64": "
-		    "%"FMTu64"]\n", tctx->thr_uid, tctx->dump_cnts.curobjs,
-		    tctx->dump_cnts.curbytes, tctx->dump_cnts.accumobjs,
-		    tctx->dump_cnts.accumbytes)) {
-			return tctx;
-		}
+		/*
+		 * Only the dumping thread can move tctx out of these states or
+		 * destroy it, so it remains valid until prof_gctx_finish().
+		 */
+		prof_dump_tctxs[*tctx_ind] = tctx;
+		(*tctx_ind)++;
 		break;
 	default:
 		not_reached();
@@ -1189,6 +1331,8 @@ prof_dump_gctx_prep(tsdn_t *tsdn, prof_gctx_t *gctx, prof_gctx_tree_t *gctxs) {
 	gctx->nlimbo++;
 	gctx_tree_insert(gctxs, gctx);
 
+	gctx->dumping = true;
+	gctx->dump_ntctxs = 0;
 	memset(&gctx->cnt_summed, 0, sizeof(prof_cnt_t));
 
 	malloc_mutex_unlock(tsdn, gctx->lock);
@@ -1197,6 +1341,8 @@ prof_dump_gctx_prep(tsdn_t *tsdn, prof_gctx_t *gctx, prof_gctx_tree_t *gctxs) {
 struct prof_gctx_merge_iter_arg_s {
 	tsdn_t	*tsdn;
 	size_t	leak_ngctx;
+	/* Total number of tctx's captured by the dump. */
+	size_t	ntctxs;
 };
 
 static prof_gctx_t *
@@ -1210,6 +1356,7 @@ prof_gctx_merge_iter(prof_gctx_tree_t *gctxs, prof_gctx_t *gctx, void *opaque) {
 	if (gctx->cnt_summed.curobjs != 0) {
 		arg->leak_ngctx++;
 	}
+	arg->ntctxs += gctx->dump_ntctxs;
 	malloc_mutex_unlock(arg->tsdn, gctx->lock);
 
 	return NULL;
@@ -1250,6 +1397,7 @@ prof_gctx_finish(tsd_t *tsd, prof_gctx_tree_t *gctxs) {
 				}
 			} while (next != NULL);
 		}
+		gctx->dumping = false;
 		gctx->nlimbo--;
 		if (prof_gctx_should_destroy(gctx)) {
 			gctx->nlimbo++;
@@ -1344,14 +1492,13 @@ prof_dump_header_impl(tsdn_t *tsdn, bool propagate_err,
 prof_dump_header_t *JET_MUTABLE prof_dump_header = prof_dump_header_impl;
 
 static bool
-prof_dump_gctx(tsdn_t *tsdn, bool propagate_err, prof_gctx_t *gctx,
-    const prof_bt_t *bt, prof_gctx_tree_t *gctxs) {
+prof_dump_gctx(bool propagate_err, prof_gctx_t *gctx, const prof_bt_t *bt,
+    size_t tctx_ind) {
 	bool ret;
 	unsigned i;
-	struct prof_tctx_dump_iter_arg_s prof_tctx_dump_iter_arg;
+	size_t j;
 
 	cassert(config_prof);
-	malloc_mutex_assert_owner(tsdn, gctx->lock);
 
 	/* Avoid dumping such gctx's that have no useful data. */
 	if ((!opt_prof_accum && gctx->cnt_summed.curobjs == 0) ||
@@ -1385,12 +1532,26 @@ prof_dump_gctx(tsdn_t *tsdn, bool propagate_err, prof_gctx_t *gctx,
 		goto label_return;
 	}
 
-	prof_tctx_dump_iter_arg.tsdn = tsdn;
-	prof_tctx_dump_iter_arg.propagate_err = propagate_err;
-	if (tctx_tree_iter(&gctx->tctxs, NULL, prof_tctx_dump_iter,
-	    (void *)&prof_tctx_dump_iter_arg) != NULL) {
-		ret = true;
-		goto label_return;
+	for (j = 0; j < gctx->dump_ntctxs; j++) {
+		prof_tctx_t *tctx = prof_dump_tctxs[tctx_ind + j];
+
+		if (prof_dump_printf(propagate_err,
+		    "  t%"FMTu64": %"FMTu64": %"FMTu64" [%"FMTu64": "
+		    "%"FMTu64"]\n", tctx->thr_uid, tctx->dump_cnts.curobjs,
+		    tctx->dump_cnts.curbytes, tctx->dump_cnts.accumobjs,
+		    tctx->dump_cnts.accumbytes)) {
+			ret = true;
+			goto label_return;
+		}
+		/*
+		 * Emitted as a separate line so that tools unaware of tags
+		 * (e.g. jeprof) simply skip it.
+		 */
+		if (tctx->key.tag != 0 && prof_dump_printf(propagate_err,
+		    "    tag: %u\n", tctx->key.tag)) {
+			ret = true;
+			goto label_return;
+		}
 	}
 
 	ret = false;
@@ -1480,7 +1641,7 @@ label_return:
 }
 
 /*
- * See prof_sample_threshold_update() comment for why the body of this function
+ * See prof_sample_new_event_wait() comment for why the body of this function
  * is conditionally compiled.
  */
 static void
@@ -1514,29 +1675,50 @@ prof_leakcheck(const prof_cnt_t *cnt_all, size_t leak_ngctx,
 #endif
 }
 
-struct prof_gctx_dump_iter_arg_s {
+struct prof_gctx_snapshot_iter_arg_s {
 	tsdn_t	*tsdn;
+	/* Next free slot in prof_dump_tctxs. */
+	size_t	tctx_ind;
+};
+
+static prof_gctx_t *
+prof_gctx_snapshot_iter(prof_gctx_tree_t *gctxs, prof_gctx_t *gctx,
+    void *opaque) {
+	struct prof_gctx_snapshot_iter_arg_s *arg =
+	    (struct prof_gctx_snapshot_iter_arg_s *)opaque;
+	size_t tctx_ind_first = arg->tctx_ind;
+
+	malloc_mutex_lock(arg->tsdn, gctx->lock);
+	tctx_tree_iter(&gctx->tctxs, NULL, prof_tctx_snapshot_iter,
+	    (void *)&arg->tctx_ind);
+	assert(arg->tctx_ind - tctx_ind_first == gctx->dump_ntctxs);
+	malloc_mutex_unlock(arg->tsdn, gctx->lock);
+
+	return NULL;
+}
+
+struct prof_gctx_dump_iter_arg_s {
 	bool	propagate_err;
+	/* Index in prof_dump_tctxs of the current gctx's first tctx. */
+	size_t	tctx_ind;
 };
 
 static prof_gctx_t *
 prof_gctx_dump_iter(prof_gctx_tree_t *gctxs, prof_gctx_t *gctx, void *opaque) {
-	prof_gctx_t *ret;
 	struct prof_gctx_dump_iter_arg_s *arg =
 	    (struct prof_gctx_dump_iter_arg_s *)opaque;
 
-	malloc_mutex_lock(arg->tsdn, gctx->lock);
-
-	if (prof_dump_gctx(arg->tsdn, arg->propagate_err, gctx, &gctx->bt,
-	    gctxs)) {
-		ret = gctx;
-		goto label_return;
+	/*
+	 * No locking is necessary, since gctx is in limbo, and only the
+	 * dumping thread modifies its dump-related fields.
+	 */
+	if (prof_dump_gctx(arg->propagate_err, gctx, &gctx->bt,
+	    arg->tctx_ind)) {
+		return gctx;
 	}
+	arg->tctx_ind += gctx->dump_ntctxs;
 
-	ret = NULL;
-label_return:
-	malloc_mutex_unlock(arg->tsdn, gctx->lock);
-	return ret;
+	return NULL;
 }
 
 static void
@@ -1550,16 +1732,18 @@ prof_dump_prep(tsd_t *tsd, prof_tdata_t *tdata,
 		void		*v;
 	} gctx;
 
-	prof_enter(tsd, tdata);
-
 	/*
 	 * Put gctx's in limbo and clear their counters in preparation for
-	 * summing.
+	 * summing.  This is the only phase that requires bt2gctx_mtx; gctx's
+	 * that are created after it are not marked as dumping, and are ignored
+	 * during the remainder of the dump.
 	 */
+	prof_enter(tsd, tdata);
 	gctx_tree_new(gctxs);
 	for (tabind = 0; !ckh_iter(&bt2gctx, &tabind, NULL, &gctx.v);) {
 		prof_dump_gctx_prep(tsd_tsdn(tsd), gctx.p, gctxs);
 	}
+	prof_leave(tsd, tdata);
 
 	/*
 	 * Iterate over tdatas, and for the non-expired ones snapshot their tctx
@@ -1575,10 +1759,35 @@ prof_dump_prep(tsd_t *tsd, prof_tdata_t *tdata,
 	/* Merge tctx stats into gctx's. */
 	prof_gctx_merge_iter_arg->tsdn = tsd_tsdn(tsd);
 	prof_gctx_merge_iter_arg->leak_ngctx = 0;
+	prof_gctx_merge_iter_arg->ntctxs = 0;
 	gctx_tree_iter(gctxs, NULL, prof_gctx_merge_iter,
 	    (void *)prof_gctx_merge_iter_arg);
+}
 
-	prof_leave(tsd, tdata);
+static bool
+prof_dump_snapshot(tsd_t *tsd, prof_gctx_tree_t *gctxs, size_t ntctxs) {
+	struct prof_gctx_snapshot_iter_arg_s prof_gctx_snapshot_iter_arg;
+
+	assert(prof_dump_tctxs == NULL);
+	if (ntctxs == 0) {
+		return false;
+	}
+
+	size_t size = ntctxs * sizeof(prof_tctx_t *);
+	prof_dump_tctxs = (prof_tctx_t **)iallocztm(tsd_tsdn(tsd), size,
+	    sz_size2index(size), false, NULL, true, arena_get(TSDN_NULL, 0,
+	    true), true);
+	if (prof_dump_tctxs == NULL) {
+		return true;
+	}
+
+	prof_gctx_snapshot_iter_arg.tsdn = tsd_tsdn(tsd);
+	prof_gctx_snapshot_iter_arg.tctx_ind = 0;
+	gctx_tree_iter(gctxs, NULL, prof_gctx_snapshot_iter,
+	    (void *)&prof_gctx_snapshot_iter_arg);
+	assert(prof_gctx_snapshot_iter_arg.tctx_ind == ntctxs);
+
+	return false;
 }
 
 static bool
@@ -1600,8 +1809,8 @@ prof_dump_file(tsd_t *tsd, bool propagate_err, const char *filename,
 	}
 
 	/* Dump per gctx profile stats. */
-	prof_gctx_dump_iter_arg->tsdn = tsd_tsdn(tsd);
 	prof_gctx_dump_iter_arg->propagate_err = propagate_err;
+	prof_gctx_dump_iter_arg->tctx_ind = 0;
 	if (gctx_tree_iter(gctxs, NULL, prof_gctx_dump_iter,
 	    (void *)prof_gctx_dump_iter_arg) != NULL) {
 		goto label_write_error;
@@ -1636,18 +1845,56 @@ prof_dump(tsd_t *tsd, bool propagate_err, const char *filename,
 	pre_reentrancy(tsd);
 	malloc_mutex_lock(tsd_tsdn(tsd), &prof_dump_mtx);
 
+	nstime_t start;
+	nstime_init(&start, 0);
+	nstime_update(&start);
+	prof_dump_nwritten = 0;
+
+	/*
+	 * Snapshot counters under short-lived locks, then format and write the
+	 * profile from the snapshot with no prof locks other than prof_dump_mtx
+	 * held.
+	 */
 	prof_gctx_tree_t gctxs;
 	struct prof_tdata_merge_iter_arg_s prof_tdata_merge_iter_arg;
 	struct prof_gctx_merge_iter_arg_s prof_gctx_merge_iter_arg;
 	struct prof_gctx_dump_iter_arg_s prof_gctx_dump_iter_arg;
 	prof_dump_prep(tsd, tdata, &prof_tdata_merge_iter_arg,
 	    &prof_gctx_merge_iter_arg, &gctxs);
-	bool err = prof_dump_file(tsd, propagate_err, filename, leakcheck, tdata,
-	    &prof_tdata_merge_iter_arg, &prof_gctx_merge_iter_arg,
-	    &prof_gctx_dump_iter_arg, &gctxs);
+	bool err = prof_dump_snapshot(tsd, &gctxs,
+	    prof_gctx_merge_iter_arg.ntctxs);
+	if (!err) {
+		err = prof_dump_file(tsd, propagate_err, filename, leakcheck,
+		    tdata, &prof_tdata_merge_iter_arg,
+		    &prof_gctx_merge_iter_arg, &prof_gctx_dump_iter_arg,
+		    &gctxs);
+	}
+	if (prof_dump_tctxs != NULL) {
+		idalloctm(tsd_tsdn(tsd), prof_dump_tctxs, NULL, NULL, true,
+		    true);
+		prof_dump_tctxs = NULL;
+	}
 	prof_gctx_finish(tsd, &gctxs);
 
+	if (!err) {
+		nstime_t end;
+		nstime_init(&end, 0);
+		nstime_update(&end);
+		if (nstime_compare(&end, &start) > 0) {
+			nstime_subtract(&end, &start);
+			prof_dump_last_ns = nstime_ns(&end);
+		} else {
+			prof_dump_last_ns = 0;
+		}
+		prof_dump_last_bytes = prof_dump_nwritten;
+	}
+
 	malloc_mutex_unlock(tsd_tsdn(tsd), &prof_dump_mtx);
+
+	prof_dump_hook_t prof_dump_hook = prof_dump_hook_get();
+	if (!err && prof_dump_hook != NULL) {
+		prof_dump_hook(filename);
+	}
 	post_reentrancy(tsd);
 
 	if (err) {
@@ -1799,6 +2046,30 @@ prof_idump(tsdn_t *tsdn) {
 	}
 }
 
+void
+prof_dump_stats_get(tsdn_t *tsdn, uint64_t *duration_ns, uint64_t *nbytes) {
+	cassert(config_prof);
+
+	if (!opt_prof || !prof_booted) {
+		if (duration_ns != NULL) {
+			*duration_ns = 0;
+		}
+		if (nbytes != NULL) {
+			*nbytes = 0;
+		}
+		return;
+	}
+
+	malloc_mutex_lock(tsdn, &prof_dump_mtx);
+	if (duration_ns != NULL) {
+		*duration_ns = prof_dump_last_ns;
+	}
+	if (nbytes != NULL) {
+		*nbytes = prof_dump_last_bytes;
+	}
+	malloc_mutex_unlock(tsdn, &prof_dump_mtx);
+}
+
 bool
 prof_mdump(tsd_t *tsd, const char *filename) {
 	cassert(config_prof);
@@ -1822,6 +2093,265 @@ prof_mdump(tsd_t *tsd, const char *filename) {
 	return prof_dump(tsd, true, filename, false);
 }
 
+static prof_gctx_t *
+prof_gctx_baseline_iter(prof_gctx_tree_t *gctxs, prof_gctx_t *gctx,
+    void *arg) {
+	gctx->baseline_seq = prof_dump_baseline_seq;
+	gctx->baseline_curobjs = gctx->cnt_summed.curobjs;
+	gctx->baseline_curbytes = gctx->cnt_summed.curbytes;
+
+	return NULL;
+}
+
+bool
+prof_dump_baseline(tsd_t *tsd) {
+	cassert(config_prof);
+	assert(tsd_reentrancy_level_get(tsd) == 0);
+
+	if (!opt_prof || !prof_booted) {
+		return true;
+	}
+	prof_tdata_t *tdata = prof_tdata_get(tsd, true);
+	if (tdata == NULL) {
+		return true;
+	}
+
+	pre_reentrancy(tsd);
+	malloc_mutex_lock(tsd_tsdn(tsd), &prof_dump_mtx);
+
+	prof_gctx_tree_t gctxs;
+	struct prof_tdata_merge_iter_arg_s prof_tdata_merge_iter_arg;
+	struct prof_gctx_merge_iter_arg_s prof_gctx_merge_iter_arg;
+	prof_dump_prep(tsd, tdata, &prof_tdata_merge_iter_arg,
+	    &prof_gctx_merge_iter_arg, &gctxs);
+	/*
+	 * gctx's that are not captured here (including ones created later)
+	 * keep a stale sequence number, and thus an empty baseline.
+	 */
+	prof_dump_baseline_seq++;
+	gctx_tree_iter(&gctxs, NULL, prof_gctx_baseline_iter, NULL);
+	prof_gctx_finish(tsd, &gctxs);
+
+	malloc_mutex_unlock(tsd_tsdn(tsd), &prof_dump_mtx);
+	post_reentrancy(tsd);
+
+	return false;
+}
+
+/*
+ * Computes the growth in live objects/bytes of gctx since the baseline.
+ * Shrinkage is reported as zero growth.
+ */
+static void
+prof_gctx_growth(const prof_gctx_t *gctx, uint64_t *objs, uint64_t *bytes) {
+	uint64_t baseline_curobjs, baseline_curbytes;
+
+	if (gctx->baseline_seq == prof_dump_baseline_seq) {
+		baseline_curobjs = gctx->baseline_curobjs;
+		baseline_curbytes = gctx->baseline_curbytes;
+	} else {
+		baseline_curobjs = 0;
+		baseline_curbytes = 0;
+	}
+	*objs = (gctx->cnt_summed.curobjs > baseline_curobjs) ?
+	    gctx->cnt_summed.curobjs - baseline_curobjs : 0;
+	*bytes = (gctx->cnt_summed.curbytes > baseline_curbytes) ?
+	    gctx->cnt_summed.curbytes - baseline_curbytes : 0;
+}
+
+struct prof_gctx_diff_iter_arg_s {
+	/* Output array, or NULL to only count matching gctx's. */
+	prof_gctx_t	**diff_gctxs;
+	size_t		ndiff_gctxs;
+	/* Total growth of the matching gctx's. */
+	uint64_t	curobjs;
+	uint64_t	curbytes;
+};
+
+static prof_gctx_t *
+prof_gctx_diff_iter(prof_gctx_tree_t *gctxs, prof_gctx_t *gctx, void *opaque) {
+	struct prof_gctx_diff_iter_arg_s *arg =
+	    (struct prof_gctx_diff_iter_arg_s *)opaque;
+	uint64_t objs, bytes;
+
+	prof_gctx_growth(gctx, &objs, &bytes);
+	if (bytes <= prof_dump_diff_threshold) {
+		return NULL;
+	}
+	if (arg->diff_gctxs != NULL) {
+		arg->diff_gctxs[arg->ndiff_gctxs] = gctx;
+	}
+	arg->ndiff_gctxs++;
+	arg->curobjs += objs;
+	arg->curbytes += bytes;
+
+	return NULL;
+}
+
+static int
+prof_gctx_growth_comp(const void *ap, const void *bp) {
+	const prof_gctx_t *a = *(const prof_gctx_t **)ap;
+	const prof_gctx_t *b = *(const prof_gctx_t **)bp;
+	uint64_t a_objs, a_bytes, b_objs, b_bytes;
+
+	prof_gctx_growth(a, &a_objs, &a_bytes);
+	prof_gctx_growth(b, &b_objs, &b_bytes);
+	/* Largest growth first. */
+	return (a_bytes < b_bytes) - (a_bytes > b_bytes);
+}
+
+static bool
+prof_dump_diff_file(bool propagate_err, const char *filename,
+    const struct prof_gctx_diff_iter_arg_s *arg) {
+	size_t i;
+	unsigned j;
+
+	if ((prof_dump_fd = prof_dump_open(propagate_err, filename)) == -1) {
+		return true;
+	}
+
+	/*
+	 * The diff is a regular heap_v2 profile whose counters are growth since
+	 * the baseline, so that it can be fed to jeprof as is.  Per thread
+	 * counters and accumulated counters are meaningless here, and omitted.
+	 */
+	if (prof_dump_printf(propagate_err,
+	    "heap_v2/%"FMTu64"\n"
+	    "  t*: %"FMTu64": %"FMTu64" [0: 0]\n",
+	    ((uint64_t)1U << lg_prof_sample), arg->curobjs, arg->curbytes)) {
+		goto label_write_error;
+	}
+	for (i = 0; i < arg->ndiff_gctxs; i++) {
+		const prof_gctx_t *gctx = arg->diff_gctxs[i];
+		uint64_t objs, bytes;
+
+		prof_gctx_growth(gctx, &objs, &bytes);
+		if (prof_dump_printf(propagate_err, "@")) {
+			goto label_write_error;
+		}
+		for (j = 0; j < gctx->bt.len; j++) {
+			if (prof_dump_printf(propagate_err, " %#"FMTxPTR,
+			    (uintptr_t)gctx->bt.vec[j])) {
+				goto label_write_error;
+			}
+		}
+		if (prof_dump_printf(propagate_err,
+		    "\n"
+		    "  t*: %"FMTu64": %"FMTu64" [0: 0]\n", objs, bytes)) {
+			goto label_write_error;
+		}
+	}
+
+	if (prof_dump_maps(propagate_err)) {
+		goto label_write_error;
+	}
+
+	return prof_dump_close(propagate_err);
+label_write_error:
+	prof_dump_close(propagate_err);
+	return true;
+}
+
+bool
+prof_dump_diff(tsd_t *tsd, const char *filename) {
+	cassert(config_prof);
+	assert(tsd_reentrancy_level_get(tsd) == 0);
+
+	if (!opt_prof || !prof_booted) {
+		return true;
+	}
+	char filename_buf[DUMP_FILENAME_BUFSIZE];
+	if (filename == NULL) {
+		/* No filename specified, so automatically generate one. */
+		if (opt_prof_prefix[0] == '\0') {
+			return true;
+		}
+		malloc_mutex_lock(tsd_tsdn(tsd), &prof_dump_seq_mtx);
+		prof_dump_filename(filename_buf, 'd', prof_dump_dseq);
+		prof_dump_dseq++;
+		malloc_mutex_unlock(tsd_tsdn(tsd), &prof_dump_seq_mtx);
+		filename = filename_buf;
+	}
+	prof_tdata_t *tdata = prof_tdata_get(tsd, true);
+	if (tdata == NULL) {
+		return true;
+	}
+
+	pre_reentrancy(tsd);
+	malloc_mutex_lock(tsd_tsdn(tsd), &prof_dump_mtx);
+
+	prof_gctx_tree_t gctxs;
+	struct prof_tdata_merge_iter_arg_s prof_tdata_merge_iter_arg;
+	struct prof_gctx_merge_iter_arg_s prof_gctx_merge_iter_arg;
+	prof_dump_prep(tsd, tdata, &prof_tdata_merge_iter_arg,
+	    &prof_gctx_merge_iter_arg, &gctxs);
+
+	/*
+	 * Count the gctx's that grew past the threshold, then collect and sort
+	 * them.  Their counters cannot change until prof_gctx_finish().
+	 */
+	struct prof_gctx_diff_iter_arg_s prof_gctx_diff_iter_arg;
+	memset(&prof_gctx_diff_iter_arg, 0, sizeof(prof_gctx_diff_iter_arg));
+	gctx_tree_iter(&gctxs, NULL, prof_gctx_diff_iter,
+	    (void *)&prof_gctx_diff_iter_arg);
+	bool err = false;
+	size_t ndiff_gctxs = prof_gctx_diff_iter_arg.ndiff_gctxs;
+	if (ndiff_gctxs > 0) {
+		size_t size = ndiff_gctxs * sizeof(prof_gctx_t *);
+		prof_gctx_diff_iter_arg.diff_gctxs = (prof_gctx_t **)iallocztm(
+		    tsd_tsdn(tsd), size, sz_size2index(size), false, NULL,
+		    true, arena_get(TSDN_NULL, 0, true), true);
+		if (prof_gctx_diff_iter_arg.diff_gctxs == NULL) {
+			err = true;
+		} else {
+			prof_gctx_diff_iter_arg.ndiff_gctxs = 0;
+			prof_gctx_diff_iter_arg.curobjs = 0;
+			prof_gctx_diff_iter_arg.curbytes = 0;
+			gctx_tree_iter(&gctxs, NULL, prof_gctx_diff_iter,
+			    (void *)&prof_gctx_diff_iter_arg);
+			assert(prof_gctx_diff_iter_arg.ndiff_gctxs ==
+			    ndiff_gctxs);
+			qsort(prof_gctx_diff_iter_arg.diff_gctxs, ndiff_gctxs,
+			    sizeof(prof_gctx_t *), prof_gctx_growth_comp);
+		}
+	}
+	if (!err) {
+		err = prof_dump_diff_file(true, filename,
+		    &prof_gctx_diff_iter_arg);
+	}
+	if (prof_gctx_diff_iter_arg.diff_gctxs != NULL) {
+		idalloctm(tsd_tsdn(tsd), prof_gctx_diff_iter_arg.diff_gctxs,
+		    NULL, NULL, true, true);
+	}
+	prof_gctx_finish(tsd, &gctxs);
+
+	malloc_mutex_unlock(tsd_tsdn(tsd), &prof_dump_mtx);
+	post_reentrancy(tsd);
+
+	return err;
+}
+
+size_t
+prof_dump_diff_threshold_get(tsdn_t *tsdn) {
+	size_t threshold;
+
+	malloc_mutex_lock(tsdn, &prof_dump_mtx);
+	threshold = prof_dump_diff_threshold;
+	malloc_mutex_unlock(tsdn, &prof_dump_mtx);
+	return threshold;
+}
+
+size_t
+prof_dump_diff_threshold_set(tsdn_t *tsdn, size_t threshold) {
+	size_t old_threshold;
+
+	malloc_mutex_lock(tsdn, &prof_dump_mtx);
+	old_threshold = prof_dump_diff_threshold;
+	prof_dump_diff_threshold = threshold;
+	malloc_mutex_unlock(tsdn, &prof_dump_mtx);
+	return old_threshold;
+}
+
 void
 prof_gdump(tsdn_t *tsdn) {
 	tsd_t *tsd;
@@ -1878,6 +2408,29 @@ prof_bt_keycomp(const void *k1, const void *k2) {
 	return (memcmp(bt1->vec, bt2->vec, bt1->len * sizeof(void *)) == 0);
 }
 
+static void
+prof_tctx_key_hash(const void *key, size_t r_hash[2]) {
+	const prof_tctx_key_t *tctx_key = (const prof_tctx_key_t *)key;
+
+	cassert(config_prof);
+
+	hash(tctx_key->bt->vec, tctx_key->bt->len * sizeof(void *),
+	    0x94122f33U ^ (uint32_t)tctx_key->tag, r_hash);
+}
+
+static bool
+prof_tctx_key_keycomp(const void *k1, const void *k2) {
+	const prof_tctx_key_t *tctx_key1 = (const prof_tctx_key_t *)k1;
+	const prof_tctx_key_t *tctx_key2 = (const prof_tctx_key_t *)k2;
+
+	cassert(config_prof);
+
+	if (tctx_key1->tag != tctx_key2->tag) {
+		return false;
+	}
+	return prof_bt_keycomp(tctx_key1->bt, tctx_key2->bt);
+}
+
 static uint64_t
 prof_thr_uid_alloc(tsdn_t *tsdn) {
 	uint64_t thr_uid;
@@ -1892,7 +2445,7 @@ prof_thr_uid_alloc(tsdn_t *tsdn) {
 
 static prof_tdata_t *
 prof_tdata_init_impl(tsd_t *tsd, uint64_t thr_uid, uint64_t thr_discrim,
-    char *thread_name, bool active) {
+    char *thread_name, unsigned tag, bool active) {
 	prof_tdata_t *tdata;
 
 	cassert(config_prof);
@@ -1909,19 +2462,17 @@ prof_tdata_init_impl(tsd_t *tsd, uint64_t thr_uid, uint64_t thr_discrim,
 	tdata->thr_uid = thr_uid;
 	tdata->thr_discrim = thr_discrim;
 	tdata->thread_name = thread_name;
+	tdata->tag = tag;
 	tdata->attached = true;
 	tdata->expired = false;
 	tdata->tctx_uid_next = 0;
 
-	if (ckh_new(tsd, &tdata->bt2tctx, PROF_CKH_MINITEMS, prof_bt_hash,
-	    prof_bt_keycomp)) {
+	if (ckh_new(tsd, &tdata->bt2tctx, PROF_CKH_MINITEMS, prof_tctx_key_hash,
+	    prof_tctx_key_keycomp)) {
 		idalloctm(tsd_tsdn(tsd), tdata, NULL, NULL, true, true);
 		return NULL;
 	}
 
-	tdata->prng_state = (uint64_t)(uintptr_t)tdata;
-	prof_sample_threshold_update(tdata);
-
 	tdata->enq = false;
 	tdata->enq_idump = false;
 	tdata->enq_gdump = false;
@@ -1939,7 +2490,7 @@ prof_tdata_init_impl(tsd_t *tsd, uint64_t thr_uid, uint64_t thr_discrim,
 prof_tdata_t *
 prof_tdata_init(tsd_t *tsd) {
 	return prof_tdata_init_impl(tsd, prof_thr_uid_alloc(tsd_tsdn(tsd)), 0,
-	    NULL, prof_thread_active_init_get(tsd_tsdn(tsd)));
+	    NULL, 0, prof_thread_active_init_get(tsd_tsdn(tsd)));
 }
 
 static bool
@@ -2016,11 +2567,12 @@ prof_tdata_reinit(tsd_t *tsd, prof_tdata_t *tdata) {
 	uint64_t thr_discrim = tdata->thr_discrim + 1;
 	char *thread_name = (tdata->thread_name != NULL) ?
 	    prof_thread_name_alloc(tsd_tsdn(tsd), tdata->thread_name) : NULL;
+	unsigned tag = tdata->tag;
 	bool active = tdata->active;
 
 	prof_tdata_detach(tsd, tdata);
 	return prof_tdata_init_impl(tsd, thr_uid, thr_discrim, thread_name,
-	    active);
+	    tag, active);
 }
 
 static bool
@@ -2058,6 +2610,8 @@ prof_reset(tsd_t *tsd, size_t lg_sample) {
 	malloc_mutex_lock(tsd_tsdn(tsd), &tdatas_mtx);
 
 	lg_prof_sample = lg_sample;
+	/* Counters from before the reset are not comparable to later ones. */
+	prof_dump_baseline_seq++;
 
 	next = NULL;
 	do {
@@ -2073,6 +2627,12 @@ prof_reset(tsd_t *tsd, size_t lg_sample) {
 
 	malloc_mutex_unlock(tsd_tsdn(tsd), &tdatas_mtx);
 	malloc_mutex_unlock(tsd_tsdn(tsd), &prof_dump_mtx);
+
+	/*
+	 * Other threads pick up the new sample rate as of their next sample
+	 * event.
+	 */
+	thread_prof_sample_event_reset(tsd);
 }
 
 void
@@ -2205,6 +2765,45 @@ prof_thread_active_set(tsd_t *tsd, bool active) {
 	return false;
 }
 
+unsigned
+prof_thread_tag_get(tsd_t *tsd) {
+	prof_tdata_t *tdata;
+
+	tdata = prof_tdata_get(tsd, true);
+	if (tdata == NULL) {
+		return 0;
+	}
+	return tdata->tag;
+}
+
+bool
+prof_thread_tag_set(tsd_t *tsd, unsigned tag) {
+	prof_tdata_t *tdata;
+
+	assert(tag < PROF_NTAGS);
+
+	tdata = prof_tdata_get(tsd, true);
+	if (tdata == NULL) {
+		return true;
+	}
+	tdata->tag = tag;
+	return false;
+}
+
+void
+prof_tag_stats_get(unsigned tag, size_t *curobjs, size_t *curbytes) {
+	assert(tag < PROF_NTAGS);
+
+	if (curobjs != NULL) {
+		*curobjs = atomic_load_zu(&prof_tag_cnts[tag].curobjs,
+		    ATOMIC_RELAXED);
+	}
+	if (curbytes != NULL) {
+		*curbytes = atomic_load_zu(&prof_tag_cnts[tag].curbytes,
+		    ATOMIC_RELAXED);
+	}
+}
+
 bool
 prof_thread_active_init_get(tsdn_t *tsdn) {
 	bool active_init;
@@ -2253,6 +2852,7 @@ prof_boot0(void) {
 
 	memcpy(opt_prof_prefix, PROF_PREFIX_DEFAULT,
 	    sizeof(PROF_PREFIX_DEFAULT));
+	prof_backtrace_hook_set(&prof_backtrace_impl);
 }
 
 void
@@ -5,6 +5,25 @@
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/mutex.h"
 
+bool opt_rtree_flat = config_rtree_flat;
+
+#ifdef JEMALLOC_RTREE_FLAT
+static void
+rtree_flat_init(rtree_t *rtree) {
+	/*
+	 * Only reserve address space.  Unless the OS overcommits, committing
+	 * the whole array would be charged in full, so fall back to the tree.
+	 */
+	bool commit = false;
+	void *flat = pages_map(NULL, RTREE_FLAT_SIZE, PAGE, &commit);
+	if (flat != NULL && !commit) {
+		pages_unmap(flat, RTREE_FLAT_SIZE);
+		flat = NULL;
+	}
+	rtree->flat = (rtree_leaf_elm_t *)flat;
+}
+#endif
+
 /*
  * Only the most significant bits of keys passed to rtree_{read,write}() are
  * used.
@@ -23,6 +42,11 @@ rtree_new(rtree_t *rtree, bool zeroed) {
 	    malloc_mutex_rank_exclusive)) {
 		return true;
 	}
+#ifdef JEMALLOC_RTREE_FLAT
+	if (opt_rtree_flat) {
+		rtree_flat_init(rtree);
+	}
+#endif
 
 	return false;
 }
@@ -92,6 +116,11 @@ rtree_delete_subtree(tsdn_t *tsdn, rtree_t *rtree, rtree_node_elm_t *subtree,
 
 void
 rtree_delete(tsdn_t *tsdn, rtree_t *rtree) {
+#  ifdef JEMALLOC_RTREE_FLAT
+	if (rtree->flat != NULL) {
+		pages_unmap(rtree->flat, RTREE_FLAT_SIZE);
+	}
+#  endif
 #  if RTREE_HEIGHT > 1
 	rtree_delete_subtree(tsdn, rtree, rtree->root, 0);
 #  endif
@@ -263,8 +292,8 @@ rtree_leaf_elm_lookup_hard(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
 	}
 	/*
 	 * Cache replacement upon hard lookup (i.e. L1 & L2 rtree cache miss):
-	 * (1) evict last entry in L2 cache; (2) move the collision slot from L1
-	 * cache down to L2; and 3) fill L1.
+	 * (1) evict last entry in L2 cache; (2) move the LRU way of the L1 set
+	 * down to L2; and 3) fill L1.
 	 */
 #define RTREE_GET_LEAF(level) {						\
 		assert(level == RTREE_HEIGHT-1);			\
@@ -278,13 +307,8 @@ rtree_leaf_elm_lookup_hard(tsdn_t *tsdn, rtree_t *rtree, rtree_ctx_t *rtree_ctx,
 			    (RTREE_CTX_NCACHE_L2 - 1));			\
 		}							\
 		size_t slot = rtree_cache_direct_map(key);		\
-		rtree_ctx->l2_cache[0].leafkey =			\
-		    rtree_ctx->cache[slot].leafkey;			\
-		rtree_ctx->l2_cache[0].leaf =				\
-		    rtree_ctx->cache[slot].leaf;			\
-		uintptr_t leafkey = rtree_leafkey(key);			\
-		rtree_ctx->cache[slot].leafkey = leafkey;		\
-		rtree_ctx->cache[slot].leaf = leaf;			\
+		rtree_ctx->l2_cache[0] = rtree_cache_l1_insert(rtree_ctx, \
+		    slot, rtree_leafkey(key), leaf);			\
 		uintptr_t subkey = rtree_subkey(key, level);		\
 		return &leaf[subkey];					\
 	}
@@ -317,4 +341,7 @@ rtree_ctx_data_init(rtree_ctx_t *ctx) {
 		cache->leafkey = RTREE_LEAFKEY_INVALID;
 		cache->leaf = NULL;
 	}
+	ctx->stats.l1_hits = 0;
+	ctx->stats.l2_hits = 0;
+	ctx->stats.misses = 0;
 }
@@ -400,16 +400,16 @@ stats_arena_print(void (*write_cb)(void *, const char *), void *cbopaque,
 	unsigned nthreads;
 	const char *dss;
 	ssize_t dirty_decay_ms, muzzy_decay_ms;
-	size_t page, pactive, pdirty, pmuzzy, mapped, retained;
+	size_t page, pactive, pdirty, pmuzzy, mapped, retained, retained_fresh;
 	size_t base, internal, resident;
 	uint64_t dirty_npurge, dirty_nmadvise, dirty_purged;
-	uint64_t muzzy_npurge, muzzy_nmadvise, muzzy_purged;
+	uint64_t muzzy_npurge, muzzy_nmadvise, muzzy_purged, npurge_inline;
 	size_t small_allocated;
 	uint64_t small_nmalloc, small_ndalloc, small_nrequests;
 	size_t large_allocated;
 	uint64_t large_nmalloc, large_ndalloc, large_nrequests;
 	size_t tcache_bytes;
-	uint64_t uptime;
+	uint64_t prefaulted, thp_collapsed, uptime;
 
 	CTL_GET("arenas.page", &page, size_t);
 
@@ -455,6 +455,8 @@ stats_arena_print(void (*write_cb)(void *, const char *), void *cbopaque,
 	CTL_M2_GET("stats.arenas.0.muzzy_nmadvise", i, &muzzy_nmadvise,
 	    uint64_t);
 	CTL_M2_GET("stats.arenas.0.muzzy_purged", i, &muzzy_purged, uint64_t);
+	CTL_M2_GET("stats.arenas.0.npurge_inline", i, &npurge_inline,
+	    uint64_t);
 	if (json) {
 		malloc_cprintf(write_cb, cbopaque,
 		    "\t\t\t\t\"dirty_decay_ms\": %zd,\n", dirty_decay_ms);
@@ -478,6 +480,8 @@ stats_arena_print(void (*write_cb)(void *, const char *), void *cbopaque,
 		    "\t\t\t\t\"muzzy_nmadvise\": %"FMTu64",\n", muzzy_nmadvise);
 		malloc_cprintf(write_cb, cbopaque,
 		    "\t\t\t\t\"muzzy_purged\": %"FMTu64",\n", muzzy_purged);
+		malloc_cprintf(write_cb, cbopaque,
+		    "\t\t\t\t\"npurge_inline\": %"FMTu64",\n", npurge_inline);
 	} else {
 		malloc_cprintf(write_cb, cbopaque,
 		    "decaying:  time       npages       sweeps     madvises"
@@ -504,6 +508,8 @@ stats_arena_print(void (*write_cb)(void *, const char *), void *cbopaque,
 			    FMTu64"\n", pmuzzy, muzzy_npurge, muzzy_nmadvise,
 			    muzzy_purged);
 		}
+		malloc_cprintf(write_cb, cbopaque,
+		    "inline sweeps: %"FMTu64"\n", npurge_inline);
 	}
 
 	CTL_M2_GET("stats.arenas.0.small.allocated", i, &small_allocated,
@@ -595,6 +601,35 @@ stats_arena_print(void (*write_cb)(void *, const char *), void *cbopaque,
 		    "retained:                %12zu\n", retained);
 	}
 
+	CTL_M2_GET("stats.arenas.0.retained_fresh", i, &retained_fresh,
+	    size_t);
+	if (json) {
+		malloc_cprintf(write_cb, cbopaque,
+		    "\t\t\t\t\"retained_fresh\": %zu,\n", retained_fresh);
+	} else {
+		malloc_cprintf(write_cb, cbopaque,
+		    "retained_fresh:          %12zu\n", retained_fresh);
+	}
+
+	CTL_M2_GET("stats.arenas.0.prefaulted", i, &prefaulted, uint64_t);
+	if (json) {
+		malloc_cprintf(write_cb, cbopaque,
+		    "\t\t\t\t\"prefaulted\": %"FMTu64",\n", prefaulted);
+	} else {
+		malloc_cprintf(write_cb, cbopaque,
+		    "prefaulted:              %12"FMTu64"\n", prefaulted);
+	}
+
+	CTL_M2_GET("stats.arenas.0.thp_collapsed", i, &thp_collapsed,
+	    uint64_t);
+	if (json) {
+		malloc_cprintf(write_cb, cbopaque,
+		    "\t\t\t\t\"thp_collapsed\": %"FMTu64",\n", thp_collapsed);
+	} else {
+		malloc_cprintf(write_cb, cbopaque,
+		    "thp_collapsed:           %12"FMTu64"\n", thp_collapsed);
+	}
+
 	CTL_M2_GET("stats.arenas.0.base", i, &base, size_t);
 	if (json) {
 		malloc_cprintf(write_cb, cbopaque,
@@ -758,6 +793,16 @@ stats_general_print(void (*write_cb)(void *, const char *), void *cbopaque,
 			"  opt."#n": %u\n", uv);			\
 		}							\
 	}
+#define OPT_WRITE_SIZE_T(n, c)						\
+	if (je_mallctl("opt."#n, (void *)&sv, &ssz, NULL, 0) == 0) {	\
+		if (json) {						\
+			malloc_cprintf(write_cb, cbopaque,		\
+			    "\t\t\t\""#n"\": %zu%s\n", sv, (c));	\
+		} else {						\
+			malloc_cprintf(write_cb, cbopaque,		\
+			    "  opt."#n": %zu\n", sv);			\
+		}							\
+	}
 #define OPT_WRITE_SSIZE_T(n, c)						\
 	if (je_mallctl("opt."#n, (void *)&ssv, &sssz, NULL, 0) == 0) {	\
 		if (json) {						\
@@ -803,16 +848,23 @@ stats_general_print(void (*write_cb)(void *, const char *), void *cbopaque,
 	OPT_WRITE_BOOL(abort, ",")
 	OPT_WRITE_BOOL(abort_conf, ",")
 	OPT_WRITE_BOOL(retain, ",")
+	OPT_WRITE_SIZE_T(retain_grow_limit, ",")
 	OPT_WRITE_CHAR_P(dss, ",")
+	OPT_WRITE_CHAR_P(extent_fit, ",")
+	OPT_WRITE_SIZE_T(zero_purge_threshold, ",")
+	OPT_WRITE_CHAR_P(thp_policy, ",")
 	OPT_WRITE_UNSIGNED(narenas, ",")
 	OPT_WRITE_CHAR_P(percpu_arena, ",")
+	OPT_WRITE_CHAR_P(prefault, ",")
 	OPT_WRITE_BOOL_MUTABLE(background_thread, background_thread, ",")
+	OPT_WRITE_BOOL(background_purge_only, ",")
 	OPT_WRITE_SSIZE_T_MUTABLE(dirty_decay_ms, arenas.dirty_decay_ms, ",")
 	OPT_WRITE_SSIZE_T_MUTABLE(muzzy_decay_ms, arenas.muzzy_decay_ms, ",")
 	OPT_WRITE_CHAR_P(junk, ",")
 	OPT_WRITE_BOOL(zero, ",")
 	OPT_WRITE_BOOL(utrace, ",")
 	OPT_WRITE_BOOL(xmalloc, ",")
+	OPT_WRITE_BOOL(sized_dealloc_check, ",")
 	OPT_WRITE_BOOL(tcache, ",")
 	OPT_WRITE_SSIZE_T(lg_tcache_max, ",")
 	OPT_WRITE_BOOL(prof, ",")
@@ -843,6 +895,7 @@ stats_general_print(void (*write_cb)(void *, const char *), void *cbopaque,
 
 #undef OPT_WRITE_BOOL
 #undef OPT_WRITE_BOOL_MUTABLE
+#undef OPT_WRITE_SIZE_T
 #undef OPT_WRITE_SSIZE_T
 #undef OPT_WRITE_CHAR_P
 
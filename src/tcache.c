@@ -4,6 +4,7 @@
 
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/rtree.h"
 #include "jemalloc/internal/size_classes.h"
 
 /******************************************************************************/
@@ -11,6 +12,12 @@
 
 bool	opt_tcache = true;
 ssize_t	opt_lg_tcache_max = LG_TCACHE_MAXCLASS_DEFAULT;
+/*
+ * Number of bytes allocated (and, separately, deallocated) between incremental
+ * GCs, driven by the thread event framework (or, for explicit tcaches, by the
+ * bytes allocated and deallocated through them); 0 disables GC.
+ */
+size_t	opt_tcache_gc_incr_bytes = TCACHE_GC_INCR_BYTES_DEFAULT;
 
 tcache_bin_info_t	*tcache_bin_info;
 static unsigned		stack_nelms; /* Total stack elms per tcache. */
@@ -84,6 +91,20 @@ tcache_event_hard(tsd_t *tsd, tcache_t *tcache) {
 	}
 }
 
+static uint64_t
+tcache_gc_event_new_wait(void) {
+	return (opt_tcache_gc_incr_bytes > 0) ?
+	    (uint64_t)opt_tcache_gc_incr_bytes : UINT64_MAX;
+}
+
+void
+tcache_explicit_event_hard(tsd_t *tsd, tcache_t *tcache) {
+	tcache->gc_event_wait = tcache_gc_event_new_wait();
+	if (opt_tcache_gc_incr_bytes > 0) {
+		tcache_event_hard(tsd, tcache);
+	}
+}
+
 void *
 tcache_alloc_small_hard(tsdn_t *tsdn, arena_t *arena, tcache_t *tcache,
     tcache_bin_t *tbin, szind_t binind, bool *tcache_success) {
@@ -104,6 +125,7 @@ void
 tcache_bin_flush_small(tsd_t *tsd, tcache_t *tcache, tcache_bin_t *tbin,
     szind_t binind, unsigned rem) {
 	bool merged_stats = false;
+	tcache_bin_stats_t *tstats = tcache_bin_stats_get(tcache, binind);
 
 	assert(binind < NBINS);
 	assert(rem <= tbin->ncached);
@@ -112,9 +134,22 @@ tcache_bin_flush_small(tsd_t *tsd, tcache_t *tcache, tcache_bin_t *tbin,
 	assert(arena != NULL);
 	unsigned nflush = tbin->ncached - rem;
 	VARIABLE_ARRAY(extent_t *, item_extent, nflush);
-	/* Look up extent once per item. */
+	VARIABLE_ARRAY(rtree_leaf_elm_t *, item_elm, nflush);
+	/*
+	 * Look up extent once per item.  The rtree leaf elements are located
+	 * and prefetched in a first pass, so that the cache misses on them
+	 * overlap rather than each stalling the corresponding extent read.
+	 */
+	rtree_ctx_t *rtree_ctx = tsd_rtree_ctx(tsd);
 	for (unsigned i = 0 ; i < nflush; i++) {
-		item_extent[i] = iealloc(tsd_tsdn(tsd), *(tbin->avail - 1 - i));
+		item_elm[i] = rtree_leaf_elm_lookup(tsd_tsdn(tsd),
+		    &extents_rtree, rtree_ctx, (uintptr_t)*(tbin->avail - 1 - i),
+		    true, false);
+		util_prefetch_read(item_elm[i]);
+	}
+	for (unsigned i = 0 ; i < nflush; i++) {
+		item_extent[i] = rtree_leaf_elm_extent_read(tsd_tsdn(tsd),
+		    &extents_rtree, item_elm[i], true);
 	}
 
 	while (nflush > 0) {
@@ -136,8 +171,8 @@ tcache_bin_flush_small(tsd_t *tsd, tcache_t *tcache, tcache_bin_t *tbin,
 			assert(!merged_stats);
 			merged_stats = true;
 			bin->stats.nflushes++;
-			bin->stats.nrequests += tbin->tstats.nrequests;
-			tbin->tstats.nrequests = 0;
+			bin->stats.nrequests += tstats->nrequests;
+			tstats->nrequests = 0;
 		}
 		unsigned ndeferred = 0;
 		for (unsigned i = 0; i < nflush; i++) {
@@ -172,13 +207,16 @@ tcache_bin_flush_small(tsd_t *tsd, tcache_t *tcache, tcache_bin_t *tbin,
 		arena_bin_t *bin = &arena->bins[binind];
 		malloc_mutex_lock(tsd_tsdn(tsd), &bin->lock);
 		bin->stats.nflushes++;
-		bin->stats.nrequests += tbin->tstats.nrequests;
-		tbin->tstats.nrequests = 0;
+		bin->stats.nrequests += tstats->nrequests;
+		tstats->nrequests = 0;
 		malloc_mutex_unlock(tsd_tsdn(tsd), &bin->lock);
 	}
 
 	memmove(tbin->avail - rem, tbin->avail - tbin->ncached, rem *
 	    sizeof(void *));
+	/* The flushed objects were at the bottom of the stack. */
+	tbin->nzeroed = (tbin->nzeroed > tbin->ncached - rem) ?
+	    tbin->nzeroed - (tbin->ncached - rem) : 0;
 	tbin->ncached = rem;
 	if ((low_water_t)tbin->ncached < tbin->low_water) {
 		tbin->low_water = tbin->ncached;
@@ -189,6 +227,7 @@ void
 tcache_bin_flush_large(tsd_t *tsd, tcache_bin_t *tbin, szind_t binind,
     unsigned rem, tcache_t *tcache) {
 	bool merged_stats = false;
+	tcache_bin_stats_t *tstats = tcache_bin_stats_get(tcache, binind);
 
 	assert(binind < nhbins);
 	assert(rem <= tbin->ncached);
@@ -232,8 +271,8 @@ tcache_bin_flush_large(tsd_t *tsd, tcache_bin_t *tbin, szind_t binind,
 				merged_stats = true;
 				arena_stats_large_nrequests_add(tsd_tsdn(tsd),
 				    &arena->stats, binind,
-				    tbin->tstats.nrequests);
-				tbin->tstats.nrequests = 0;
+				    tstats->nrequests);
+				tstats->nrequests = 0;
 			}
 		}
 		malloc_mutex_unlock(tsd_tsdn(tsd), &locked_arena->large_mtx);
@@ -271,8 +310,8 @@ tcache_bin_flush_large(tsd_t *tsd, tcache_bin_t *tbin, szind_t binind,
 		 * arena, so the stats didn't get merged.  Manually do so now.
 		 */
 		arena_stats_large_nrequests_add(tsd_tsdn(tsd), &arena->stats,
-		    binind, tbin->tstats.nrequests);
-		tbin->tstats.nrequests = 0;
+		    binind, tstats->nrequests);
+		tstats->nrequests = 0;
 	}
 
 	memmove(tbin->avail - rem, tbin->avail - tbin->ncached, rem *
@@ -319,6 +358,8 @@ tcache_arena_dissociate(tsdn_t *tsdn, tcache_t *tcache) {
 		tcache_stats_merge(tsdn, tcache, arena);
 		malloc_mutex_unlock(tsdn, &arena->tcache_ql_mtx);
 	}
+	/* Cached extent_t's belong to the arena's base. */
+	extent_avail_flush(tsdn, tcache, 0);
 	tcache->arena = NULL;
 }
 
@@ -348,14 +389,17 @@ tcache_init(tsd_t *tsd, tcache_t *tcache, void *avail_stack) {
 	memset(&tcache->link, 0, sizeof(ql_elm(tcache_t)));
 	tcache->prof_accumbytes = 0;
 	tcache->next_gc_bin = 0;
+	tcache->gc_event_wait = tcache_gc_event_new_wait();
 	tcache->arena = NULL;
-
-	ticker_init(&tcache->gc_ticker, TCACHE_GC_INCR);
+	tcache->nextents_avail = 0;
 
 	size_t stack_offset = 0;
 	assert((TCACHE_NSLOTS_SMALL_MAX & 1U) == 0);
 	memset(tcache->tbins_small, 0, sizeof(tcache_bin_t) * NBINS);
 	memset(tcache->tbins_large, 0, sizeof(tcache_bin_t) * (nhbins - NBINS));
+	if (config_stats) {
+		memset(tcache->tstats, 0, sizeof(tcache_bin_stats_t) * nhbins);
+	}
 	unsigned i = 0;
 	for (; i < NBINS; i++) {
 		tcache->lg_fill_div[i] = 1;
@@ -365,13 +409,17 @@ tcache_init(tsd_t *tsd, tcache_t *tcache, void *avail_stack) {
 		 * access the slots toward higher addresses (for the benefit of
 		 * prefetch).
 		 */
-		tcache_small_bin_get(tcache, i)->avail =
-		    (void **)((uintptr_t)avail_stack + (uintptr_t)stack_offset);
+		tcache_bin_t *tbin = tcache_small_bin_get(tcache, i);
+		tbin->avail = (void **)((uintptr_t)avail_stack +
+		    (uintptr_t)stack_offset);
+		tbin->ncached_max = tcache_bin_info[i].ncached_max;
 	}
 	for (; i < nhbins; i++) {
 		stack_offset += tcache_bin_info[i].ncached_max * sizeof(void *);
-		tcache_large_bin_get(tcache, i)->avail =
-		    (void **)((uintptr_t)avail_stack + (uintptr_t)stack_offset);
+		tcache_bin_t *tbin = tcache_large_bin_get(tcache, i);
+		tbin->avail = (void **)((uintptr_t)avail_stack +
+		    (uintptr_t)stack_offset);
+		tbin->ncached_max = tcache_bin_info[i].ncached_max;
 	}
 	assert(stack_offset == stack_nelms * sizeof(void *));
 }
@@ -454,7 +502,7 @@ tcache_flush_cache(tsd_t *tsd, tcache_t *tcache) {
 		tcache_bin_flush_small(tsd, tcache, tbin, i, 0);
 
 		if (config_stats) {
-			assert(tbin->tstats.nrequests == 0);
+			assert(tcache_bin_stats_get(tcache, i)->nrequests == 0);
 		}
 	}
 	for (unsigned i = NBINS; i < nhbins; i++) {
@@ -462,7 +510,7 @@ tcache_flush_cache(tsd_t *tsd, tcache_t *tcache) {
 		tcache_bin_flush_large(tsd, tbin, i, 0, tcache);
 
 		if (config_stats) {
-			assert(tbin->tstats.nrequests == 0);
+			assert(tcache_bin_stats_get(tcache, i)->nrequests == 0);
 		}
 	}
 
@@ -471,6 +519,7 @@ tcache_flush_cache(tsd_t *tsd, tcache_t *tcache) {
 	    tcache->prof_accumbytes)) {
 		prof_idump(tsd_tsdn(tsd));
 	}
+	extent_avail_flush(tsd_tsdn(tsd), tcache, 0);
 }
 
 void
@@ -525,18 +574,18 @@ tcache_stats_merge(tsdn_t *tsdn, tcache_t *tcache, arena_t *arena) {
 	/* Merge and reset tcache stats. */
 	for (i = 0; i < NBINS; i++) {
 		arena_bin_t *bin = &arena->bins[i];
-		tcache_bin_t *tbin = tcache_small_bin_get(tcache, i);
+		tcache_bin_stats_t *tstats = tcache_bin_stats_get(tcache, i);
 		malloc_mutex_lock(tsdn, &bin->lock);
-		bin->stats.nrequests += tbin->tstats.nrequests;
+		bin->stats.nrequests += tstats->nrequests;
 		malloc_mutex_unlock(tsdn, &bin->lock);
-		tbin->tstats.nrequests = 0;
+		tstats->nrequests = 0;
 	}
 
 	for (; i < nhbins; i++) {
-		tcache_bin_t *tbin = tcache_large_bin_get(tcache, i);
+		tcache_bin_stats_t *tstats = tcache_bin_stats_get(tcache, i);
 		arena_stats_large_nrequests_add(tsdn, &arena->stats, i,
-		    tbin->tstats.nrequests);
-		tbin->tstats.nrequests = 0;
+		    tstats->nrequests);
+		tstats->nrequests = 0;
 	}
 }
 
@@ -0,0 +1,184 @@
+#define JEMALLOC_THREAD_EVENT_C_
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/thread_event.h"
+
+/******************************************************************************/
+
+static uint64_t
+thread_tcache_gc_event_new_wait(void) {
+	return (opt_tcache_gc_incr_bytes > 0) ?
+	    (uint64_t)opt_tcache_gc_incr_bytes : THREAD_EVENT_MAX_START_WAIT;
+}
+
+static uint64_t
+thread_prof_sample_event_new_wait(tsd_t *tsd) {
+	if (!config_prof || !opt_prof) {
+		return THREAD_EVENT_MAX_START_WAIT;
+	}
+	return prof_sample_new_event_wait(tsd);
+}
+
+/*
+ * Accounts for elapsed bytes against *waitp.  Returns true if the event is
+ * triggered, in which case the caller is responsible for resetting *waitp.
+ */
+static bool
+thread_event_wait_update(uint64_t *waitp, uint64_t elapsed) {
+	if (*waitp <= elapsed) {
+		return true;
+	}
+	*waitp -= elapsed;
+	return false;
+}
+
+static uint64_t
+thread_event_next(uint64_t last_event, uint64_t wait) {
+	if (wait > THREAD_EVENT_MAX_INTERVAL) {
+		wait = THREAD_EVENT_MAX_INTERVAL;
+	}
+	return last_event + wait;
+}
+
+static void
+thread_alloc_event_next_update(tsd_t *tsd) {
+	uint64_t wait = *tsd_tcache_gc_event_waitp_get(tsd);
+	if (config_prof && *tsd_prof_sample_event_waitp_get(tsd) < wait) {
+		wait = *tsd_prof_sample_event_waitp_get(tsd);
+	}
+	*tsd_thread_allocated_next_eventp_get(tsd) = thread_event_next(
+	    *tsd_thread_allocated_last_eventp_get(tsd), wait);
+}
+
+static void
+thread_dalloc_event_next_update(tsd_t *tsd) {
+	*tsd_thread_deallocated_next_eventp_get(tsd) = thread_event_next(
+	    *tsd_thread_deallocated_last_eventp_get(tsd),
+	    *tsd_tcache_gc_dalloc_event_waitp_get(tsd));
+}
+
+static void
+thread_tcache_gc_event(tsd_t *tsd) {
+	if (tsd_reentrancy_level_get(tsd) > 0 || !tcache_available(tsd)) {
+		return;
+	}
+	tcache_t *tcache = tsd_tcachep_get(tsd);
+	/* Associated arena == NULL implies tcache init in progress. */
+	if (tcache->arena != NULL) {
+		tcache_event_hard(tsd, tcache);
+	}
+}
+
+void
+thread_event_init(tsd_t *tsd) {
+	assert(tsd_nominal(tsd));
+
+	*tsd_prng_statep_get(tsd) = (uint64_t)(uintptr_t)tsd;
+	*tsd_thread_allocated_last_eventp_get(tsd) =
+	    *tsd_thread_allocatedp_get(tsd);
+	*tsd_thread_deallocated_last_eventp_get(tsd) =
+	    *tsd_thread_deallocatedp_get(tsd);
+	*tsd_prof_sample_event_waitp_get(tsd) =
+	    thread_prof_sample_event_new_wait(tsd);
+	*tsd_tcache_gc_event_waitp_get(tsd) = thread_tcache_gc_event_new_wait();
+	*tsd_tcache_gc_dalloc_event_waitp_get(tsd) =
+	    thread_tcache_gc_event_new_wait();
+	thread_alloc_event_next_update(tsd);
+	thread_dalloc_event_next_update(tsd);
+}
+
+void
+thread_alloc_event_hard(tsd_t *tsd) {
+	uint64_t allocated = *tsd_thread_allocatedp_get(tsd);
+	uint64_t *last_eventp = tsd_thread_allocated_last_eventp_get(tsd);
+	uint64_t elapsed = allocated - *last_eventp;
+
+	*last_eventp = allocated;
+	if (unlikely(!tsd_nominal(tsd))) {
+		/*
+		 * Minimally initialized or reincarnated tsd; the event state is
+		 * (re)initialized by thread_event_init() if tsd becomes nominal.
+		 */
+		*tsd_thread_allocated_next_eventp_get(tsd) =
+		    thread_event_next(allocated, THREAD_EVENT_MAX_INTERVAL);
+		return;
+	}
+
+	bool prof_sample_event = config_prof && opt_prof &&
+	    thread_event_wait_update(tsd_prof_sample_event_waitp_get(tsd),
+	    elapsed);
+	bool tcache_gc_event = thread_event_wait_update(
+	    tsd_tcache_gc_event_waitp_get(tsd), elapsed);
+
+	/*
+	 * The sampling decision for the triggering allocation was already made
+	 * by prof_alloc_prep() (see thread_prof_sample_event_lookahead()), so
+	 * all that remains is to compute the next wait.
+	 */
+	if (prof_sample_event) {
+		*tsd_prof_sample_event_waitp_get(tsd) =
+		    thread_prof_sample_event_new_wait(tsd);
+	}
+	if (tcache_gc_event) {
+		*tsd_tcache_gc_event_waitp_get(tsd) =
+		    thread_tcache_gc_event_new_wait();
+	}
+	thread_alloc_event_next_update(tsd);
+
+	if (tcache_gc_event) {
+		thread_tcache_gc_event(tsd);
+	}
+}
+
+void
+thread_dalloc_event_hard(tsd_t *tsd) {
+	uint64_t deallocated = *tsd_thread_deallocatedp_get(tsd);
+	uint64_t *last_eventp = tsd_thread_deallocated_last_eventp_get(tsd);
+	uint64_t elapsed = deallocated - *last_eventp;
+
+	*last_eventp = deallocated;
+	if (unlikely(!tsd_nominal(tsd))) {
+		*tsd_thread_deallocated_next_eventp_get(tsd) =
+		    thread_event_next(deallocated, THREAD_EVENT_MAX_INTERVAL);
+		return;
+	}
+
+	bool tcache_gc_event = thread_event_wait_update(
+	    tsd_tcache_gc_dalloc_event_waitp_get(tsd), elapsed);
+	if (tcache_gc_event) {
+		*tsd_tcache_gc_dalloc_event_waitp_get(tsd) =
+		    thread_tcache_gc_event_new_wait();
+	}
+	thread_dalloc_event_next_update(tsd);
+
+	if (tcache_gc_event) {
+		thread_tcache_gc_event(tsd);
+	}
+}
+
+/*
+ * Discards the current prof sample wait and computes a new one, e.g. after
+ * the sample rate has been changed via prof.reset.
+ */
+void
+thread_prof_sample_event_reset(tsd_t *tsd) {
+	if (!tsd_nominal(tsd)) {
+		return;
+	}
+	/* Account for the bytes allocated since the last event first. */
+	uint64_t allocated = *tsd_thread_allocatedp_get(tsd);
+	uint64_t *last_eventp = tsd_thread_allocated_last_eventp_get(tsd);
+	uint64_t elapsed = allocated - *last_eventp;
+
+	*last_eventp = allocated;
+	if (thread_event_wait_update(tsd_tcache_gc_event_waitp_get(tsd),
+	    elapsed)) {
+		/* Let the next allocation trigger GC. */
+		*tsd_tcache_gc_event_waitp_get(tsd) = 0;
+	}
+	*tsd_prof_sample_event_waitp_get(tsd) =
+	    thread_prof_sample_event_new_wait(tsd);
+	thread_alloc_event_next_update(tsd);
+}
@@ -5,6 +5,7 @@
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/mutex.h"
 #include "jemalloc/internal/rtree.h"
+#include "jemalloc/internal/thread_event.h"
 
 /******************************************************************************/
 /* Data. */
@@ -12,11 +13,18 @@
 static unsigned ncleanups;
 static malloc_tsd_cleanup_t cleanups[MALLOC_TSD_CLEANUPS_MAX];
 
+/*
+ * The TLS instance is cacheline aligned, so that the state byte and the fields
+ * that the allocation fast paths access next to it share a single cacheline
+ * (see the layout in tsd.h).
+ */
 #ifdef JEMALLOC_MALLOC_THREAD_CLEANUP
+JEMALLOC_ALIGNED(CACHELINE)
 __thread tsd_t JEMALLOC_TLS_MODEL tsd_tls = TSD_INITIALIZER;
 __thread bool JEMALLOC_TLS_MODEL tsd_initialized = false;
 bool tsd_booted = false;
 #elif (defined(JEMALLOC_TLS))
+JEMALLOC_ALIGNED(CACHELINE)
 __thread tsd_t JEMALLOC_TLS_MODEL tsd_tls = TSD_INITIALIZER;
 pthread_key_t tsd_tsd;
 bool tsd_booted = false;
@@ -70,6 +78,7 @@ tsd_data_init(tsd_t *tsd) {
 	 * tcache initialization depends on it.
 	 */
 	rtree_ctx_data_init(tsd_rtree_ctxp_get_unsafe(tsd));
+	thread_event_init(tsd);
 
 	return tsd_tcache_enabled_data_init(tsd);
 }
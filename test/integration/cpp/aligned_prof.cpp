@@ -0,0 +1,34 @@
+#include <memory>
+#include "test/jemalloc_test.h"
+
+/*
+ * Run with every allocation sampled (see aligned_prof.sh), so that aligned new
+ * always falls off the fast path, and sampled small objects are promoted to
+ * large ones with a randomized offset.
+ */
+TEST_BEGIN(test_aligned_sampled) {
+#if __cpp_aligned_new >= 201606
+	for (size_t align = 16; align < 4096; align <<= 1) {
+		for (size_t sz = 1; sz <= 2 * align; sz += align / 2) {
+			for (unsigned i = 0; i < 16; i++) {
+				void *p = ::operator new(sz,
+				    std::align_val_t(align));
+				assert_ptr_not_null(p, "Unexpected new failure");
+				assert_zu_eq((uintptr_t)p & (align - 1), 0,
+				    "Insufficiently aligned new for size %zu, "
+				    "alignment %zu", sz, align);
+				::operator delete(p, sz, std::align_val_t(align));
+			}
+		}
+	}
+#else
+	test_skip("C++17 aligned new not supported");
+#endif
+}
+TEST_END
+
+int
+main() {
+	return test(
+	    test_aligned_sampled);
+}
@@ -0,0 +1,179 @@
+#include <vector>
+#include "test/jemalloc_test.h"
+#include "jemalloc/jemalloc_cxx.h"
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected arenas.create failure");
+	return arena_ind;
+}
+
+static unsigned
+tcache_create(void) {
+	unsigned tcache_ind;
+	size_t sz = sizeof(tcache_ind);
+	assert_d_eq(mallctl("tcache.create", (void *)&tcache_ind, &sz, NULL,
+	    0), 0, "Unexpected tcache.create failure");
+	return tcache_ind;
+}
+
+static size_t
+arena_allocated(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected epoch failure");
+
+	size_t small, large;
+	size_t sz = sizeof(size_t);
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.small.allocated",
+	    arena_ind);
+	assert_d_eq(mallctl(cmd, (void *)&small, &sz, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.large.allocated",
+	    arena_ind);
+	assert_d_eq(mallctl(cmd, (void *)&large, &sz, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+	return small + large;
+}
+
+static bool
+have_stats(void) {
+	bool config_stats;
+	size_t sz = sizeof(config_stats);
+	assert_d_eq(mallctl("config.stats", (void *)&config_stats, &sz, NULL,
+	    0), 0, "Unexpected mallctl failure");
+	return config_stats;
+}
+
+TEST_BEGIN(test_binding) {
+	unsigned arena_ind = arena_create();
+	unsigned tcache_ind = tcache_create();
+	jemalloc::arena_binding binding(arena_ind, tcache_ind);
+
+	assert_d_eq(binding.flags(), MALLOCX_ARENA(arena_ind) |
+	    MALLOCX_TCACHE(tcache_ind), "Unexpected flags");
+	assert_d_eq(jemalloc::arena_binding(arena_ind).flags(),
+	    MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE,
+	    "Unexpected flags");
+
+	for (size_t align = 1; align <= 8192; align <<= 1) {
+		for (size_t size = 0; size <= 3 * align; size += align) {
+			void *p = binding.allocate(size, align);
+			assert_zu_eq((uintptr_t)p & (align - 1), 0,
+			    "Insufficiently aligned allocation");
+			binding.deallocate(p, size, align);
+		}
+	}
+
+	assert_d_eq(mallctl("tcache.destroy", NULL, NULL, (void *)&tcache_ind,
+	    sizeof(tcache_ind)), 0, "Unexpected tcache.destroy failure");
+}
+TEST_END
+
+TEST_BEGIN(test_allocator) {
+	unsigned arena_ind = arena_create();
+	unsigned tcache_ind = tcache_create();
+	jemalloc::arena_allocator<int> alloc(
+	    jemalloc::arena_binding(arena_ind, tcache_ind));
+
+	std::vector<int, jemalloc::arena_allocator<int>> v(alloc);
+	for (int i = 0; i < 100000; i++) {
+		v.push_back(i);
+	}
+	if (have_stats()) {
+		assert_zu_ge(arena_allocated(arena_ind),
+		    v.capacity() * sizeof(int),
+		    "Vector should be backed by the bound arena");
+	}
+
+	jemalloc::arena_allocator<char> rebound(alloc);
+	assert_true(rebound == alloc, "Rebound allocator should compare equal");
+	assert_true(alloc != jemalloc::arena_allocator<int>(
+	    jemalloc::arena_binding(arena_ind)),
+	    "Allocators with different tcaches should not compare equal");
+
+	v.clear();
+	v.shrink_to_fit();
+	assert_d_eq(mallctl("tcache.destroy", NULL, NULL, (void *)&tcache_ind,
+	    sizeof(tcache_ind)), 0, "Unexpected tcache.destroy failure");
+}
+TEST_END
+
+TEST_BEGIN(test_release) {
+	unsigned arena_ind = arena_create();
+	unsigned tcache_ind = tcache_create();
+	jemalloc::arena_allocator<char> alloc(
+	    jemalloc::arena_binding(arena_ind, tcache_ind));
+
+	/* Monotonic usage: allocate without ever freeing. */
+	for (size_t i = 0; i < 1000; i++) {
+		char *p = alloc.allocate(1 + (i * 97) % 20000);
+		p[0] = 'a';
+	}
+	assert_d_eq(alloc.release(), 0, "Unexpected release failure");
+	if (have_stats()) {
+		assert_zu_eq(arena_allocated(arena_ind), 0,
+		    "Release should discard all allocations");
+	}
+
+	/* The arena remains usable afterward. */
+	char *p = alloc.allocate(100);
+	alloc.deallocate(p, 100);
+
+	assert_d_eq(jemalloc::arena_binding(0).release(),
+	    EFAULT, "Releasing an automatic arena should fail");
+	assert_d_eq(mallctl("tcache.destroy", NULL, NULL, (void *)&tcache_ind,
+	    sizeof(tcache_ind)), 0, "Unexpected tcache.destroy failure");
+}
+TEST_END
+
+TEST_BEGIN(test_memory_resource) {
+#ifdef JEMALLOC_CXX_HAVE_PMR
+	unsigned arena_ind = arena_create();
+	jemalloc::arena_memory_resource mr(
+	    (jemalloc::arena_binding(arena_ind)));
+
+	{
+		std::pmr::vector<std::pmr::vector<int>> vv(&mr);
+		for (int i = 0; i < 100; i++) {
+			vv.emplace_back(i, i);
+		}
+		assert_true(vv.back().get_allocator().resource()->is_equal(mr),
+		    "Nested containers should use the same resource");
+	}
+
+	void *p = mr.allocate(24, 256);
+	assert_zu_eq((uintptr_t)p & 255, 0, "Insufficiently aligned resource");
+	mr.deallocate(p, 24, 256);
+
+	jemalloc::arena_memory_resource same(
+	    (jemalloc::arena_binding(arena_ind)));
+	assert_true(mr == same, "Resources should compare equal");
+	assert_false(mr == *std::pmr::new_delete_resource(),
+	    "Resources should not compare equal");
+
+	std::pmr::monotonic_buffer_resource monotonic(&mr);
+	for (size_t i = 0; i < 1000; i++) {
+		assert_ptr_not_null(monotonic.allocate(128),
+		    "Unexpected allocation failure");
+	}
+	monotonic.release();
+	assert_d_eq(mr.release(), 0, "Unexpected release failure");
+#else
+	test_skip("std::pmr not supported");
+#endif
+}
+TEST_END
+
+int
+main() {
+	return test(
+	    test_binding,
+	    test_allocator,
+	    test_release,
+	    test_memory_resource);
+}
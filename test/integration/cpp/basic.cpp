@@ -18,8 +18,57 @@ TEST_BEGIN(test_basic) {
 }
 TEST_END
 
+TEST_BEGIN(test_aligned) {
+#if __cpp_aligned_new >= 201606
+	struct alignas(64) aligned_t {
+		char c[100];
+	};
+
+	auto foo = new aligned_t;
+	assert_ptr_not_null(foo, "Unexpected new failure");
+	assert_zu_eq((uintptr_t)foo & 63, 0, "Insufficiently aligned new");
+	delete foo;
+
+	auto bar = new aligned_t[3];
+	assert_ptr_not_null(bar, "Unexpected new[] failure");
+	assert_zu_eq((uintptr_t)bar & 63, 0, "Insufficiently aligned new[]");
+	delete[] bar;
+
+	auto baz = new (std::nothrow) aligned_t;
+	assert_ptr_not_null(baz, "Unexpected nothrow new failure");
+	assert_zu_eq((uintptr_t)baz & 63, 0,
+	    "Insufficiently aligned nothrow new");
+	delete baz;
+
+	void *p = ::operator new(0, std::align_val_t(32));
+	assert_ptr_not_null(p, "Unexpected zero-sized new failure");
+	assert_zu_eq((uintptr_t)p & 31, 0, "Insufficiently aligned new");
+	::operator delete(p, 0, std::align_val_t(32));
+
+	const size_t big_align = 8192;
+	for (size_t sz = 1; sz <= 3 * big_align; sz += sz) {
+		p = ::operator new(sz, std::align_val_t(big_align));
+		assert_ptr_not_null(p, "Unexpected new failure");
+		assert_zu_eq((uintptr_t)p & (big_align - 1), 0,
+		    "Insufficiently aligned new for size %zu", sz);
+		::operator delete(p, sz, std::align_val_t(big_align));
+	}
+
+	for (size_t align = 16; align <= 4096; align <<= 1) {
+		p = ::operator new(100, std::align_val_t(align));
+		assert_zu_eq((uintptr_t)p & (align - 1), 0,
+		    "Insufficiently aligned new for alignment %zu", align);
+		::operator delete(p, std::align_val_t(align));
+	}
+#else
+	test_skip("C++17 aligned new not supported");
+#endif
+}
+TEST_END
+
 int
 main() {
 	return test(
-	    test_basic);
+	    test_basic,
+	    test_aligned);
 }
@@ -147,6 +147,57 @@ TEST_BEGIN(test_zero) {
 }
 TEST_END
 
+/*
+ * Growing large allocations may move their pages rather than copy them (see
+ * large_ralloc()); contents must be preserved either way, and the rest of the
+ * allocation zeroed if requested.
+ */
+TEST_BEGIN(test_grow_move) {
+#define MAX_SIZE (64 << 20)
+	for (unsigned zero = 0; zero < 2; zero++) {
+		int flags = zero ? MALLOCX_ZERO : 0;
+		size_t psz = 2 << 20;
+		size_t *p = (size_t *)mallocx(psz, flags);
+		assert_ptr_not_null(p, "Unexpected mallocx() error");
+		for (size_t i = 0; i < psz / sizeof(size_t); i++) {
+			p[i] = i;
+		}
+
+		while (psz < MAX_SIZE) {
+			/* Get in the way of in-place expansion. */
+			void *blocker = mallocx(psz, 0);
+			assert_ptr_not_null(blocker, "Unexpected mallocx() error");
+
+			size_t qsz = psz * 2;
+			size_t *q = (size_t *)rallocx(p, qsz, flags);
+			assert_ptr_not_null(q, "Unexpected rallocx() error");
+			assert_zu_eq(sallocx(q, 0), qsz, "Unexpected size");
+			for (size_t i = 0; i < psz / sizeof(size_t); i++) {
+				if (q[i] != i) {
+					test_fail("Allocation at %p contains "
+					    "%zu rather than %zu at offset %zu",
+					    q, q[i], i, i * sizeof(size_t));
+					break;
+				}
+			}
+			if (zero) {
+				assert_false(validate_fill(q, 0, psz,
+				    qsz - psz), "Expected zeroed memory");
+			}
+			for (size_t i = psz / sizeof(size_t);
+			    i < qsz / sizeof(size_t); i++) {
+				q[i] = i;
+			}
+			dallocx(blocker, 0);
+			p = q;
+			psz = qsz;
+		}
+		dallocx(p, 0);
+	}
+#undef MAX_SIZE
+}
+TEST_END
+
 TEST_BEGIN(test_align) {
 	void *p, *q;
 	size_t align;
@@ -239,6 +290,7 @@ main(void) {
 	return test(
 	    test_grow_and_shrink,
 	    test_zero,
+	    test_grow_move,
 	    test_align,
 	    test_lg_align_and_zero,
 	    test_overflow);
@@ -1,5 +1,14 @@
 #include "test/jemalloc_test.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#endif
+
 static inline void
 time_func(timedelta_t *timer, uint64_t nwarmup, uint64_t niter,
     void (*func)(void)) {
@@ -15,6 +24,38 @@ time_func(timedelta_t *timer, uint64_t nwarmup, uint64_t niter,
 	timer_stop(timer);
 }
 
+/*
+ * Reports the average cost of one call to func, in cycles where a cycle counter
+ * is available (otherwise only in nanoseconds).
+ */
+static void
+report_per_call(uint64_t nwarmup, uint64_t niter, const char *name,
+    void (*func)(void)) {
+	timedelta_t timer;
+	uint64_t i;
+
+	for (i = 0; i < nwarmup; i++) {
+		func();
+	}
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t cycles = __rdtsc();
+#endif
+	timer_start(&timer);
+	for (i = 0; i < niter; i++) {
+		func();
+	}
+	timer_stop(&timer);
+#if defined(__x86_64__) || defined(__i386__)
+	cycles = __rdtsc() - cycles;
+	malloc_printf("%"FMTu64" iterations, %s: %"FMTu64" cycles/call, "
+	    "%"FMTu64"ns/call\n", niter, name, cycles / niter,
+	    timer_usec(&timer) * 1000 / niter);
+#else
+	malloc_printf("%"FMTu64" iterations, %s: %"FMTu64"ns/call\n", niter,
+	    name, timer_usec(&timer) * 1000 / niter);
+#endif
+}
+
 void
 compare_funcs(uint64_t nwarmup, uint64_t niter, const char *name_a,
     void (*func_a), const char *name_b, void (*func_b)) {
@@ -154,6 +195,657 @@ TEST_BEGIN(test_sallocx_vs_nallocx) {
 }
 TEST_END
 
+/*
+ * malloc()/free() take dedicated fast paths for small tcache-backed requests,
+ * whereas mallocx()/dallocx() always run the full imalloc_body()/ifree()
+ * paths, so comparing the two over a mixed-size working set shows what the
+ * fast paths save.  Reports retired user-space instructions per batch where
+ * the hardware counter is available, in addition to wall time.
+ */
+#define FASTPATH_NPTRS	16
+static const size_t fastpath_sizes[] = {8, 24, 64, 160, 512, 2048, 8192};
+#define FASTPATH_NSIZES	(sizeof(fastpath_sizes) / sizeof(size_t))
+
+static void
+malloc_free_batch(void) {
+	void *ptrs[FASTPATH_NPTRS];
+	unsigned i;
+
+	for (i = 0; i < FASTPATH_NPTRS; i++) {
+		ptrs[i] = malloc(fastpath_sizes[i % FASTPATH_NSIZES]);
+		if (ptrs[i] == NULL) {
+			test_fail("Unexpected malloc() failure");
+			return;
+		}
+	}
+	for (i = 0; i < FASTPATH_NPTRS; i++) {
+		free(ptrs[i]);
+	}
+}
+
+static void
+mallocx_dallocx_batch(void) {
+	void *ptrs[FASTPATH_NPTRS];
+	unsigned i;
+
+	for (i = 0; i < FASTPATH_NPTRS; i++) {
+		ptrs[i] = mallocx(fastpath_sizes[i % FASTPATH_NSIZES], 0);
+		if (ptrs[i] == NULL) {
+			test_fail("Unexpected mallocx() failure");
+			return;
+		}
+	}
+	for (i = 0; i < FASTPATH_NPTRS; i++) {
+		dallocx(ptrs[i], 0);
+	}
+}
+
+#ifdef __linux__
+/*
+ * Returns the number of user-space instructions retired by niter calls to
+ * func, or UINT64_MAX if the counter cannot be opened.
+ */
+static uint64_t
+count_instructions(uint64_t nwarmup, uint64_t niter, void (*func)(void)) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd == -1) {
+		return UINT64_MAX;
+	}
+
+	uint64_t i;
+	for (i = 0; i < nwarmup; i++) {
+		func();
+	}
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	for (i = 0; i < niter; i++) {
+		func();
+	}
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	uint64_t count;
+	assert_zd_eq(read(fd, &count, sizeof(count)), sizeof(count),
+	    "Unexpected perf counter read failure");
+	close(fd);
+	return count;
+}
+#endif
+
+TEST_BEGIN(test_fastpath_vs_slowpath) {
+	compare_funcs(1000*1000, 10*1000*1000, "malloc_free",
+	    malloc_free_batch, "mallocx_dallocx", mallocx_dallocx_batch);
+#ifdef __linux__
+	uint64_t niter = 1000*1000;
+	uint64_t insns_a = count_instructions(niter / 10, niter,
+	    malloc_free_batch);
+	uint64_t insns_b = count_instructions(niter / 10, niter,
+	    mallocx_dallocx_batch);
+	if (insns_a == UINT64_MAX || insns_b == UINT64_MAX) {
+		malloc_printf("Instruction counter not available\n");
+		return;
+	}
+	/* Each batch is FASTPATH_NPTRS allocations and as many frees. */
+	malloc_printf("%"FMTu64" iterations, malloc_free=%"FMTu64
+	    " insns/pair, mallocx_dallocx=%"FMTu64" insns/pair\n", niter,
+	    insns_a / niter / FASTPATH_NPTRS,
+	    insns_b / niter / FASTPATH_NPTRS);
+#endif
+}
+TEST_END
+
+/*
+ * Fills a slab in a dedicated arena without tcache, then frees every region,
+ * so that each iteration allocates a fresh slab extent and returns it to
+ * extents_dirty.  Comparing a bin with single-page slabs to the bin with the
+ * largest slabs shows how much of the churn cost scales with the number of
+ * interior pages that have to be (de)registered in the rtree.
+ */
+#define SLAB_CHURN_NREGS_MAX	64
+static unsigned slab_churn_arena;
+static size_t slab_churn_small_size, slab_churn_large_size;
+static uint32_t slab_churn_small_nregs, slab_churn_large_nregs;
+
+static void
+slab_churn(size_t size, uint32_t nregs) {
+	void *ptrs[SLAB_CHURN_NREGS_MAX];
+	int flags = MALLOCX_ARENA(slab_churn_arena) | MALLOCX_TCACHE_NONE;
+	uint32_t i;
+
+	for (i = 0; i < nregs; i++) {
+		ptrs[i] = mallocx(size, flags);
+		if (ptrs[i] == NULL) {
+			test_fail("Unexpected mallocx() failure");
+			return;
+		}
+	}
+	for (i = 0; i < nregs; i++) {
+		sdallocx(ptrs[i], size, flags);
+	}
+}
+
+static void
+slab_churn_small(void) {
+	slab_churn(slab_churn_small_size, slab_churn_small_nregs);
+}
+
+static void
+slab_churn_large(void) {
+	slab_churn(slab_churn_large_size, slab_churn_large_nregs);
+}
+
+TEST_BEGIN(test_slab_churn) {
+	unsigned nbins, i;
+	size_t sz, mib[4], miblen, slab_size, max_slab_size;
+	uint32_t nregs;
+
+	sz = sizeof(slab_churn_arena);
+	assert_d_eq(mallctl("arenas.create", (void *)&slab_churn_arena, &sz,
+	    NULL, 0), 0, "Unexpected mallctl() failure");
+	sz = sizeof(nbins);
+	assert_d_eq(mallctl("arenas.nbins", (void *)&nbins, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+
+	slab_churn_small_size = slab_churn_large_size = 0;
+	max_slab_size = PAGE;
+	for (i = 0; i < nbins; i++) {
+		miblen = sizeof(mib) / sizeof(size_t);
+		assert_d_eq(mallctlnametomib("arenas.bin.0.slab_size", mib,
+		    &miblen), 0, "Unexpected mallctlnametomib() failure");
+		mib[2] = i;
+		sz = sizeof(slab_size);
+		assert_d_eq(mallctlbymib(mib, miblen, (void *)&slab_size, &sz,
+		    NULL, 0), 0, "Unexpected mallctlbymib() failure");
+		miblen = sizeof(mib) / sizeof(size_t);
+		assert_d_eq(mallctlnametomib("arenas.bin.0.nregs", mib,
+		    &miblen), 0, "Unexpected mallctlnametomib() failure");
+		mib[2] = i;
+		sz = sizeof(nregs);
+		assert_d_eq(mallctlbymib(mib, miblen, (void *)&nregs, &sz,
+		    NULL, 0), 0, "Unexpected mallctlbymib() failure");
+		if (nregs > SLAB_CHURN_NREGS_MAX) {
+			continue;
+		}
+
+		size_t size;
+		miblen = sizeof(mib) / sizeof(size_t);
+		assert_d_eq(mallctlnametomib("arenas.bin.0.size", mib,
+		    &miblen), 0, "Unexpected mallctlnametomib() failure");
+		mib[2] = i;
+		sz = sizeof(size);
+		assert_d_eq(mallctlbymib(mib, miblen, (void *)&size, &sz,
+		    NULL, 0), 0, "Unexpected mallctlbymib() failure");
+		if (slab_size == PAGE && slab_churn_small_size == 0) {
+			slab_churn_small_size = size;
+			slab_churn_small_nregs = nregs;
+		}
+		if (slab_size > max_slab_size) {
+			max_slab_size = slab_size;
+			slab_churn_large_size = size;
+			slab_churn_large_nregs = nregs;
+		}
+	}
+	if (slab_churn_small_size == 0 || slab_churn_large_size == 0) {
+		test_skip("No suitable bins");
+		return;
+	}
+
+	compare_funcs(1000, 100*1000, "slab_churn_small",
+	    slab_churn_small, "slab_churn_large", slab_churn_large);
+}
+TEST_END
+
+/*
+ * Random-free lookup pattern: keys are scattered over a 64 GiB address range,
+ * i.e. over many more rtree leaves than the rtree_ctx cache covers, and are
+ * looked up in random order, as on free() for a large, long-lived heap.  The
+ * two trees are private instances of the (jet) rtree, so both modes can be
+ * compared within one process regardless of opt.rtree_flat.
+ */
+#define RTREE_BENCH_NKEYS	(16 * 1024)
+#define RTREE_BENCH_LG_SPAN	36
+static rtree_t rtree_bench_flat, rtree_bench_tree;
+static rtree_ctx_t rtree_bench_flat_ctx, rtree_bench_tree_ctx;
+static uintptr_t rtree_bench_keys[RTREE_BENCH_NKEYS];
+static unsigned rtree_bench_flat_ind, rtree_bench_tree_ind;
+static extent_t rtree_bench_extent;
+
+static rtree_node_elm_t *
+rtree_bench_node_alloc(tsdn_t *tsdn, rtree_t *rtree, size_t nelms) {
+	return (rtree_node_elm_t *)calloc(nelms, sizeof(rtree_node_elm_t));
+}
+
+static void
+rtree_bench_node_dalloc(tsdn_t *tsdn, rtree_t *rtree, rtree_node_elm_t *node) {
+	free(node);
+}
+
+static rtree_leaf_elm_t *
+rtree_bench_leaf_alloc(tsdn_t *tsdn, rtree_t *rtree, size_t nelms) {
+	return (rtree_leaf_elm_t *)calloc(nelms, sizeof(rtree_leaf_elm_t));
+}
+
+static void
+rtree_bench_leaf_dalloc(tsdn_t *tsdn, rtree_t *rtree, rtree_leaf_elm_t *leaf) {
+	free(leaf);
+}
+
+static void
+rtree_bench_lookup(rtree_t *rtree, rtree_ctx_t *rtree_ctx, unsigned *ind) {
+	uintptr_t key = rtree_bench_keys[*ind];
+	*ind = (*ind + 1) % RTREE_BENCH_NKEYS;
+	if (rtree_extent_read(TSDN_NULL, rtree, rtree_ctx, key, true) !=
+	    &rtree_bench_extent) {
+		test_fail("Unexpected rtree_extent_read() result");
+	}
+}
+
+static void
+rtree_bench_flat_lookup(void) {
+	rtree_bench_lookup(&rtree_bench_flat, &rtree_bench_flat_ctx,
+	    &rtree_bench_flat_ind);
+}
+
+static void
+rtree_bench_tree_lookup(void) {
+	rtree_bench_lookup(&rtree_bench_tree, &rtree_bench_tree_ctx,
+	    &rtree_bench_tree_ind);
+}
+
+TEST_BEGIN(test_rtree_flat_vs_tree) {
+	test_skip_if(!config_rtree_flat);
+
+	/* The private rtrees are backed by the (uninitialized) jet library. */
+	assert_false(pages_boot(), "Unexpected pages_boot() failure");
+	rtree_node_alloc = rtree_bench_node_alloc;
+	rtree_node_dalloc = rtree_bench_node_dalloc;
+	rtree_leaf_alloc = rtree_bench_leaf_alloc;
+	rtree_leaf_dalloc = rtree_bench_leaf_dalloc;
+
+	opt_rtree_flat = true;
+	assert_false(rtree_new(&rtree_bench_flat, false),
+	    "Unexpected rtree_new() failure");
+	if (!rtree_flat_enabled(&rtree_bench_flat)) {
+		rtree_delete(TSDN_NULL, &rtree_bench_flat);
+		test_skip("Flat rtree reservation failed");
+		return;
+	}
+	opt_rtree_flat = false;
+	assert_false(rtree_new(&rtree_bench_tree, false),
+	    "Unexpected rtree_new() failure");
+	rtree_ctx_data_init(&rtree_bench_flat_ctx);
+	rtree_ctx_data_init(&rtree_bench_tree_ctx);
+
+	extent_init(&rtree_bench_extent, NULL, NULL, 0, false, NSIZES, 0,
+	    extent_state_active, false, false);
+	sfmt_t *sfmt = init_gen_rand(42);
+	for (unsigned i = 0; i < RTREE_BENCH_NKEYS; i++) {
+		uintptr_t key = ((uintptr_t)1 << RTREE_BENCH_LG_SPAN) +
+		    ((uintptr_t)gen_rand64_range(sfmt, (uint64_t)1 <<
+		    (RTREE_BENCH_LG_SPAN - LG_PAGE)) << LG_PAGE);
+		rtree_bench_keys[i] = key;
+		rtree_leaf_elm_t *elm = rtree_leaf_elm_lookup(TSDN_NULL,
+		    &rtree_bench_flat, &rtree_bench_flat_ctx, key, false, true);
+		rtree_leaf_elm_write(TSDN_NULL, &rtree_bench_flat, elm,
+		    &rtree_bench_extent, NSIZES, false);
+		elm = rtree_leaf_elm_lookup(TSDN_NULL, &rtree_bench_tree,
+		    &rtree_bench_tree_ctx, key, false, true);
+		assert_ptr_not_null(elm, "Unexpected rtree lookup failure");
+		rtree_leaf_elm_write(TSDN_NULL, &rtree_bench_tree, elm,
+		    &rtree_bench_extent, NSIZES, false);
+	}
+	fini_gen_rand(sfmt);
+
+	compare_funcs(RTREE_BENCH_NKEYS, 100 * RTREE_BENCH_NKEYS, "flat",
+	    rtree_bench_flat_lookup, "tree", rtree_bench_tree_lookup);
+
+	rtree_delete(TSDN_NULL, &rtree_bench_flat);
+	rtree_delete(TSDN_NULL, &rtree_bench_tree);
+}
+TEST_END
+
+/*
+ * Per-call cost of the thread state fetch plus the tcache fast paths.
+ * nallocx() does little more than fetch tsd, so it approximates the fetch
+ * alone.
+ */
+/* Volatile, so that calls to the pure nallocx() cannot be hoisted. */
+static volatile size_t nallocx_size = 1;
+
+static void
+nallocx_1(void) {
+	if (nallocx(nallocx_size, 0) == 0) {
+		test_fail("Unexpected nallocx() failure");
+	}
+}
+
+TEST_BEGIN(test_fetch_cycles) {
+	report_per_call(1000*1000, 10*1000*1000, "nallocx", nallocx_1);
+	report_per_call(1000*1000, 10*1000*1000, "malloc_free", malloc_free);
+	report_per_call(1000*1000, 10*1000*1000, "mallocx_free", mallocx_free);
+}
+TEST_END
+
+/*
+ * Growth of two buffers from 1 MiB to 1 GiB each, via realloc() (which can move
+ * pages rather than copy them, see large_ralloc()) vs. via allocate-copy-free.
+ * The buffers grow in turns, so that neither can be expanded in place, and the
+ * newly added half of each buffer is written after every step.  Dirty memory is
+ * purged after each run, since copying into recycled pages that are already
+ * faulted in is cheaper than remapping (and large_ralloc() does so).
+ */
+#define REALLOC_GROW_MIN	((size_t)1 << 20)
+#define REALLOC_GROW_MAX	((size_t)1 << 30)
+
+static void *
+malloc_copy(void *p, size_t oldsize, size_t size) {
+	void *q = malloc(size);
+	if (q != NULL) {
+		memcpy(q, p, oldsize);
+		free(p);
+	}
+	return q;
+}
+
+static void
+grow_buffers(bool use_realloc) {
+	void *bufs[2];
+	size_t sz = REALLOC_GROW_MIN;
+
+	for (unsigned i = 0; i < 2; i++) {
+		bufs[i] = malloc(sz);
+		if (bufs[i] == NULL) {
+			test_fail("Unexpected malloc() failure");
+			return;
+		}
+		memset(bufs[i], 1, sz);
+	}
+	while (sz < REALLOC_GROW_MAX) {
+		for (unsigned i = 0; i < 2; i++) {
+			void *q = use_realloc ? realloc(bufs[i], sz * 2) :
+			    malloc_copy(bufs[i], sz, sz * 2);
+			if (q == NULL) {
+				test_fail("Unexpected allocation failure");
+				return;
+			}
+			memset((void *)((uintptr_t)q + sz), 1, sz);
+			bufs[i] = q;
+		}
+		sz *= 2;
+	}
+	free(bufs[0]);
+	free(bufs[1]);
+	/* Start each run from memory that is not backed by pages yet. */
+	assert_d_eq(mallctl("arena." STRINGIFY(MALLCTL_ARENAS_ALL) ".purge",
+	    NULL, NULL, NULL, 0), 0, "Unexpected mallctl failure");
+}
+
+static void
+realloc_grow(void) {
+	grow_buffers(true);
+}
+
+static void
+malloc_copy_grow(void) {
+	grow_buffers(false);
+}
+
+TEST_BEGIN(test_realloc_grow) {
+	compare_funcs(1, 5, "realloc_grow", realloc_grow, "malloc_copy_grow",
+	    malloc_copy_grow);
+}
+TEST_END
+
+/*
+ * L1 data cache read misses per malloc/free pair, cycling through all small
+ * size classes so that every small tcache bin is in use.  This is sensitive to
+ * the layout of tcache_t; it requires access to hardware performance counters,
+ * which are often unavailable in containers and VMs.
+ */
+#define TCACHE_L1_NITER	(1000*1000)
+static size_t tcache_l1_sizes[NBINS];
+static unsigned tcache_l1_nbins;
+
+static void
+tcache_l1_sizes_init(void) {
+	size_t sz = sizeof(tcache_l1_nbins);
+	assert_d_eq(mallctl("arenas.nbins", (void *)&tcache_l1_nbins, &sz,
+	    NULL, 0), 0, "Unexpected mallctl failure");
+	assert_u_le(tcache_l1_nbins, NBINS, "Unexpected number of bins");
+
+	size_t mib[4];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arenas.bin.0.size", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib failure");
+	for (unsigned i = 0; i < tcache_l1_nbins; i++) {
+		mib[2] = i;
+		sz = sizeof(size_t);
+		assert_d_eq(mallctlbymib(mib, miblen,
+		    (void *)&tcache_l1_sizes[i], &sz, NULL, 0), 0,
+		    "Unexpected mallctlbymib failure");
+	}
+}
+
+static void
+tcache_l1_pairs(void) {
+	for (unsigned i = 0; i < TCACHE_L1_NITER; i++) {
+		void *p = malloc(tcache_l1_sizes[i % tcache_l1_nbins]);
+		if (p == NULL) {
+			test_fail("Unexpected malloc() failure");
+			return;
+		}
+		free(p);
+	}
+}
+
+TEST_BEGIN(test_tcache_l1_misses) {
+#ifdef __linux__
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_L1D |
+	    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+	    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	test_skip_if(fd == -1);
+
+	/* Warm up, so that all bins are populated. */
+	tcache_l1_sizes_init();
+	tcache_l1_pairs();
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	tcache_l1_pairs();
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	uint64_t misses;
+	assert_zd_eq(read(fd, &misses, sizeof(misses)), sizeof(misses),
+	    "Unexpected perf counter read failure");
+	close(fd);
+	malloc_printf("%"FMTu64" malloc/free pairs: %"FMTu64".%03"FMTu64
+	    " L1d read misses/pair\n", (uint64_t)TCACHE_L1_NITER,
+	    misses / TCACHE_L1_NITER,
+	    misses % TCACHE_L1_NITER * 1000 / TCACHE_L1_NITER);
+#else
+	test_skip("Hardware performance counters not supported");
+#endif
+}
+TEST_END
+
+/*
+ * Mixed-size large allocation churn from several threads sharing one arena,
+ * which exercises extent selection (opt.extent_fit) under the extents mutexes.
+ * Reports the wait statistics of those mutexes as recorded by mutex profiling;
+ * run with e.g. MALLOC_CONF=extent_fit:segregated to compare policies.
+ */
+#define EXTENT_CHURN_NTHREADS	4
+#define EXTENT_CHURN_NLIVE	64
+#define EXTENT_CHURN_NITER	(100*1000)
+static unsigned extent_churn_arena;
+
+static void *
+extent_churn_thread(void *arg) {
+	void *ptrs[EXTENT_CHURN_NLIVE] = {NULL};
+	size_t sizes[EXTENT_CHURN_NLIVE];
+	uint64_t state = (uint64_t)(uintptr_t)arg + 1;
+
+	for (unsigned i = 0; i < EXTENT_CHURN_NITER; i++) {
+		unsigned slot = (unsigned)prng_lg_range_u64(&state, 6);
+		int flags = MALLOCX_ARENA(extent_churn_arena) |
+		    MALLOCX_TCACHE_NONE;
+		if (ptrs[slot] != NULL) {
+			sdallocx(ptrs[slot], sizes[slot], flags);
+		}
+		/* Sizes from LARGE_MINCLASS to 2 MiB, some page-aligned. */
+		sizes[slot] = LARGE_MINCLASS + (size_t)prng_lg_range_u64(&state,
+		    21 - LG_PAGE) * PAGE;
+		if (prng_lg_range_u64(&state, 2) == 0) {
+			flags |= MALLOCX_LG_ALIGN(LG_PAGE + 1 +
+			    (unsigned)prng_lg_range_u64(&state, 3));
+		}
+		ptrs[slot] = mallocx(sizes[slot], flags);
+		if (ptrs[slot] == NULL) {
+			test_fail("Unexpected mallocx() failure");
+			return NULL;
+		}
+		if (flags & MALLOCX_LG_ALIGN_MASK) {
+			sdallocx(ptrs[slot], sizes[slot], flags);
+			ptrs[slot] = NULL;
+		}
+	}
+	for (unsigned i = 0; i < EXTENT_CHURN_NLIVE; i++) {
+		if (ptrs[i] != NULL) {
+			sdallocx(ptrs[i], sizes[i], MALLOCX_ARENA(
+			    extent_churn_arena) | MALLOCX_TCACHE_NONE);
+		}
+	}
+	return NULL;
+}
+
+static uint64_t
+extent_churn_mutex_stat(const char *mutex, const char *stat) {
+	char cmd[128];
+	uint64_t val;
+	size_t sz = sizeof(val);
+
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.mutexes.%s.%s",
+	    extent_churn_arena, mutex, stat);
+	assert_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+	return val;
+}
+
+TEST_BEGIN(test_extent_churn) {
+	test_skip_if(!config_stats);
+
+	const char *extent_fit;
+	size_t sz = sizeof(extent_fit);
+	assert_d_eq(mallctl("opt.extent_fit", (void *)&extent_fit, &sz, NULL,
+	    0), 0, "Unexpected mallctl failure");
+	sz = sizeof(extent_churn_arena);
+	assert_d_eq(mallctl("arenas.create", (void *)&extent_churn_arena, &sz,
+	    NULL, 0), 0, "Unexpected mallctl failure");
+
+	thd_t thds[EXTENT_CHURN_NTHREADS];
+	timedelta_t timer;
+	timer_start(&timer);
+	for (unsigned i = 0; i < EXTENT_CHURN_NTHREADS; i++) {
+		thd_create(&thds[i], extent_churn_thread, (void *)(uintptr_t)i);
+	}
+	for (unsigned i = 0; i < EXTENT_CHURN_NTHREADS; i++) {
+		thd_join(thds[i], NULL);
+	}
+	timer_stop(&timer);
+
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl failure");
+	malloc_printf("%u threads x %u iterations, extent_fit:%s: %"FMTu64
+	    "us\n", EXTENT_CHURN_NTHREADS, EXTENT_CHURN_NITER, extent_fit,
+	    timer_usec(&timer));
+	const char *mutexes[] = {"extents_dirty", "extents_muzzy",
+	    "extents_retained"};
+	for (unsigned i = 0; i < sizeof(mutexes) / sizeof(mutexes[0]); i++) {
+		malloc_printf("  %s: num_ops=%"FMTu64", num_wait=%"FMTu64
+		    ", total_wait_time=%"FMTu64"ns, max_wait_time=%"FMTu64
+		    "ns\n", mutexes[i],
+		    extent_churn_mutex_stat(mutexes[i], "num_ops"),
+		    extent_churn_mutex_stat(mutexes[i], "num_wait"),
+		    extent_churn_mutex_stat(mutexes[i], "total_wait_time"),
+		    extent_churn_mutex_stat(mutexes[i], "max_wait_time"));
+	}
+}
+TEST_END
+
+/*
+ * calloc()/free() pairs across sizes, from memory that is zero-filled to begin
+ * with (a fresh arena per run, so that slabs and extents come from newly mapped
+ * memory) vs. memory that is reused and thus has to be zeroed again.
+ */
+#define CALLOC_NBYTES	((size_t)64 << 20)
+#define CALLOC_NLIVE	64
+
+static void
+calloc_pairs(size_t sz, bool fresh) {
+	unsigned arena_ind;
+	size_t usz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &usz, NULL,
+	    0), 0, "Unexpected mallctl failure");
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void *ptrs[CALLOC_NLIVE];
+	/* Bound the memory that fresh runs consume. */
+	unsigned niter = (unsigned)(CALLOC_NBYTES / (sz * CALLOC_NLIVE));
+	if (niter == 0) {
+		niter = 1;
+	}
+
+	timedelta_t timer;
+	timer_start(&timer);
+	for (unsigned i = 0; i < niter; i++) {
+		for (unsigned j = 0; j < CALLOC_NLIVE; j++) {
+			ptrs[j] = mallocx(sz, flags | MALLOCX_ZERO);
+			if (ptrs[j] == NULL) {
+				test_fail("Unexpected mallocx() failure");
+				return;
+			}
+		}
+		/* Keep fresh runs from reusing memory. */
+		for (unsigned j = 0; !fresh && j < CALLOC_NLIVE; j++) {
+			dallocx(ptrs[j], flags);
+		}
+	}
+	timer_stop(&timer);
+	malloc_printf("calloc(%zu) x %u, %s: %"FMTu64"ns/call\n", sz,
+	    niter * CALLOC_NLIVE, fresh ? "fresh" : "reused",
+	    timer_usec(&timer) * 1000 / (niter * CALLOC_NLIVE));
+
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.destroy", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib failure");
+}
+
+TEST_BEGIN(test_calloc) {
+	size_t sizes[] = {64, 1024, 8192, 64 << 10, 512 << 10, 4 << 20};
+
+	for (unsigned i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+		calloc_pairs(sizes[i], true);
+		calloc_pairs(sizes[i], false);
+	}
+}
+TEST_END
+
 int
 main(void) {
 	return test_no_reentrancy(
@@ -161,5 +853,13 @@ main(void) {
 	    test_free_vs_dallocx,
 	    test_dallocx_vs_sdallocx,
 	    test_mus_vs_sallocx,
-	    test_sallocx_vs_nallocx);
+	    test_sallocx_vs_nallocx,
+	    test_fastpath_vs_slowpath,
+	    test_slab_churn,
+	    test_rtree_flat_vs_tree,
+	    test_fetch_cycles,
+	    test_tcache_l1_misses,
+	    test_realloc_grow,
+	    test_extent_churn,
+	    test_calloc);
 }
@@ -192,6 +192,79 @@ TEST_BEGIN(test_arena_reset) {
 }
 TEST_END
 
+static size_t
+arena_stat_zu(const char *name, unsigned arena_ind) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.%s", arena_ind,
+	    name);
+	size_t ret;
+	size_t sz = sizeof(ret);
+	assert_d_eq(mallctl(cmd, (void *)&ret, &sz, NULL, 0), 0,
+	    "Unexpected mallctl(\"%s\", ...) failure", cmd);
+	return ret;
+}
+
+static uint64_t
+arena_stat_u64(const char *name, unsigned arena_ind) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.%s", arena_ind,
+	    name);
+	uint64_t ret;
+	size_t sz = sizeof(ret);
+	assert_d_eq(mallctl(cmd, (void *)&ret, &sz, NULL, 0), 0,
+	    "Unexpected mallctl(\"%s\", ...) failure", cmd);
+	return ret;
+}
+
+TEST_BEGIN(test_arena_reset_stats) {
+	test_skip_if(!config_stats);
+#define NSMALL_OBJS	10000
+#define NLARGE_OBJS	100
+	unsigned arena_ind = do_arena_create(NULL);
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	for (unsigned i = 0; i < NSMALL_OBJS; i++) {
+		assert_ptr_not_null(mallocx(1 + i % SMALL_MAXCLASS, flags),
+		    "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < NLARGE_OBJS; i++) {
+		assert_ptr_not_null(mallocx(LARGE_MINCLASS + i * PAGE, flags),
+		    "Unexpected mallocx() failure");
+	}
+	assert_zu_gt(arena_stat_zu("pactive", arena_ind), 0,
+	    "Arena should have active pages");
+	/* Sampled small objects are promoted to large, so this may be higher. */
+	uint64_t nlarge = arena_stat_u64("large.nmalloc", arena_ind);
+	assert_u64_ge(nlarge, NLARGE_OBJS, "Unexpected large allocation count");
+
+	do_arena_reset(arena_ind);
+
+	assert_zu_eq(arena_stat_zu("pactive", arena_ind), 0,
+	    "Reset arena should have no active pages");
+	assert_zu_eq(arena_stat_zu("small.allocated", arena_ind), 0,
+	    "Reset arena should have no small allocations");
+	assert_zu_eq(arena_stat_zu("large.allocated", arena_ind), 0,
+	    "Reset arena should have no large allocations");
+	assert_u64_eq(arena_stat_u64("large.ndalloc", arena_ind), nlarge,
+	    "Large deallocations should be accounted for");
+
+	/* The arena is usable again afterward. */
+	void *p = mallocx(1, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+#undef NSMALL_OBJS
+#undef NLARGE_OBJS
+}
+TEST_END
+
 static bool
 arena_i_initialized(unsigned arena_ind, bool refresh) {
 	bool initialized;
@@ -338,6 +411,7 @@ int
 main(void) {
 	return test(
 	    test_arena_reset,
+	    test_arena_reset_stats,
 	    test_arena_destroy_initial,
 	    test_arena_destroy_hooks_default,
 	    test_arena_destroy_hooks_unmap);
@@ -0,0 +1,237 @@
+#include "test/jemalloc_test.h"
+
+#define NITER		100
+#define LARGE_SZ	(256 * 1024)
+/* Upper bound on how long the background thread may take to purge. */
+#define PURGE_WAIT_MS	10000
+
+static bool
+background_thread_set(bool enable) {
+	return mallctl("background_thread", NULL, NULL, (void *)&enable,
+	    sizeof(enable)) != 0;
+}
+
+static unsigned
+do_arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(unsigned);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+do_arena_destroy(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.destroy", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static void
+do_epoch(void) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+}
+
+static uint64_t
+get_arena_npurge_inline(unsigned arena_ind) {
+	do_epoch();
+	size_t mib[4];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("stats.arenas.0.npurge_inline", mib,
+	    &miblen), 0, "Unexpected mallctlnametomib() failure");
+	mib[2] = (size_t)arena_ind;
+	uint64_t npurge_inline;
+	size_t sz = sizeof(npurge_inline);
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&npurge_inline, &sz,
+	    NULL, 0), 0, "Unexpected mallctlbymib() failure");
+	return npurge_inline;
+}
+
+static size_t
+get_arena_pdirty(unsigned arena_ind) {
+	do_epoch();
+	size_t mib[4];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("stats.arenas.0.pdirty", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[2] = (size_t)arena_ind;
+	size_t pdirty;
+	size_t sz = sizeof(pdirty);
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&pdirty, &sz, NULL, 0),
+	    0, "Unexpected mallctlbymib() failure");
+	return pdirty;
+}
+
+static void
+do_churn(unsigned arena_ind) {
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	for (unsigned i = 0; i < NITER; i++) {
+		void *p = mallocx(LARGE_SZ, flags);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, flags);
+	}
+}
+
+TEST_BEGIN(test_inline_purge) {
+	test_skip_if(!config_stats);
+
+	/* Without background threads, decay_ms == 0 purges on free. */
+	unsigned arena_ind = do_arena_create();
+	do_churn(arena_ind);
+	assert_u64_gt(get_arena_npurge_inline(arena_ind), 0,
+	    "Application threads should have purged");
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_background_purge_only) {
+	test_skip_if(!have_background_thread);
+	test_skip_if(!config_stats);
+
+	bool purge_only;
+	size_t sz = sizeof(purge_only);
+	assert_d_eq(mallctl("opt.background_purge_only", (void *)&purge_only,
+	    &sz, NULL, 0), 0, "Unexpected mallctl() failure");
+	test_skip_if(!purge_only);
+	test_skip_if(background_thread_set(true));
+
+	unsigned arena_ind = do_arena_create();
+	do_churn(arena_ind);
+	assert_u64_eq(get_arena_npurge_inline(arena_ind), 0,
+	    "Purging should be left to background threads");
+
+	/* The background thread is only woken up; give it time to purge. */
+	unsigned waited_ms = 0;
+	while (get_arena_pdirty(arena_ind) > 0 &&
+	    waited_ms < PURGE_WAIT_MS) {
+		mq_nanosleep(1000 * 1000);
+		waited_ms++;
+	}
+	assert_zu_eq(get_arena_pdirty(arena_ind), 0,
+	    "Background thread should have purged all dirty pages");
+	assert_u64_eq(get_arena_npurge_inline(arena_ind), 0,
+	    "Purging should be left to background threads");
+
+	assert_false(background_thread_set(false),
+	    "Unexpected background_thread disable failure");
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+static bool
+wait_for_purge(unsigned arena_ind) {
+	for (unsigned waited_ms = 0; get_arena_pdirty(arena_ind) > 0;
+	    waited_ms++) {
+		if (waited_ms == PURGE_WAIT_MS) {
+			return true;
+		}
+		mq_nanosleep(1000 * 1000);
+	}
+	return false;
+}
+
+/*
+ * Background threads are shared between arenas, so keep other arenas from
+ * waking them up.
+ */
+static void
+other_arenas_decay_ms_set(unsigned arena_ind, ssize_t decay_ms) {
+	unsigned narenas;
+	size_t sz = sizeof(narenas);
+	assert_d_eq(mallctl("arenas.narenas", (void *)&narenas, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	for (unsigned i = 0; i < narenas; i++) {
+		char cmd[64];
+		bool initialized;
+		sz = sizeof(initialized);
+		malloc_snprintf(cmd, sizeof(cmd), "arena.%u.initialized", i);
+		assert_d_eq(mallctl(cmd, (void *)&initialized, &sz, NULL, 0),
+		    0, "Unexpected mallctl() failure");
+		if (i == arena_ind || !initialized) {
+			continue;
+		}
+		malloc_snprintf(cmd, sizeof(cmd), "arena.%u.dirty_decay_ms", i);
+		assert_d_eq(mallctl(cmd, NULL, NULL, (void *)&decay_ms,
+		    sizeof(decay_ms)), 0, "Unexpected mallctl() failure");
+		malloc_snprintf(cmd, sizeof(cmd), "arena.%u.muzzy_decay_ms", i);
+		assert_d_eq(mallctl(cmd, NULL, NULL, (void *)&decay_ms,
+		    sizeof(decay_ms)), 0, "Unexpected mallctl() failure");
+	}
+}
+
+static atomic_b_t info_locked;
+
+static void *
+thd_info_lock(void *arg) {
+	unsigned arena_ind = *(unsigned *)arg;
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	background_thread_info_t *info =
+	    &background_thread_info[arena_ind % ncpus];
+
+	malloc_mutex_lock(tsdn, &info->mtx);
+	atomic_store_b(&info_locked, true, ATOMIC_RELEASE);
+	/* Hold on while the main thread frees. */
+	mq_nanosleep(100 * 1000 * 1000);
+	malloc_mutex_unlock(tsdn, &info->mtx);
+	return NULL;
+}
+
+TEST_BEGIN(test_background_purge_hint) {
+	test_skip_if(!have_background_thread);
+	test_skip_if(!config_stats);
+
+	bool purge_only;
+	size_t sz = sizeof(purge_only);
+	assert_d_eq(mallctl("opt.background_purge_only", (void *)&purge_only,
+	    &sz, NULL, 0), 0, "Unexpected mallctl() failure");
+	test_skip_if(!purge_only);
+	test_skip_if(background_thread_set(true));
+
+	/* Let the background thread purge and go to sleep indefinitely. */
+	unsigned arena_ind = do_arena_create();
+	other_arenas_decay_ms_set(arena_ind, -1);
+	do_churn(arena_ind);
+	assert_false(wait_for_purge(arena_ind),
+	    "Background thread should have purged all dirty pages");
+
+	/*
+	 * Free while the background thread's mutex is held elsewhere, then go
+	 * idle; the purge hint must still reach the background thread.
+	 */
+	atomic_store_b(&info_locked, false, ATOMIC_RELAXED);
+	thd_t thd;
+	thd_create(&thd, thd_info_lock, (void *)&arena_ind);
+	while (!atomic_load_b(&info_locked, ATOMIC_ACQUIRE)) {
+		mq_nanosleep(1000 * 1000);
+	}
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void *p = mallocx(LARGE_SZ, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+	thd_join(thd, NULL);
+
+	assert_false(wait_for_purge(arena_ind),
+	    "Purge hint was lost");
+	assert_u64_eq(get_arena_npurge_inline(arena_ind), 0,
+	    "Purging should be left to background threads");
+
+	other_arenas_decay_ms_set(arena_ind, 0);
+	assert_false(background_thread_set(false),
+	    "Unexpected background_thread disable failure");
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_inline_purge,
+	    test_background_purge_only,
+	    test_background_purge_hint);
+}
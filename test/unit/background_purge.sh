@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="background_purge_only:true,dirty_decay_ms:0,muzzy_decay_ms:0"
@@ -0,0 +1,105 @@
+#include "test/jemalloc_test.h"
+
+#define NPTRS	64
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected arenas.create failure");
+	return arena_ind;
+}
+
+static void
+assert_zeroed(const char *p, size_t sz) {
+	for (size_t i = 0; i < sz; i++) {
+		assert_d_eq(p[i], 0, "Byte %zu/%zu isn't zero-filled", i, sz);
+	}
+}
+
+/*
+ * Zeroed allocations from fresh memory (which is zero-filled to begin with)
+ * are interleaved with dirty memory being reused, so that the tracking of
+ * which memory is known to be zero-filled gets exercised in both directions.
+ */
+static void
+calloc_reuse(size_t sz, int flags) {
+	char *ptrs[NPTRS];
+
+	for (unsigned i = 0; i < NPTRS; i++) {
+		ptrs[i] = (char *)mallocx(sz, flags | ((i % 3 == 0) ?
+		    MALLOCX_ZERO : 0));
+		assert_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+		if (i % 3 == 0) {
+			assert_zeroed(ptrs[i], sz);
+		}
+		memset(ptrs[i], 0xa5, sz);
+	}
+	for (unsigned i = 0; i < NPTRS; i += 2) {
+		dallocx(ptrs[i], flags);
+	}
+	for (unsigned i = 0; i < NPTRS; i += 2) {
+		ptrs[i] = (char *)mallocx(sz, flags | MALLOCX_ZERO);
+		assert_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+		assert_zeroed(ptrs[i], sz);
+		memset(ptrs[i], 0xa5, sz);
+	}
+	for (unsigned i = 0; i < NPTRS; i++) {
+		dallocx(ptrs[i], flags);
+	}
+}
+
+static void
+test_calloc_sizes(int flags) {
+	size_t sizes[] = {8, 48, 1024, 3 * 1024, SMALL_MAXCLASS,
+	    LARGE_MINCLASS, 3 * LARGE_MINCLASS};
+
+	for (unsigned i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+		calloc_reuse(sizes[i], flags);
+	}
+}
+
+TEST_BEGIN(test_calloc_tcache) {
+	test_calloc_sizes(MALLOCX_ARENA(arena_create()));
+}
+TEST_END
+
+TEST_BEGIN(test_calloc_no_tcache) {
+	test_calloc_sizes(MALLOCX_ARENA(arena_create()) | MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+TEST_BEGIN(test_calloc_purge_threshold) {
+	size_t threshold;
+	size_t sz = sizeof(threshold);
+	assert_d_eq(mallctl("opt.zero_purge_threshold", (void *)&threshold,
+	    &sz, NULL, 0), 0, "Unexpected mallctl() failure");
+	/* See calloc.sh. */
+	assert_zu_eq(threshold, ZU(1) << 20,
+	    "Unexpected opt.zero_purge_threshold");
+
+	/* Reused memory is zeroed via memset() below, purging above. */
+	int flags = MALLOCX_ARENA(arena_create()) | MALLOCX_TCACHE_NONE;
+	char *p = (char *)mallocx(threshold, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	memset(p, 0xa5, threshold);
+	dallocx(p, flags);
+	p = (char *)mallocx(threshold / 2, flags | MALLOCX_ZERO);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	assert_zeroed(p, threshold / 2);
+	dallocx(p, flags);
+	p = (char *)mallocx(threshold, flags | MALLOCX_ZERO);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	assert_zeroed(p, threshold);
+	dallocx(p, flags);
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_calloc_tcache,
+	    test_calloc_no_tcache,
+	    test_calloc_purge_threshold);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="zero_purge_threshold:1048576"
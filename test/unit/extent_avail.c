@@ -0,0 +1,199 @@
+#include "test/jemalloc_test.h"
+
+#define NITER		1000
+#define LARGE_SZ	(64 * 1024)
+
+static unsigned
+do_arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(unsigned);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+do_arena_destroy(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.destroy", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static unsigned
+do_thread_arena_set(unsigned arena_ind) {
+	unsigned old_arena_ind;
+	size_t sz = sizeof(unsigned);
+	assert_d_eq(mallctl("thread.arena", (void *)&old_arena_ind, &sz,
+	    (void *)&arena_ind, sizeof(arena_ind)), 0,
+	    "Unexpected mallctl() failure");
+	return old_arena_ind;
+}
+
+static uint64_t
+do_get_extent_avail_ops(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	size_t mib[6];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib(
+	    "stats.arenas.0.mutexes.extent_avail.num_ops", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[2] = (size_t)arena_ind;
+	uint64_t num_ops;
+	size_t sz = sizeof(num_ops);
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&num_ops, &sz, NULL, 0),
+	    0, "Unexpected mallctlbymib() failure");
+	return num_ops;
+}
+
+/* Each iteration splits an extent on allocation and merges it on free. */
+static void
+do_churn(unsigned arena_ind) {
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void *p = mallocx(LARGE_SZ, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	for (unsigned i = 0; i < NITER; i++) {
+		void *q = mallocx(LARGE_SZ, flags);
+		assert_ptr_not_null(q, "Unexpected mallocx() failure");
+		dallocx(q, flags);
+	}
+	dallocx(p, flags);
+}
+
+TEST_BEGIN(test_extent_avail_cached) {
+	test_skip_if(!config_stats);
+	test_skip_if(!opt_tcache);
+
+	unsigned arena_ind = do_arena_create();
+	unsigned old_arena_ind = do_thread_arena_set(arena_ind);
+
+	do_churn(arena_ind);
+	uint64_t num_ops = do_get_extent_avail_ops(arena_ind);
+	do_churn(arena_ind);
+	assert_u64_lt(do_get_extent_avail_ops(arena_ind) - num_ops, NITER / 10,
+	    "extent_t's should come from the thread's cache");
+
+	/* Switching arenas flushes the cache back to the arena's base. */
+	do_thread_arena_set(old_arena_ind);
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+static void *
+thd_start(void *arg) {
+	unsigned arena_ind = *(unsigned *)arg;
+	do_thread_arena_set(arena_ind);
+	do_churn(arena_ind);
+	return NULL;
+}
+
+TEST_BEGIN(test_extent_avail_thread_exit) {
+	unsigned arena_ind = do_arena_create();
+
+	thd_t thd;
+	thd_create(&thd, thd_start, (void *)&arena_ind);
+	thd_join(thd, NULL);
+
+	/* Exited threads must not keep extent_t's from the arena's base. */
+	do_arena_destroy(arena_ind);
+	arena_ind = do_arena_create();
+	do_churn(arena_ind);
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+/*
+ * Extent hooks that call malloc() from within the first alloc hook call after
+ * being armed, and record whether that touched the thread's extent cache.
+ */
+static extent_hooks_t *default_hooks;
+static extent_hooks_t reentrant_hooks;
+static bool reentrant_armed;
+static bool reentrant_called;
+static bool reentrant_cache_touched;
+
+static void *
+reentrant_alloc_hook(extent_hooks_t *extent_hooks, void *new_addr,
+    size_t size, size_t alignment, bool *zero, bool *commit,
+    unsigned arena_ind) {
+	if (reentrant_armed) {
+		reentrant_armed = false;
+		tcache_t *tcache = tsd_tcachep_get(tsd_fetch());
+		unsigned nextents_avail = tcache->nextents_avail;
+		void *p = malloc(LARGE_SZ);
+		assert_ptr_not_null(p, "Unexpected malloc() failure");
+		free(p);
+		reentrant_cache_touched = (tcache->nextents_avail !=
+		    nextents_avail);
+		reentrant_called = true;
+	}
+	return default_hooks->alloc(default_hooks, new_addr, size, alignment,
+	    zero, commit, arena_ind);
+}
+
+TEST_BEGIN(test_extent_avail_reentrant) {
+	test_skip_if(!opt_tcache);
+
+	unsigned arena_ind = do_arena_create();
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.extent_hooks", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	size_t sz = sizeof(default_hooks);
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&default_hooks, &sz,
+	    NULL, 0), 0, "Unexpected mallctlbymib() failure");
+	reentrant_hooks = *default_hooks;
+	reentrant_hooks.alloc = reentrant_alloc_hook;
+	extent_hooks_t *new_hooks = &reentrant_hooks;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, (void *)&new_hooks,
+	    sizeof(new_hooks)), 0, "Unexpected mallctlbymib() failure");
+	unsigned old_arena_ind = do_thread_arena_set(arena_ind);
+
+	/*
+	 * Take extent_t's until the cache has to be refilled from a new base
+	 * block, whose allocation calls the hook.  A nested malloc() in the
+	 * same arena must not refill the cache underneath the outer refill.
+	 */
+	tsdn_t *tsdn = tsdn_fetch();
+	arena_t *arena = arena_get(tsdn, arena_ind, false);
+	unsigned nextents_max = 64 * 1024;
+	extent_t **extents = (extent_t **)mallocx(nextents_max *
+	    sizeof(extent_t *), MALLOCX_TCACHE_NONE);
+	assert_ptr_not_null(extents, "Unexpected mallocx() failure");
+	unsigned nextents;
+	reentrant_called = false;
+	reentrant_armed = true;
+	for (nextents = 0; nextents < nextents_max && !reentrant_called;
+	    nextents++) {
+		extents[nextents] = extent_alloc(tsdn, arena);
+		assert_ptr_not_null(extents[nextents],
+		    "Unexpected extent_alloc() failure");
+	}
+	reentrant_armed = false;
+	assert_true(reentrant_called, "Base should have needed a new block");
+	assert_false(reentrant_cache_touched,
+	    "Reentrant allocation should bypass the extent cache");
+	for (unsigned i = 0; i < nextents; i++) {
+		extent_dalloc(tsdn, arena, extents[i]);
+	}
+	dallocx(extents, MALLOCX_TCACHE_NONE);
+
+	do_thread_arena_set(old_arena_ind);
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_extent_avail_cached,
+	    test_extent_avail_thread_exit,
+	    test_extent_avail_reentrant);
+}
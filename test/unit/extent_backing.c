@@ -0,0 +1,227 @@
+#include "test/jemalloc_test.h"
+
+#ifndef _WIN32
+#  include <sys/stat.h>
+#  include <sys/wait.h>
+#endif
+
+static int
+arena_create_backed(const char *backing, unsigned *r_arena_ind) {
+	size_t sz = sizeof(unsigned);
+	return mallctl("arenas.create_backed", (void *)r_arena_ind, &sz,
+	    (void *)&backing, sizeof(backing));
+}
+
+static void
+backed_arena_destroy(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.destroy", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static void
+backing_check(unsigned arena_ind) {
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	size_t sizes[] = {8, 1024, 16 * 1024, 1024 * 1024};
+
+	for (unsigned i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+		size_t sz = sizes[i];
+		char *p = (char *)mallocx(sz, flags);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		memset(p, 0xa5, sz);
+		dallocx(p, flags);
+
+		/* Recycled memory must still be zeroed when requested. */
+		p = (char *)mallocx(sz, flags | MALLOCX_ZERO);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		for (size_t j = 0; j < sz; j++) {
+			assert_d_eq(p[j], 0, "Memory not zeroed");
+		}
+		dallocx(p, flags);
+	}
+
+	/* Force purging, which punches holes into backing files. */
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.purge", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+
+	char *p = (char *)mallocx(1024 * 1024, flags | MALLOCX_ZERO);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	for (size_t j = 0; j < 1024 * 1024; j++) {
+		assert_d_eq(p[j], 0, "Memory not zeroed");
+	}
+	dallocx(p, flags);
+}
+
+TEST_BEGIN(test_backing_invalid) {
+	const char *invalid[] = {"", "bogus", "file:", "hugetlb:",
+	    "hugetlb:3K", "hugetlb:2X", "hugetlbfoo",
+	    "file:/nonexistent/jemalloc/backing"};
+	unsigned arena_ind;
+
+	for (unsigned i = 0; i < sizeof(invalid) / sizeof(const char *); i++) {
+		assert_d_eq(arena_create_backed(invalid[i], &arena_ind), EINVAL,
+		    "Backing \"%s\" should be rejected", invalid[i]);
+	}
+	size_t sz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create_backed", (void *)&arena_ind, &sz,
+	    NULL, 0), EINVAL, "A backing must be specified");
+}
+TEST_END
+
+TEST_BEGIN(test_backing_anonymous) {
+	unsigned arena_ind;
+	assert_d_eq(arena_create_backed("anonymous", &arena_ind), 0,
+	    "Unexpected arenas.create_backed failure");
+	backing_check(arena_ind);
+	backed_arena_destroy(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_backing_file) {
+#ifdef _WIN32
+	test_skip("File backings not supported");
+#else
+	char path[] = "/tmp/jemalloc_test_backing.XXXXXX";
+	int fd = mkstemp(path);
+	test_skip_if(fd == -1);
+	close(fd);
+
+	char backing[64];
+	malloc_snprintf(backing, sizeof(backing), "file:%s", path);
+	unsigned arena_ind;
+	int err = arena_create_backed(backing, &arena_ind);
+	if (err != 0) {
+		unlink(path);
+	}
+	assert_d_eq(err, 0, "Unexpected arenas.create_backed failure");
+
+	backing_check(arena_ind);
+	struct stat st;
+	assert_d_eq(stat(path, &st), 0, "Unexpected stat() failure");
+	assert_d_gt(st.st_size, 0, "Memory should be backed by the file");
+
+	backed_arena_destroy(arena_ind);
+	unlink(path);
+#endif
+}
+TEST_END
+
+TEST_BEGIN(test_backing_tmpfile) {
+	unsigned arena_ind;
+	/* O_TMPFILE support depends on the file system. */
+	test_skip_if(arena_create_backed("file:/tmp", &arena_ind) != 0);
+	backing_check(arena_ind);
+	backed_arena_destroy(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_backing_destroy) {
+	unsigned arena_ind;
+	/* O_TMPFILE support depends on the file system. */
+	test_skip_if(arena_create_backed("file:/tmp", &arena_ind) != 0);
+	backed_arena_destroy(arena_ind);
+
+	/*
+	 * Destroying an arena releases its reservation, so this must not run
+	 * out of address space.
+	 */
+	for (unsigned i = 0; i < 256; i++) {
+		assert_d_eq(arena_create_backed("file:/tmp", &arena_ind), 0,
+		    "Unexpected arenas.create_backed failure");
+		void *p = mallocx(1, MALLOCX_ARENA(arena_ind) |
+		    MALLOCX_TCACHE_NONE);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, MALLOCX_TCACHE_NONE);
+		backed_arena_destroy(arena_ind);
+	}
+}
+TEST_END
+
+TEST_BEGIN(test_backing_hugetlb) {
+	unsigned arena_ind;
+	/* Huge pages have to be configured by the administrator. */
+	test_skip_if(arena_create_backed("hugetlb", &arena_ind) != 0);
+	backing_check(arena_ind);
+	backed_arena_destroy(arena_ind);
+}
+TEST_END
+
+static uint64_t
+large_mutex_num_ops_get(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd),
+	    "stats.arenas.%u.mutexes.large.num_ops", arena_ind);
+	uint64_t num_ops;
+	size_t sz = sizeof(num_ops);
+	assert_d_eq(mallctl(cmd, (void *)&num_ops, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return num_ops;
+}
+
+TEST_BEGIN(test_backing_fork) {
+#ifdef _WIN32
+	test_skip("fork(2) not supported");
+#else
+	test_skip_if(!config_stats);
+	unsigned arena_ind;
+	/* O_TMPFILE support depends on the file system. */
+	test_skip_if(arena_create_backed("file:/tmp", &arena_ind) != 0);
+
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	for (unsigned i = 0; i < 8; i++) {
+		void *p = mallocx(1024 * 1024, flags);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, flags);
+	}
+	uint64_t num_ops = large_mutex_num_ops_get(arena_ind);
+	assert_u64_gt(num_ops, 0, "Large mutex should have been used");
+
+	/*
+	 * The child reinitializes the arena's mutexes; that must not reach the
+	 * parent through the shared file mapping.
+	 */
+	pid_t pid = fork();
+	if (pid == -1) {
+		test_fail("Unexpected fork() failure");
+	} else if (pid == 0) {
+		_exit(0);
+	}
+	int status;
+	assert_d_eq(waitpid(pid, &status, 0), pid,
+	    "Unexpected waitpid() failure");
+	assert_true(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+	    "Unexpected child termination");
+
+	assert_u64_ge(large_mutex_num_ops_get(arena_ind), num_ops,
+	    "Parent's arena metadata was modified by the child");
+	backing_check(arena_ind);
+	backed_arena_destroy(arena_ind);
+#endif
+}
+TEST_END
+
+int
+main(void) {
+	/* Backing files are opened with ctl_mtx held. */
+	return test_no_reentrancy(
+	    test_backing_invalid,
+	    test_backing_anonymous,
+	    test_backing_file,
+	    test_backing_tmpfile,
+	    test_backing_destroy,
+	    test_backing_hugetlb,
+	    test_backing_fork);
+}
@@ -0,0 +1,118 @@
+#include "test/jemalloc_test.h"
+
+static bool
+opt_extent_fit_segregated(void) {
+	const char *extent_fit;
+	size_t sz = sizeof(extent_fit);
+	assert_d_eq(mallctl("opt.extent_fit", (void *)&extent_fit, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+	return strcmp(extent_fit, "segregated") == 0;
+}
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected arenas.create failure");
+	return arena_ind;
+}
+
+static void *
+base_get(void *ptr) {
+	return (void *)PAGE_ADDR2BASE(ptr);
+}
+
+TEST_BEGIN(test_extent_fit_smallest) {
+	test_skip_if(!opt_extent_fit_segregated());
+
+	int flags = MALLOCX_ARENA(arena_create()) | MALLOCX_TCACHE_NONE;
+	size_t small = PAGE << 3;
+	size_t head = LARGE_MINCLASS;
+	size_t trail = small + (PAGE << 1);
+	/*
+	 * Large size classes map to distinct extent size classes, so the larger
+	 * extent is the trail split off by shrinking an allocation in place.
+	 */
+	test_skip_if(extent_size_quantize_floor(trail) !=
+	    extent_size_quantize_floor(small + sz_large_pad));
+
+	/*
+	 * Free a larger extent, then a smaller one at a higher address, both in
+	 * the same size class.  Best fit returns whichever extent is handy
+	 * (here the one freed last), whereas segregated fit must return the
+	 * lowest one, even though it is the larger of the two.  Separators
+	 * prevent the freed extents from coalescing.
+	 */
+	void *sep0 = mallocx(small, flags);
+	void *p_big = mallocx(head + trail, flags);
+	void *sep1 = mallocx(small, flags);
+	void *p_small = mallocx(small, flags);
+	void *sep2 = mallocx(small, flags);
+	assert_true(sep0 != NULL && p_big != NULL && sep1 != NULL && p_small !=
+	    NULL && sep2 != NULL, "Unexpected mallocx() failure");
+	assert_true((uintptr_t)p_big < (uintptr_t)p_small,
+	    "Expected the larger extent at the lower address");
+	void *p_trail = (void *)((uintptr_t)base_get(p_big) + head +
+	    sz_large_pad);
+
+	assert_zu_eq(xallocx(p_big, head, 0, flags), head,
+	    "Unexpected xallocx() failure");
+	dallocx(p_small, flags);
+	void *p = mallocx(small, flags);
+	assert_ptr_eq(base_get(p), p_trail,
+	    "Expected reuse of the lowest extent in the smallest size class");
+	void *q = mallocx(small, flags);
+	assert_ptr_eq(base_get(q), base_get(p_small),
+	    "Expected reuse of the remaining extent");
+
+	dallocx(p, flags);
+	dallocx(q, flags);
+	dallocx(p_big, flags);
+	dallocx(sep0, flags);
+	dallocx(sep1, flags);
+	dallocx(sep2, flags);
+}
+TEST_END
+
+TEST_BEGIN(test_extent_fit_aligned) {
+	test_skip_if(!opt_extent_fit_segregated());
+
+	unsigned arena_ind = arena_create();
+
+	for (size_t alignment = PAGE << 1; alignment <= (PAGE << 6);
+	    alignment <<= 1) {
+		int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE |
+		    MALLOCX_ALIGN(alignment);
+		size_t size = LARGE_MINCLASS > alignment ? LARGE_MINCLASS :
+		    alignment;
+
+		void *p = mallocx(size, flags);
+		void *sep = mallocx(size, flags);
+		assert_true(p != NULL && sep != NULL,
+		    "Unexpected mallocx() failure");
+		assert_zu_eq((uintptr_t)p & (alignment - 1), 0,
+		    "Insufficiently aligned allocation");
+
+		/*
+		 * The freed extent is suitably aligned already, so it is reused
+		 * even though it is smaller than size + alignment - PAGE.
+		 */
+		dallocx(p, flags);
+		void *q = mallocx(size, flags);
+		assert_ptr_eq(q, p,
+		    "Expected reuse of the aligned extent, alignment=%zu",
+		    alignment);
+
+		dallocx(q, flags);
+		dallocx(sep, flags);
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_extent_fit_smallest,
+	    test_extent_fit_aligned);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="extent_fit:segregated"
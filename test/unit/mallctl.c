@@ -134,6 +134,8 @@ TEST_BEGIN(test_mallctl_config) {
 	TEST_MALLCTL_CONFIG(prof, bool);
 	TEST_MALLCTL_CONFIG(prof_libgcc, bool);
 	TEST_MALLCTL_CONFIG(prof_libunwind, bool);
+	TEST_MALLCTL_CONFIG(rtree_ctx_stats, bool);
+	TEST_MALLCTL_CONFIG(rtree_flat, bool);
 	TEST_MALLCTL_CONFIG(stats, bool);
 	TEST_MALLCTL_CONFIG(utrace, bool);
 	TEST_MALLCTL_CONFIG(xmalloc, bool);
@@ -158,10 +160,17 @@ TEST_BEGIN(test_mallctl_opt) {
 
 	TEST_MALLCTL_OPT(bool, abort, always);
 	TEST_MALLCTL_OPT(bool, retain, always);
+	TEST_MALLCTL_OPT(size_t, retain_grow_limit, always);
+	TEST_MALLCTL_OPT(size_t, reserve_vm, always);
 	TEST_MALLCTL_OPT(const char *, dss, always);
+	TEST_MALLCTL_OPT(const char *, extent_fit, always);
+	TEST_MALLCTL_OPT(size_t, zero_purge_threshold, always);
+	TEST_MALLCTL_OPT(const char *, thp_policy, always);
 	TEST_MALLCTL_OPT(unsigned, narenas, always);
 	TEST_MALLCTL_OPT(const char *, percpu_arena, always);
+	TEST_MALLCTL_OPT(const char *, prefault, always);
 	TEST_MALLCTL_OPT(bool, background_thread, always);
+	TEST_MALLCTL_OPT(bool, background_purge_only, always);
 	TEST_MALLCTL_OPT(ssize_t, dirty_decay_ms, always);
 	TEST_MALLCTL_OPT(ssize_t, muzzy_decay_ms, always);
 	TEST_MALLCTL_OPT(bool, stats_print, always);
@@ -169,8 +178,11 @@ TEST_BEGIN(test_mallctl_opt) {
 	TEST_MALLCTL_OPT(bool, zero, fill);
 	TEST_MALLCTL_OPT(bool, utrace, utrace);
 	TEST_MALLCTL_OPT(bool, xmalloc, xmalloc);
+	TEST_MALLCTL_OPT(bool, rtree_flat, rtree_flat);
+	TEST_MALLCTL_OPT(bool, sized_dealloc_check, always);
 	TEST_MALLCTL_OPT(bool, tcache, always);
 	TEST_MALLCTL_OPT(size_t, lg_tcache_max, always);
+	TEST_MALLCTL_OPT(size_t, tcache_gc_incr_bytes, always);
 	TEST_MALLCTL_OPT(bool, prof, prof);
 	TEST_MALLCTL_OPT(const char *, prof_prefix, prof);
 	TEST_MALLCTL_OPT(bool, prof_active, prof);
@@ -325,6 +337,48 @@ TEST_BEGIN(test_tcache) {
 }
 TEST_END
 
+static uint64_t
+thread_rtree_cache_get(const char *name) {
+	uint64_t count;
+	size_t sz = sizeof(uint64_t);
+
+	assert_d_eq(mallctl(name, (void *)&count, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return count;
+}
+
+static uint64_t
+thread_rtree_cache_lookups(void) {
+	return thread_rtree_cache_get("thread.rtree_cache.l1_hits") +
+	    thread_rtree_cache_get("thread.rtree_cache.l2_hits") +
+	    thread_rtree_cache_get("thread.rtree_cache.misses");
+}
+
+TEST_BEGIN(test_thread_rtree_cache) {
+	/* The flat leaf array bypasses the cache. */
+	test_skip_if(!config_rtree_ctx_stats ||
+	    rtree_flat_enabled(&extents_rtree));
+
+	uint64_t before = thread_rtree_cache_lookups();
+	void *p = mallocx(1, MALLOCX_TCACHE_NONE);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, MALLOCX_TCACHE_NONE);
+	assert_u64_gt(thread_rtree_cache_lookups(), before,
+	    "Deallocation should look up the rtree");
+
+	/* Lookups on the free() fast path are counted too. */
+	p = malloc(1);
+	assert_ptr_not_null(p, "Unexpected malloc() failure");
+	free(p);
+	p = malloc(1);
+	assert_ptr_not_null(p, "Unexpected malloc() failure");
+	before = thread_rtree_cache_get("thread.rtree_cache.l1_hits");
+	free(p);
+	assert_u64_gt(thread_rtree_cache_get("thread.rtree_cache.l1_hits"),
+	    before, "Fast path deallocation should hit the L1 cache");
+}
+TEST_END
+
 TEST_BEGIN(test_thread_arena) {
 	unsigned old_arena_ind, new_arena_ind, narenas;
 
@@ -718,6 +772,7 @@ main(void) {
 	    test_manpage_example,
 	    test_tcache_none,
 	    test_tcache,
+	    test_thread_rtree_cache,
 	    test_thread_arena,
 	    test_arena_i_initialized,
 	    test_arena_i_dirty_decay_ms,
@@ -0,0 +1,44 @@
+#include "test/jemalloc_test.h"
+
+/*
+ * The malloc() fast path is only reachable with junk filling disabled (see
+ * malloc_fastpath.sh), since opt.junk forces malloc_slow.
+ */
+
+TEST_BEGIN(test_malloc_zero) {
+	unsigned i;
+
+	/* The first call fills the tcache bin; later ones hit the fast path. */
+	for (i = 0; i < 16; i++) {
+		void *p = malloc(0);
+		assert_ptr_not_null(p, "Unexpected malloc(0) failure");
+		assert_zu_eq(malloc_usable_size(p), sz_s2u(1),
+		    "malloc(0) should be served from the smallest size class");
+		free(p);
+	}
+}
+TEST_END
+
+TEST_BEGIN(test_malloc_small_boundary) {
+	size_t sizes[] = {1, SMALL_MAXCLASS - 1, SMALL_MAXCLASS,
+	    SMALL_MAXCLASS + 1};
+	unsigned i, j;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+		for (j = 0; j < 16; j++) {
+			void *p = malloc(sizes[i]);
+			assert_ptr_not_null(p, "Unexpected malloc() failure");
+			assert_zu_eq(malloc_usable_size(p), sz_s2u(sizes[i]),
+			    "Unexpected usable size for size=%zu", sizes[i]);
+			free(p);
+		}
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_malloc_zero,
+	    test_malloc_small_boundary);
+}
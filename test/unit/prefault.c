@@ -0,0 +1,146 @@
+#include "test/jemalloc_test.h"
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected arenas.create failure");
+	return arena_ind;
+}
+
+static void
+prefault_set(unsigned arena_ind, const char *prefault) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.prefault", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, (void *)&prefault,
+	    sizeof(prefault)), 0, "Unexpected mallctlbymib() failure");
+}
+
+static uint64_t
+arena_stat_get(unsigned arena_ind, const char *name, size_t sz) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	size_t mib[4];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib(name, mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[2] = arena_ind;
+	union {
+		size_t zu;
+		uint64_t u64;
+	} val;
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+	return sz == sizeof(uint64_t) ? val.u64 : val.zu;
+}
+
+TEST_BEGIN(test_arena_i_prefault) {
+	unsigned arena_ind = arena_create();
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.prefault", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = arena_ind;
+
+	const char *opt_prefault, *prefault_old, *prefault_new;
+	size_t sz = sizeof(const char *);
+	assert_d_eq(mallctl("opt.prefault", (void *)&opt_prefault, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+	prefault_new = "populate";
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&prefault_old, &sz,
+	    (void *)&prefault_new, sizeof(prefault_new)), 0,
+	    "Unexpected mallctlbymib() failure");
+	assert_str_eq(prefault_old, opt_prefault,
+	    "New arenas should use opt.prefault");
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&prefault_old, &sz, NULL,
+	    0), 0, "Unexpected mallctlbymib() failure");
+	assert_str_eq(prefault_old, "populate", "Unexpected prefault mode");
+
+	prefault_new = "invalid";
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL,
+	    (void *)&prefault_new, sizeof(prefault_new)), EINVAL,
+	    "Unexpected success for invalid prefault mode");
+
+	/* MALLCTL_ARENAS_ALL sets existing arenas and the default for new ones. */
+	mib[1] = MALLCTL_ARENAS_ALL;
+	prefault_new = "disabled";
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&prefault_old, &sz,
+	    (void *)&prefault_new, sizeof(prefault_new)), 0,
+	    "Unexpected mallctlbymib() failure");
+	assert_str_eq(prefault_old, opt_prefault,
+	    "Default prefault mode should be opt.prefault");
+	mib[1] = arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&prefault_old, &sz, NULL,
+	    0), 0, "Unexpected mallctlbymib() failure");
+	assert_str_eq(prefault_old, "disabled",
+	    "Existing arenas should be updated");
+	mib[1] = arena_create();
+	assert_d_eq(mallctlbymib(mib, miblen, (void *)&prefault_old, &sz, NULL,
+	    0), 0, "Unexpected mallctlbymib() failure");
+	assert_str_eq(prefault_old, "disabled",
+	    "New arenas should use the updated default");
+	mib[1] = MALLCTL_ARENAS_ALL;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, (void *)&opt_prefault,
+	    sizeof(opt_prefault)), 0, "Unexpected mallctlbymib() failure");
+}
+TEST_END
+
+/* Returns the locked memory of the process in kB, or 0 if unknown. */
+static void
+test_prefault_mode(const char *prefault) {
+	unsigned arena_ind = arena_create();
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	size_t size = 1 << 20;
+
+	prefault_set(arena_ind, prefault);
+	/* Would otherwise purge all pages as soon as they become dirty. */
+	ssize_t decay_ms = 0;
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.dirty_decay_ms", mib, &miblen),
+	    0, "Unexpected mallctlnametomib() failure");
+	mib[1] = arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, (void *)&decay_ms,
+	    sizeof(decay_ms)), 0, "Unexpected mallctlbymib() failure");
+
+	void *p = mallocx(size, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	memset(p, 0xa5, size);
+	if (config_stats) {
+		assert_u64_ge(arena_stat_get(arena_ind,
+		    "stats.arenas.0.prefaulted", sizeof(uint64_t)), size,
+		    "Allocation should have been prefaulted");
+	}
+
+	dallocx(p, flags);
+	assert_zu_gt(arena_stat_get(arena_ind, "stats.arenas.0.pdirty",
+	    sizeof(size_t)), 0, "Prefaulted pages should not be decayed");
+
+	/* Explicit purging still applies. */
+	miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.purge", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+	assert_zu_eq(arena_stat_get(arena_ind, "stats.arenas.0.pdirty",
+	    sizeof(size_t)), 0, "Unexpected dirty pages after purge");
+}
+
+TEST_BEGIN(test_prefault_populate) {
+	test_prefault_mode("populate");
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_arena_i_prefault,
+	    test_prefault_populate);
+}
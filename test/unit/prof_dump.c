@@ -0,0 +1,202 @@
+#include "test/jemalloc_test.h"
+
+#define NALLOCS	16
+
+static int
+prof_dump_open_intercept(bool propagate_err, const char *filename) {
+	int fd;
+
+	fd = open("/dev/null", O_WRONLY);
+	assert_d_ne(fd, -1, "Unexpected open() failure");
+
+	return fd;
+}
+
+static uint64_t
+get_dump_bytes(void) {
+	uint64_t nbytes;
+	size_t sz = sizeof(nbytes);
+
+	assert_d_eq(mallctl("prof.dump_bytes", (void *)&nbytes, &sz, NULL, 0),
+	    0, "Unexpected mallctl failure");
+	return nbytes;
+}
+
+static void
+do_dump(void) {
+	assert_d_eq(mallctl("prof.dump", NULL, NULL, NULL, 0), 0,
+	    "Unexpected error while dumping heap profile");
+}
+
+TEST_BEGIN(test_prof_dump_stats) {
+	bool active;
+	void *ps[NALLOCS];
+	uint64_t duration, nbytes, nbytes_prev;
+	size_t sz;
+	unsigned i;
+
+	test_skip_if(!config_prof);
+
+	active = true;
+	assert_d_eq(mallctl("prof.active", NULL, NULL, (void *)&active,
+	    sizeof(active)), 0,
+	    "Unexpected mallctl failure while activating profiling");
+
+	prof_dump_open = prof_dump_open_intercept;
+
+	ps[0] = btalloc(1, 0);
+	assert_ptr_not_null(ps[0], "Unexpected btalloc() failure");
+	do_dump();
+	nbytes_prev = get_dump_bytes();
+	assert_u64_gt(nbytes_prev, 0, "Expected non-empty profile dump");
+
+	sz = sizeof(duration);
+	assert_d_eq(mallctl("prof.dump_duration", (void *)&duration, &sz, NULL,
+	    0), 0, "Unexpected mallctl failure");
+	assert_d_eq(mallctl("prof.dump_duration", NULL, NULL,
+	    (void *)&duration, sizeof(duration)), EPERM,
+	    "prof.dump_duration should be read-only");
+
+	/* Live objects with distinct backtraces must enlarge the dump. */
+	for (i = 1; i < NALLOCS; i++) {
+		ps[i] = btalloc(1, i);
+		assert_ptr_not_null(ps[i], "Unexpected btalloc() failure");
+	}
+	do_dump();
+	nbytes = get_dump_bytes();
+	assert_u64_gt(nbytes, nbytes_prev,
+	    "Expected dump size to grow with the number of backtraces");
+
+	for (i = 0; i < NALLOCS; i++) {
+		dallocx(ps[i], 0);
+	}
+}
+TEST_END
+
+static char diff_path[] = "/tmp/prof_dump_diff.XXXXXX";
+static int diff_fd = -1;
+
+static int
+prof_dump_open_diff_intercept(bool propagate_err, const char *filename) {
+	int fd;
+
+	assert_d_ne(diff_fd, -1, "Diff file should have been created");
+	assert_d_eq(ftruncate(diff_fd, 0), 0, "Unexpected ftruncate() failure");
+	fd = dup(diff_fd);
+	assert_d_ne(fd, -1, "Unexpected dup() failure");
+	assert_d_eq(lseek(fd, 0, SEEK_SET), 0, "Unexpected lseek() failure");
+
+	return fd;
+}
+
+/*
+ * Dumps a diff profile, and returns the number of backtraces in it, after
+ * verifying that they are sorted by decreasing growth.
+ */
+static unsigned
+do_dump_diff(size_t threshold) {
+	char buf[64 * 1024];
+	ssize_t nread;
+	unsigned nbts = 0;
+	unsigned long long bytes;
+	uint64_t bytes_prev = UINT64_MAX;
+	const char *s;
+
+	assert_d_eq(mallctl("prof.dump_diff_threshold", NULL, NULL,
+	    (void *)&threshold, sizeof(threshold)), 0,
+	    "Unexpected mallctl failure");
+	assert_d_eq(mallctl("prof.dump_diff", NULL, NULL, NULL, 0), 0,
+	    "Unexpected error while dumping diff profile");
+
+	nread = pread(diff_fd, buf, sizeof(buf) - 1, 0);
+	assert_zd_gt(nread, 0, "Expected non-empty diff profile");
+	buf[nread] = '\0';
+	assert_d_eq(strncmp(buf, "heap_v2/", strlen("heap_v2/")), 0,
+	    "Unexpected diff profile header");
+
+	for (s = strstr(buf, "\n@"); s != NULL; s = strstr(s + 1, "\n@")) {
+		const char *cnts = strstr(s + 1, "\n  t*: ");
+
+		assert_ptr_not_null((void *)cnts, "Expected backtrace counters");
+		assert_d_eq(sscanf(cnts, "\n  t*: %*u: %llu", &bytes), 1,
+		    "Unexpected backtrace counters format");
+		assert_u64_gt((uint64_t)bytes, threshold,
+		    "Backtrace growth should exceed the threshold");
+		assert_u64_le((uint64_t)bytes, bytes_prev,
+		    "Backtraces should be sorted by decreasing growth");
+		bytes_prev = bytes;
+		nbts++;
+	}
+	return nbts;
+}
+
+static void *
+alloc_diff(size_t size) {
+	void *p = mallocx(size, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	return p;
+}
+
+TEST_BEGIN(test_prof_dump_diff) {
+	bool active;
+	void *ps[NALLOCS], *small, *large[2];
+	unsigned i;
+
+	test_skip_if(!config_prof);
+
+	active = true;
+	assert_d_eq(mallctl("prof.active", NULL, NULL, (void *)&active,
+	    sizeof(active)), 0,
+	    "Unexpected mallctl failure while activating profiling");
+
+	diff_fd = mkstemp(diff_path);
+	assert_d_ne(diff_fd, -1, "Unexpected mkstemp() failure");
+	unlink(diff_path);
+	prof_dump_open = prof_dump_open_diff_intercept;
+
+	for (i = 0; i < NALLOCS; i++) {
+		ps[i] = btalloc(1, i);
+		assert_ptr_not_null(ps[i], "Unexpected btalloc() failure");
+	}
+	assert_d_eq(mallctl("prof.dump_baseline", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+	assert_u_eq(do_dump_diff(0), 0,
+	    "Objects live at baseline time should not be reported");
+
+	/* Two backtraces with different growth. */
+	small = alloc_diff(4096);
+	for (i = 0; i < 2; i++) {
+		large[i] = alloc_diff(8192);
+	}
+	assert_u_eq(do_dump_diff(0), 2, "Expected two grown backtraces");
+	assert_u_eq(do_dump_diff(4096), 1,
+	    "Expected only growth above the threshold to be reported");
+	assert_u_eq(do_dump_diff(16384), 0,
+	    "Expected no growth above the threshold");
+
+	/* Freeing objects that predate the baseline is not growth. */
+	for (i = 0; i < NALLOCS; i++) {
+		dallocx(ps[i], 0);
+	}
+	assert_u_eq(do_dump_diff(0), 2, "Expected two grown backtraces");
+
+	/* A new baseline absorbs the growth. */
+	assert_d_eq(mallctl("prof.dump_baseline", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+	assert_u_eq(do_dump_diff(0), 0, "Expected no growth since baseline");
+
+	dallocx(small, 0);
+	for (i = 0; i < 2; i++) {
+		dallocx(large[i], 0);
+	}
+	close(diff_fd);
+	diff_fd = -1;
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_prof_dump_stats,
+	    test_prof_dump_diff);
+}
@@ -0,0 +1,211 @@
+#include "test/jemalloc_test.h"
+
+#define MOCK_BT_LEN	3
+
+static void *mock_bt[MOCK_BT_LEN] = {
+	(void *)(uintptr_t)0x1000,
+	(void *)(uintptr_t)0x2000,
+	(void *)(uintptr_t)0x3000
+};
+static unsigned mock_bt_calls;
+
+static void
+mock_bt_hook(void **vec, unsigned *len, unsigned max_len) {
+	assert_u_eq(*len, 0, "Backtrace length should start out as 0");
+	assert_u_ge(max_len, MOCK_BT_LEN, "Unexpectedly small max_len");
+	memcpy(vec, mock_bt, sizeof(mock_bt));
+	*len = MOCK_BT_LEN;
+	mock_bt_calls++;
+}
+
+static void *sample_ptr;
+static size_t sample_size;
+static unsigned sample_calls;
+static bool sample_bt_matched;
+
+static void
+mock_sample_hook(const void *ptr, size_t size, void **backtrace,
+    unsigned backtrace_length) {
+	sample_ptr = (void *)ptr;
+	sample_size = size;
+	sample_bt_matched = (backtrace_length == MOCK_BT_LEN &&
+	    memcmp(backtrace, mock_bt, sizeof(mock_bt)) == 0);
+	sample_calls++;
+}
+
+static void *sample_free_ptr;
+static size_t sample_free_size;
+static unsigned sample_free_calls;
+
+static void
+mock_sample_free_hook(const void *ptr, size_t size) {
+	sample_free_ptr = (void *)ptr;
+	sample_free_size = size;
+	sample_free_calls++;
+}
+
+static char dump_filename[PATH_MAX + 1];
+static unsigned dump_calls;
+
+static void
+mock_dump_hook(const char *filename) {
+	strncpy(dump_filename, filename, sizeof(dump_filename) - 1);
+	dump_calls++;
+}
+
+static int
+prof_dump_open_intercept(bool propagate_err, const char *filename) {
+	int fd;
+
+	fd = open("/dev/null", O_WRONLY);
+	assert_d_ne(fd, -1, "Unexpected open() failure");
+
+	return fd;
+}
+
+TEST_BEGIN(test_prof_backtrace_hook) {
+	prof_backtrace_hook_t default_hook, hook;
+	size_t sz;
+
+	test_skip_if(!config_prof);
+
+	sz = sizeof(default_hook);
+	assert_d_eq(mallctl("experimental.hooks.prof_backtrace",
+	    (void *)&default_hook, &sz, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+	assert_ptr_not_null((void *)default_hook,
+	    "Default backtrace hook should be set");
+
+	hook = NULL;
+	assert_d_eq(mallctl("experimental.hooks.prof_backtrace", NULL, NULL,
+	    (void *)&hook, sizeof(hook)), EINVAL,
+	    "NULL backtrace hook should be rejected");
+
+	hook = mock_bt_hook;
+	assert_d_eq(mallctl("experimental.hooks.prof_backtrace", NULL, NULL,
+	    (void *)&hook, sizeof(hook)), 0, "Unexpected mallctl failure");
+
+	unsigned calls = mock_bt_calls;
+	void *p = mallocx(1, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	assert_u_eq(mock_bt_calls, calls + 1,
+	    "Backtrace hook should be called for sampled allocations");
+	dallocx(p, 0);
+
+	/* Restore the default, retrieving the mock in the process. */
+	sz = sizeof(hook);
+	assert_d_eq(mallctl("experimental.hooks.prof_backtrace",
+	    (void *)&hook, &sz, (void *)&default_hook, sizeof(default_hook)),
+	    0, "Unexpected mallctl failure");
+	assert_ptr_eq((void *)hook, (void *)mock_bt_hook,
+	    "Unexpected backtrace hook");
+}
+TEST_END
+
+TEST_BEGIN(test_prof_sample_hooks) {
+	prof_backtrace_hook_t default_bt_hook, bt_hook;
+	prof_sample_hook_t sample_hook;
+	prof_sample_free_hook_t sample_free_hook;
+	size_t sz;
+
+	test_skip_if(!config_prof);
+
+	bt_hook = mock_bt_hook;
+	sz = sizeof(default_bt_hook);
+	assert_d_eq(mallctl("experimental.hooks.prof_backtrace",
+	    (void *)&default_bt_hook, &sz, (void *)&bt_hook, sizeof(bt_hook)),
+	    0, "Unexpected mallctl failure");
+	sample_hook = mock_sample_hook;
+	assert_d_eq(mallctl("experimental.hooks.prof_sample", NULL, NULL,
+	    (void *)&sample_hook, sizeof(sample_hook)), 0,
+	    "Unexpected mallctl failure");
+	sample_free_hook = mock_sample_free_hook;
+	assert_d_eq(mallctl("experimental.hooks.prof_sample_free", NULL, NULL,
+	    (void *)&sample_free_hook, sizeof(sample_free_hook)), 0,
+	    "Unexpected mallctl failure");
+
+	void *p = mallocx(100, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	assert_u_eq(sample_calls, 1, "Sample hook should have been called");
+	assert_ptr_eq(sample_ptr, p, "Unexpected sampled pointer");
+	assert_zu_eq(sample_size, sallocx(p, 0), "Unexpected sampled size");
+	assert_true(sample_bt_matched,
+	    "Sample hook should see the captured backtrace");
+
+	/* Moving reallocation: the old object is released first. */
+	size_t psize = sallocx(p, 0);
+	void *q = rallocx(p, 1 << 20, 0);
+	assert_ptr_not_null(q, "Unexpected rallocx() failure");
+	assert_u_eq(sample_free_calls, 1,
+	    "Sample free hook should have been called");
+	assert_ptr_eq(sample_free_ptr, p, "Unexpected freed pointer");
+	assert_zu_eq(sample_free_size, psize, "Unexpected freed size");
+	assert_u_eq(sample_calls, 2, "Sample hook should have been called");
+	assert_ptr_eq(sample_ptr, q, "Unexpected sampled pointer");
+
+	dallocx(q, 0);
+	assert_u_eq(sample_free_calls, 2,
+	    "Sample free hook should have been called");
+	assert_ptr_eq(sample_free_ptr, q, "Unexpected freed pointer");
+	assert_zu_eq(sample_free_size, sample_size, "Unexpected freed size");
+
+	/* Uninstalled hooks are no longer called. */
+	sample_hook = NULL;
+	assert_d_eq(mallctl("experimental.hooks.prof_sample", NULL, NULL,
+	    (void *)&sample_hook, sizeof(sample_hook)), 0,
+	    "Unexpected mallctl failure");
+	sample_free_hook = NULL;
+	assert_d_eq(mallctl("experimental.hooks.prof_sample_free", NULL, NULL,
+	    (void *)&sample_free_hook, sizeof(sample_free_hook)), 0,
+	    "Unexpected mallctl failure");
+	p = mallocx(100, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, 0);
+	assert_u_eq(sample_calls, 2, "Sample hook should not be called");
+	assert_u_eq(sample_free_calls, 2,
+	    "Sample free hook should not be called");
+
+	assert_d_eq(mallctl("experimental.hooks.prof_backtrace", NULL, NULL,
+	    (void *)&default_bt_hook, sizeof(default_bt_hook)), 0,
+	    "Unexpected mallctl failure");
+}
+TEST_END
+
+TEST_BEGIN(test_prof_dump_hook) {
+	prof_dump_hook_t hook;
+	const char *filename = "prof_hook_test.heap";
+	size_t sz;
+
+	test_skip_if(!config_prof);
+
+	prof_dump_open = prof_dump_open_intercept;
+
+	sz = sizeof(hook);
+	assert_d_eq(mallctl("experimental.hooks.prof_dump", (void *)&hook, &sz,
+	    NULL, 0), 0, "Unexpected mallctl failure");
+	assert_ptr_null((void *)hook, "Dump hook should be unset by default");
+
+	hook = mock_dump_hook;
+	assert_d_eq(mallctl("experimental.hooks.prof_dump", NULL, NULL,
+	    (void *)&hook, sizeof(hook)), 0, "Unexpected mallctl failure");
+	assert_d_eq(mallctl("prof.dump", NULL, NULL, (void *)&filename,
+	    sizeof(filename)), 0, "Unexpected error while dumping profile");
+	assert_u_eq(dump_calls, 1, "Dump hook should have been called");
+	assert_str_eq(dump_filename, filename, "Unexpected dump filename");
+
+	hook = NULL;
+	assert_d_eq(mallctl("experimental.hooks.prof_dump", NULL, NULL,
+	    (void *)&hook, sizeof(hook)), 0, "Unexpected mallctl failure");
+	assert_d_eq(mallctl("prof.dump", NULL, NULL, (void *)&filename,
+	    sizeof(filename)), 0, "Unexpected error while dumping profile");
+	assert_u_eq(dump_calls, 1, "Dump hook should not be called");
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_prof_backtrace_hook,
+	    test_prof_sample_hooks,
+	    test_prof_dump_hook);
+}
@@ -0,0 +1,111 @@
+#include "test/jemalloc_test.h"
+
+static unsigned
+tag_get(void) {
+	unsigned tag;
+	size_t sz = sizeof(tag);
+
+	assert_d_eq(mallctl("thread.prof.tag", (void *)&tag, &sz, NULL, 0), 0,
+	    "Unexpected mallctl failure reading thread.prof.tag");
+	return tag;
+}
+
+static void
+tag_set(unsigned tag) {
+	assert_d_eq(mallctl("thread.prof.tag", NULL, NULL, (void *)&tag,
+	    sizeof(tag)), 0, "Unexpected mallctl failure writing thread.prof.tag");
+	assert_u_eq(tag_get(), tag, "Unexpected thread.prof.tag value");
+}
+
+static size_t
+tag_stat_get(unsigned tag, const char *stat) {
+	char cmd[128];
+	size_t val;
+	size_t sz = sizeof(val);
+
+	malloc_snprintf(cmd, sizeof(cmd), "stats.prof.tags.%u.%s", tag, stat);
+	assert_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl failure reading %s", cmd);
+	return val;
+}
+
+TEST_BEGIN(test_prof_tag_validation) {
+	unsigned tag;
+	size_t val, sz;
+
+	test_skip_if(!config_prof);
+
+	assert_u_eq(tag_get(), 0, "Threads should start untagged");
+	tag_set(PROF_NTAGS - 1);
+	tag_set(0);
+
+	tag = PROF_NTAGS;
+	assert_d_eq(mallctl("thread.prof.tag", NULL, NULL, (void *)&tag,
+	    sizeof(tag)), EINVAL, "Out of range tag should be rejected");
+	assert_u_eq(tag_get(), 0, "Rejected tag should not be applied");
+
+	sz = sizeof(val);
+	assert_d_eq(mallctl("stats.prof.tags.256.curbytes", (void *)&val, &sz,
+	    NULL, 0), ENOENT, "Out of range tag stats should not exist");
+}
+TEST_END
+
+static void *
+alloc_tagged(size_t size) {
+	/* Allocate from a single call site, regardless of tag. */
+	void *p = mallocx(size, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	return p;
+}
+
+TEST_BEGIN(test_prof_tag_stats) {
+#define NALLOCS 8
+	void *ps1[NALLOCS], *ps2[NALLOCS];
+	size_t usize = 4096;
+	unsigned i;
+
+	test_skip_if(!config_prof);
+
+	assert_zu_eq(tag_stat_get(1, "curobjs"), 0, "Unexpected tag stats");
+	assert_zu_eq(tag_stat_get(2, "curobjs"), 0, "Unexpected tag stats");
+
+	/* The same backtrace sampled under two tags is accounted separately. */
+	for (i = 0; i < NALLOCS; i++) {
+		tag_set(1);
+		ps1[i] = alloc_tagged(usize);
+		tag_set(2);
+		ps2[i] = alloc_tagged(usize * 2);
+	}
+	tag_set(0);
+	assert_zu_eq(tag_stat_get(1, "curobjs"), NALLOCS,
+	    "Unexpected tag 1 object count");
+	assert_zu_eq(tag_stat_get(1, "curbytes"), NALLOCS * usize,
+	    "Unexpected tag 1 byte count");
+	assert_zu_eq(tag_stat_get(2, "curobjs"), NALLOCS,
+	    "Unexpected tag 2 object count");
+	assert_zu_eq(tag_stat_get(2, "curbytes"), NALLOCS * usize * 2,
+	    "Unexpected tag 2 byte count");
+
+	/* Objects keep their tag when freed under a different one. */
+	for (i = 0; i < NALLOCS; i++) {
+		dallocx(ps1[i], 0);
+	}
+	assert_zu_eq(tag_stat_get(1, "curbytes"), 0,
+	    "Tag 1 bytes should have been released");
+	assert_zu_eq(tag_stat_get(2, "curbytes"), NALLOCS * usize * 2,
+	    "Tag 2 bytes should be unaffected");
+	for (i = 0; i < NALLOCS; i++) {
+		dallocx(ps2[i], 0);
+	}
+	assert_zu_eq(tag_stat_get(2, "curobjs"), 0,
+	    "Tag 2 objects should have been released");
+#undef NALLOCS
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_prof_tag_validation,
+	    test_prof_tag_stats);
+}
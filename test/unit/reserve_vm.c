@@ -0,0 +1,71 @@
+#include "test/jemalloc_test.h"
+
+#define RESERVE_SIZE	((size_t)256 << 20)
+
+static uintptr_t
+reserve_base_get(void) {
+	void *base;
+	size_t sz = sizeof(base);
+	assert_d_eq(mallctl("arenas.reserve_vm_base", (void *)&base, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+	return (uintptr_t)base;
+}
+
+static bool
+in_reserve(void *ptr) {
+	return (uintptr_t)ptr - reserve_base_get() < RESERVE_SIZE;
+}
+
+TEST_BEGIN(test_reserve_vm) {
+	size_t reserve_vm;
+	size_t sz = sizeof(reserve_vm);
+	assert_d_eq(mallctl("opt.reserve_vm", (void *)&reserve_vm, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+	test_skip_if(reserve_vm != RESERVE_SIZE);
+	assert_zu_ne(reserve_base_get(), 0, "Expected reserved address space");
+
+	unsigned arena_ind;
+	sz = sizeof(arena_ind);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected arenas.create failure");
+
+	size_t sizes[] = {1, 4096, 64 << 10, 4 << 20};
+	for (unsigned i = 0; i < sizeof(sizes) / sizeof(size_t); i++) {
+		void *p = mallocx(sizes[i], 0);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		assert_true(in_reserve(p),
+		    "Allocation should come from the reservation");
+		memset(p, 0xa5, sizes[i]);
+
+		void *q = mallocx(sizes[i], MALLOCX_ARENA(arena_ind) |
+		    MALLOCX_TCACHE_NONE);
+		assert_ptr_not_null(q, "Unexpected mallocx() failure");
+		assert_true(in_reserve(q),
+		    "Allocation should come from the reservation");
+		memset(q, 0xa5, sizes[i]);
+
+		dallocx(p, 0);
+		dallocx(q, MALLOCX_TCACHE_NONE);
+	}
+}
+TEST_END
+
+TEST_BEGIN(test_reserve_vm_exhausted) {
+	test_skip_if(reserve_base_get() == 0);
+
+	/* Memory is mapped elsewhere once the reservation is used up. */
+	void *p = mallocx(RESERVE_SIZE, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	assert_false(in_reserve(p),
+	    "Allocation should not fit in the reservation");
+	memset(p, 0xa5, RESERVE_SIZE);
+	dallocx(p, 0);
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_reserve_vm,
+	    test_reserve_vm_exhausted);
+}
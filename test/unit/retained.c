@@ -174,8 +174,118 @@ TEST_BEGIN(test_retained) {
 }
 TEST_END
 
+static bool
+do_get_retain(void) {
+	bool retain;
+	size_t z = sizeof(bool);
+	assert_d_eq(mallctl("opt.retain", (void *)&retain, &z, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return retain;
+}
+
+static void
+do_purge(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib)/sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.purge", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static int
+do_retain_grow_limit(unsigned arena_ind, size_t *old_limit,
+    size_t *new_limit) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib)/sizeof(size_t);
+	assert_d_eq(mallctlnametomib("arena.0.retain_grow_limit", mib, &miblen),
+	    0, "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	size_t z = sizeof(size_t);
+	return mallctlbymib(mib, miblen, (void *)old_limit,
+	    old_limit != NULL ? &z : NULL, (void *)new_limit,
+	    new_limit != NULL ? sizeof(size_t) : 0);
+}
+
+TEST_BEGIN(test_retain_grow_limit) {
+	test_skip_if(!config_stats);
+	test_skip_if(!do_get_retain());
+
+	unsigned arena_ind = do_arena_create(NULL);
+	arena_t *arena = arena_get(tsdn_fetch(), arena_ind, false);
+
+	size_t limit;
+	assert_d_eq(do_retain_grow_limit(arena_ind, &limit, NULL), 0,
+	    "Unexpected arena.<i>.retain_grow_limit failure");
+	assert_zu_eq(limit, LARGE_MAXCLASS, "Unexpected default limit");
+
+	limit = PAGE - 1;
+	assert_d_eq(do_retain_grow_limit(arena_ind, NULL, &limit), EFAULT,
+	    "Limits below the page size should be rejected");
+
+	/* Limits are rounded down to page size classes. */
+	limit = 2 * HUGEPAGE + 1;
+	assert_d_eq(do_retain_grow_limit(arena_ind, NULL, &limit), 0,
+	    "Unexpected arena.<i>.retain_grow_limit failure");
+	assert_d_eq(do_retain_grow_limit(arena_ind, &limit, NULL), 0,
+	    "Unexpected arena.<i>.retain_grow_limit failure");
+	assert_zu_eq(limit, 2 * HUGEPAGE, "Unexpected limit");
+
+	/* Growth steps never exceed the limit, even after a long burst. */
+	for (unsigned i = 0; i < 32; i++) {
+		assert_ptr_not_null(mallocx(HUGEPAGE / 2,
+		    MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE),
+		    "Unexpected mallocx() failure");
+		assert_zu_le(sz_pind2sz(arena->extent_grow_next), limit,
+		    "Growth step above the limit");
+	}
+
+	/* Purging restarts growth from the smallest step. */
+	do_purge(arena_ind);
+	assert_u_eq(arena->extent_grow_next, sz_psz2ind(HUGEPAGE),
+	    "Growth should restart after purging");
+
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_retained_fresh) {
+	test_skip_if(!config_stats);
+	test_skip_if(!do_get_retain());
+
+	unsigned arena_ind = do_arena_create(NULL);
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	/* The remainder of the first growth step has never been used. */
+	void *p = mallocx(HUGEPAGE / 4, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	do_refresh();
+	size_t retained = do_get_size_impl("stats.arenas.0.retained",
+	    arena_ind);
+	size_t retained_fresh = do_get_size_impl(
+	    "stats.arenas.0.retained_fresh", arena_ind);
+	assert_zu_gt(retained_fresh, 0, "Expected fresh retained memory");
+	assert_zu_eq(retained_fresh, retained,
+	    "All retained memory should be fresh");
+
+	/* Purged memory is retained, but no longer fresh. */
+	dallocx(p, flags);
+	do_purge(arena_ind);
+	do_refresh();
+	assert_zu_gt(do_get_size_impl("stats.arenas.0.retained", arena_ind),
+	    retained, "Purged memory should be retained");
+	assert_zu_lt(do_get_size_impl("stats.arenas.0.retained_fresh",
+	    arena_ind), retained_fresh, "Purged memory was used");
+
+	do_arena_destroy(arena_ind);
+}
+TEST_END
+
 int
 main(void) {
 	return test(
-	    test_retained);
+	    test_retained,
+	    test_retain_grow_limit,
+	    test_retained_fresh);
 }
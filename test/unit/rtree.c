@@ -208,6 +208,65 @@ TEST_BEGIN(test_rtree_random) {
 }
 TEST_END
 
+TEST_BEGIN(test_rtree_ctx_cache) {
+#define NLEAVES (RTREE_CTX_NCACHE + RTREE_CTX_NCACHE_L2 + 1)
+	tsdn_t *tsdn = tsdn_fetch();
+	rtree_t *rtree = &test_rtree;
+	rtree_ctx_t rtree_ctx;
+	rtree_ctx_data_init(&rtree_ctx);
+
+	extent_t extent;
+	extent_init(&extent, NULL, NULL, 0, false, NSIZES, 0,
+	    extent_state_active, false, false);
+
+	assert_false(rtree_new(rtree, false), "Unexpected rtree_new() failure");
+
+	/* Use one key per leaf, so that every key needs its own cache entry. */
+	unsigned ptrbits = ZU(1) << (LG_SIZEOF_PTR+3);
+	unsigned leafbits = ptrbits - (rtree_levels[RTREE_HEIGHT-1].cumbits -
+	    rtree_levels[RTREE_HEIGHT-1].bits);
+	uintptr_t keys[NLEAVES];
+	for (unsigned i = 0; i < NLEAVES; i++) {
+		keys[i] = ((uintptr_t)i << leafbits) + PAGE;
+		assert_false(rtree_write(tsdn, rtree, &rtree_ctx, keys[i],
+		    &extent, NSIZES, false),
+		    "Unexpected rtree_write() failure");
+	}
+
+	rtree_ctx_data_init(&rtree_ctx);
+	uint64_t nlookups = 0;
+	for (unsigned pass = 0; pass < 3; pass++) {
+		for (unsigned i = 0; i < NLEAVES; i++) {
+			assert_ptr_eq(rtree_extent_read(tsdn, rtree,
+			    &rtree_ctx, keys[i], true), &extent,
+			    "rtree_extent_read() should return previously set "
+			    "value; pass=%u, i=%u", pass, i);
+			assert_ptr_eq(rtree_extent_read(tsdn, rtree,
+			    &rtree_ctx, keys[i] + 1, true), &extent,
+			    "rtree_extent_read() should return previously set "
+			    "value; pass=%u, i=%u", pass, i);
+			nlookups += 2;
+		}
+	}
+	if (config_rtree_ctx_stats && !rtree_flat_enabled(rtree)) {
+		/* Each repeated lookup hits the just filled L1 entry. */
+		assert_u64_ge(rtree_ctx.stats.l1_hits, nlookups / 2,
+		    "Unexpected L1 hit count");
+		assert_u64_ge(rtree_ctx.stats.misses, NLEAVES,
+		    "Each leaf should miss on first lookup");
+		assert_u64_eq(rtree_ctx.stats.l1_hits + rtree_ctx.stats.l2_hits
+		    + rtree_ctx.stats.misses, nlookups,
+		    "Every lookup should be counted exactly once");
+	}
+
+	for (unsigned i = 0; i < NLEAVES; i++) {
+		rtree_clear(tsdn, rtree, &rtree_ctx, keys[i]);
+	}
+	rtree_delete(tsdn, rtree);
+#undef NLEAVES
+}
+TEST_END
+
 int
 main(void) {
 	rtree_node_alloc_orig = rtree_node_alloc;
@@ -223,5 +282,6 @@ main(void) {
 	    test_rtree_read_empty,
 	    test_rtree_extrema,
 	    test_rtree_bits,
-	    test_rtree_random);
+	    test_rtree_random,
+	    test_rtree_ctx_cache);
 }
@@ -0,0 +1,72 @@
+#include "test/jemalloc_test.h"
+
+static bool mismatch_reported;
+
+static void
+malloc_message_intercept(void *cbopaque, const char *s) {
+	if (strstr(s, "Size mismatch in sized deallocation") != NULL) {
+		mismatch_reported = true;
+	}
+}
+
+TEST_BEGIN(test_sized_dealloc_check_opt) {
+	bool check;
+	size_t sz = sizeof(check);
+
+	assert_d_eq(mallctl("opt.sized_dealloc_check", (void *)&check, &sz,
+	    NULL, 0), 0, "Unexpected mallctl failure");
+	assert_true(check, "opt.sized_dealloc_check should be enabled");
+}
+TEST_END
+
+TEST_BEGIN(test_sized_dealloc_match) {
+	void (*malloc_message_orig)(void *, const char *);
+
+	malloc_message_orig = malloc_message;
+	malloc_message = malloc_message_intercept;
+	mismatch_reported = false;
+
+	/* Any size within the allocation's size class is acceptable. */
+	void *p = mallocx(100, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	sdallocx(p, sallocx(p, 0), 0);
+	p = mallocx(100, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	sdallocx(p, 100, 0);
+
+	malloc_message = malloc_message_orig;
+	assert_false(mismatch_reported, "Unexpected size mismatch report");
+}
+TEST_END
+
+TEST_BEGIN(test_sized_dealloc_mismatch) {
+	void (*malloc_message_orig)(void *, const char *);
+
+	malloc_message_orig = malloc_message;
+	malloc_message = malloc_message_intercept;
+	mismatch_reported = false;
+
+	void *p = mallocx(1024, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	sdallocx(p, 8, 0);
+
+	malloc_message = malloc_message_orig;
+	assert_true(mismatch_reported, "Size mismatch should be reported");
+
+	/*
+	 * The object should have been returned to the tcache bin for its
+	 * actual size class, from which it is reused first.
+	 */
+	void *q = mallocx(1024, 0);
+	assert_ptr_eq(q, p, "Object should be freed under its actual size");
+	dallocx(q, 0);
+}
+TEST_END
+
+int
+main(void) {
+	return test_no_reentrancy(
+	    test_sized_dealloc_check_opt,
+	    test_sized_dealloc_match,
+	    test_sized_dealloc_mismatch);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="sized_dealloc_check:true,abort:false"
@@ -0,0 +1,135 @@
+#include "test/jemalloc_test.h"
+
+#define LARGE_SZ	(8 * HUGEPAGE)
+/* Upper bound on how long background threads may take to scan the arena. */
+#define SCAN_WAIT_MS	10000
+
+static bool
+background_thread_set(bool enable) {
+	return mallctl("background_thread", NULL, NULL, (void *)&enable,
+	    sizeof(enable)) != 0;
+}
+
+static unsigned
+do_arena_create(void) {
+	unsigned arena_ind;
+	size_t sz = sizeof(unsigned);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+do_arena_ctl(const char *name, unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = sizeof(mib) / sizeof(size_t);
+	assert_d_eq(mallctlnametomib(name, mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	assert_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+/* Checks that the huge pages within [ptr, ptr+size) are hinted as dense. */
+static bool
+hints_check(void *ptr, size_t size, bool dense) {
+	arena_t *arena = iaalloc(tsdn_fetch(), ptr);
+	uintptr_t hbase = HUGEPAGE_CEILING((uintptr_t)ptr);
+	uintptr_t hpast = (uintptr_t)HUGEPAGE_ADDR2BASE((uintptr_t)ptr + size);
+
+	malloc_mutex_lock(tsdn_fetch(), &arena->extent_grow_mtx);
+	extent_mapping_t *mappings = arena->extent_mappings;
+	malloc_mutex_unlock(tsdn_fetch(), &arena->extent_grow_mtx);
+	for (extent_mapping_t *mapping = mappings; mapping != NULL; mapping =
+	    mapping->next) {
+		uintptr_t mbase = HUGEPAGE_CEILING((uintptr_t)mapping->addr);
+		uintptr_t mpast = (uintptr_t)HUGEPAGE_ADDR2BASE(
+		    (uintptr_t)mapping->addr + mapping->size);
+		for (uintptr_t region = hbase; region < hpast; region +=
+		    HUGEPAGE) {
+			if (region < mbase || region >= mpast) {
+				continue;
+			}
+			volatile uint8_t *hints = mapping->hints;
+			uint8_t hint = hints[(region - mbase) >> LG_HUGEPAGE];
+			/* Collapsing may fail; only the hint matters here. */
+			if (dense ? (hint != extent_thp_hint_huge && hint !=
+			    extent_thp_hint_collapse) : (hint !=
+			    extent_thp_hint_nohuge)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void
+hints_wait(void *ptr, size_t size, bool dense) {
+	unsigned waited_ms = 0;
+	while (!hints_check(ptr, size, dense) && waited_ms < SCAN_WAIT_MS) {
+		mq_nanosleep(1000 * 1000);
+		waited_ms++;
+	}
+	assert_true(hints_check(ptr, size, dense),
+	    "Huge pages should have been hinted as %s",
+	    dense ? "dense" : "sparse");
+}
+
+TEST_BEGIN(test_thp_policy_dense) {
+	test_skip_if(!have_background_thread);
+
+	const char *thp_policy;
+	size_t sz = sizeof(thp_policy);
+	assert_d_eq(mallctl("opt.thp_policy", (void *)&thp_policy, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+	test_skip_if(strcmp(thp_policy, "dense") != 0);
+	bool retain;
+	sz = sizeof(retain);
+	assert_d_eq(mallctl("opt.retain", (void *)&retain, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	test_skip_if(!retain);
+	test_skip_if(background_thread_set(true));
+
+	unsigned arena_ind = do_arena_create();
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void *p = mallocx(LARGE_SZ, flags);
+	assert_ptr_not_null(p, "Unexpected mallocx() failure");
+	memset(p, 0xa5, LARGE_SZ);
+	hints_wait(p, LARGE_SZ, true);
+
+	if (config_stats) {
+		uint64_t epoch = 1;
+		assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+		    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+		size_t mib[4];
+		size_t miblen = sizeof(mib) / sizeof(size_t);
+		assert_d_eq(mallctlnametomib("stats.arenas.0.thp_collapsed",
+		    mib, &miblen), 0, "Unexpected mallctlnametomib() failure");
+		mib[2] = (size_t)arena_ind;
+		uint64_t thp_collapsed;
+		sz = sizeof(thp_collapsed);
+		assert_d_eq(mallctlbymib(mib, miblen, (void *)&thp_collapsed,
+		    &sz, NULL, 0), 0, "Unexpected mallctlbymib() failure");
+		/* Collapsing depends on the kernel and huge page supply. */
+		assert_zu_le(thp_collapsed, LARGE_SZ,
+		    "Collapsed more than was ever dense");
+		assert_zu_eq(thp_collapsed % HUGEPAGE, 0,
+		    "Collapsing happens in huge page units");
+	}
+
+	/* Once purged, the same memory should be opted out again. */
+	dallocx(p, flags);
+	do_arena_ctl("arena.0.purge", arena_ind);
+	hints_wait(p, LARGE_SZ, false);
+
+	assert_false(background_thread_set(false),
+	    "Unexpected background_thread disable failure");
+	do_arena_ctl("arena.0.destroy", arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_thp_policy_dense);
+}
@@ -0,0 +1,145 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/thread_event.h"
+
+static void
+assert_thread_event_state(tsd_t *tsd) {
+	uint64_t allocated = *tsd_thread_allocatedp_get(tsd);
+	uint64_t alloc_last = *tsd_thread_allocated_last_eventp_get(tsd);
+	uint64_t alloc_next = *tsd_thread_allocated_next_eventp_get(tsd);
+	uint64_t deallocated = *tsd_thread_deallocatedp_get(tsd);
+	uint64_t dalloc_last = *tsd_thread_deallocated_last_eventp_get(tsd);
+	uint64_t dalloc_next = *tsd_thread_deallocated_next_eventp_get(tsd);
+
+	assert_u64_le(alloc_last, allocated,
+	    "Last allocation event should not be in the future");
+	assert_u64_lt(allocated, alloc_next,
+	    "Allocation event threshold should have been advanced");
+	assert_u64_le(alloc_next - alloc_last, THREAD_EVENT_MAX_INTERVAL,
+	    "Allocation event interval should be bounded");
+	assert_u64_le(dalloc_last, deallocated,
+	    "Last deallocation event should not be in the future");
+	assert_u64_lt(deallocated, dalloc_next,
+	    "Deallocation event threshold should have been advanced");
+	assert_u64_le(dalloc_next - dalloc_last, THREAD_EVENT_MAX_INTERVAL,
+	    "Deallocation event interval should be bounded");
+
+	assert_u64_le(*tsd_tcache_gc_event_waitp_get(tsd),
+	    opt_tcache_gc_incr_bytes, "Unexpected tcache GC wait");
+	assert_u64_le(*tsd_tcache_gc_dalloc_event_waitp_get(tsd),
+	    opt_tcache_gc_incr_bytes, "Unexpected tcache GC dalloc wait");
+}
+
+TEST_BEGIN(test_thread_event_thresholds) {
+#define NPTRS 64
+	tsd_t *tsd = tsd_fetch();
+	void *ptrs[NPTRS];
+	unsigned i, j;
+
+	test_skip_if(opt_tcache_gc_incr_bytes == 0);
+
+	assert_thread_event_state(tsd);
+	for (i = 0; i < 16; i++) {
+		for (j = 0; j < NPTRS; j++) {
+			/* Mix of small and large sizes. */
+			size_t sz = ((j % 8) == 0) ? ((j + 1) << 12) :
+			    ((j + 1) << 3);
+			ptrs[j] = mallocx(sz, 0);
+			assert_ptr_not_null(ptrs[j], "Unexpected mallocx failure");
+			assert_thread_event_state(tsd);
+		}
+		for (j = 0; j < NPTRS; j++) {
+			dallocx(ptrs[j], 0);
+			assert_thread_event_state(tsd);
+		}
+	}
+#undef NPTRS
+}
+TEST_END
+
+TEST_BEGIN(test_thread_event_large_alloc) {
+	tsd_t *tsd = tsd_fetch();
+	size_t sz = (size_t)THREAD_EVENT_MAX_INTERVAL * 2;
+
+	/* A single allocation may cross several event intervals at once. */
+	void *p = mallocx(sz, 0);
+	assert_ptr_not_null(p, "Unexpected mallocx failure");
+	assert_thread_event_state(tsd);
+	dallocx(p, 0);
+	assert_thread_event_state(tsd);
+}
+TEST_END
+
+static size_t
+bin0_curregs_get(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	assert_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch,
+	    sizeof(epoch)), 0, "Unexpected mallctl() failure");
+
+	char cmd[64];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.bins.0.curregs",
+	    arena_ind);
+	size_t curregs;
+	size_t sz = sizeof(curregs);
+	assert_d_eq(mallctl(cmd, (void *)&curregs, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return curregs;
+}
+
+TEST_BEGIN(test_tcache_explicit_gc) {
+#define NPTRS 16
+	test_skip_if(!config_stats);
+	test_skip_if(opt_tcache_gc_incr_bytes == 0);
+
+	unsigned arena_ind, tcache_ind;
+	size_t sz = sizeof(unsigned);
+	assert_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	assert_d_eq(mallctl("tcache.create", (void *)&tcache_ind, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE(tcache_ind);
+
+	size_t bin0_size;
+	sz = sizeof(bin0_size);
+	assert_d_eq(mallctl("arenas.bin.0.size", (void *)&bin0_size, &sz, NULL,
+	    0), 0, "Unexpected mallctl() failure");
+
+	/* Leave objects of the smallest size class in the explicit tcache. */
+	void *ptrs[NPTRS];
+	for (unsigned i = 0; i < NPTRS; i++) {
+		ptrs[i] = mallocx(bin0_size, flags);
+		assert_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < NPTRS; i++) {
+		dallocx(ptrs[i], flags);
+	}
+	size_t cached = bin0_curregs_get(arena_ind);
+	assert_zu_ge(cached, NPTRS, "Expected cached objects");
+
+	/*
+	 * Churn through another size class only, for long enough to take the
+	 * incremental GC over every bin a few times; the unused objects are
+	 * flushed.
+	 */
+	size_t churn = opt_tcache_gc_incr_bytes * nhbins * 4;
+	for (size_t nbytes = 0; nbytes < churn; nbytes += PAGE) {
+		void *p = mallocx(PAGE, flags);
+		assert_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, flags);
+	}
+	assert_zu_lt(bin0_curregs_get(arena_ind), cached,
+	    "Expected incremental GC of the explicit tcache");
+
+	assert_d_eq(mallctl("tcache.destroy", NULL, NULL, (void *)&tcache_ind,
+	    sizeof(unsigned)), 0, "Unexpected mallctl() failure");
+#undef NPTRS
+}
+TEST_END
+
+int
+main(void) {
+	return test(
+	    test_thread_event_thresholds,
+	    test_thread_event_large_alloc,
+	    test_tcache_explicit_gc);
+}